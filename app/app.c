@@ -9,6 +9,7 @@
 #include "port/s3c2440/s3c2440_io.h"
 #include "port/s3c2440/s3c2440_regs.h"
 #include "port/s3c2440/s3c2440_interrupt.h"
+#include "port/s3c2440/s3c2440_uart.h"
 
 void printf(const char *fmt);
 
@@ -60,7 +61,8 @@ void test_timer_func(void *data)
 	extern volatile uint32_t jiffies;
 	uint32_t tick = jiffies;
 	while (1) {
-		printf("test_timer\r\n");
+		/* timer callbacks must not sleep */
+		uart0_write_nb("test_timer\r\n", 12);
 		if (tick < jiffies)
 			break;
 	}
@@ -108,25 +110,12 @@ bool_t S3C2440_Init_Timer(void)
     return TRUE;
 }
 
-#define UAR0_TX_FIFO_FULL()  ((READ_REG(UFSTAT0) & 0x4000) ? 1 : 0)
-
-void put_char(char ch)
-{
-    /* wait for room for tx */
-    while (UAR0_TX_FIFO_FULL());
-    WRITE_REG(UTXHB0, ch); /* big-endian */
-}
-
+/* sleeps while the uart tx ring is full */
 void printf(const char *fmt)
 {
-    while (*fmt) {
-        put_char (*fmt++);
-    }
+    uart0_puts(fmt);
 }
 
-static TASK_STRUCT(test_task_1, TASK_DEFAULT_STACK_SIZE);
-static TASK_STRUCT(test_task_2, TASK_DEFAULT_STACK_SIZE);
-
 void test_task_1_entry(void *p)
 {
     while (1) {
@@ -154,15 +143,15 @@ void test_task_2_entry(void *p)
     }
 }
 
+DECLARE_TASK(test_task_1, 8, TICK_SCHED_ENABLED, TASK_DEFAULT_STACK_SIZE,
+    test_task_1_entry, NULL);
+DECLARE_TASK(test_task_2, 8, TICK_SCHED_ENABLED, TASK_DEFAULT_STACK_SIZE,
+    test_task_2_entry, NULL);
+
 void app_start(void)
 {
+	uart0_init(115200);
 	S3C2440_Init_Timer();
-
-    task_struct_create(&test_task_1, "test_task_1", 8, TICK_SCHED_ENABLED,
-        test_task_1_entry, NULL);
-
-    task_struct_create(&test_task_2, "test_task_2", 8, TICK_SCHED_ENABLED,
-        test_task_2_entry, NULL);
 }
 
 // EOF app.c
@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Scheduler scaling benchmark for the hosted port. All workers start on
+ * cpu 0 and spread out by work stealing, compare the elapsed time of
+ * builds with different -DCPU_NR.
+ */
+
+#include "os/task.h"
+
+int printf(const char *fmt, ...);
+
+#ifndef BENCH_TASK_NR
+#define BENCH_TASK_NR    16
+#endif
+
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS     2000
+#endif
+
+#ifndef BENCH_WORK
+#define BENCH_WORK       20000
+#endif
+
+#define BENCH_STACK_SIZE 65536
+
+static task_t bench_tasks[BENCH_TASK_NR];
+static uint32_t bench_stacks[BENCH_TASK_NR][BENCH_STACK_SIZE / sizeof(uint32_t)];
+
+static spinlock_t bench_lock = SPINLOCK_INIT;
+static int bench_left = BENCH_TASK_NR;
+static uint32_t bench_start;
+static volatile uint32_t bench_sink;
+
+static void bench_report(void)
+{
+    uint32_t elapsed = hosted_time_us() - bench_start;
+    uint32_t switches, steals;
+
+    printf("cpus %d tasks %d rounds %d work %d: %u us\n", CPU_NR,
+        BENCH_TASK_NR, BENCH_ROUNDS, BENCH_WORK, elapsed);
+
+    for (int cpu = 0; cpu < CPU_NR; cpu++) {
+        sched_get_stats(cpu, &switches, &steals);
+        printf("  cpu%d switches %u steals %u\n", cpu, switches, steals);
+    }
+
+    hosted_exit(0);
+}
+
+static void bench_task_entry(void *para)
+{
+    uint32_t x = (uint32_t)(address_t)para + 1;
+    bool_t last;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int i = 0; i < BENCH_WORK; i++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        bench_sink = x;
+        task_yield();
+    }
+
+    spin_lock(&bench_lock);
+    last = (0 == --bench_left) ? TRUE : FALSE;
+    spin_unlock(&bench_lock);
+
+    if (last)
+        bench_report();
+}
+
+void app_start(void)
+{
+    bench_start = hosted_time_us();
+
+    for (int i = 0; i < BENCH_TASK_NR; i++) {
+        task_create(bench_tasks + i, "bench", 10, 0,
+            (address_t)bench_stacks[i], BENCH_STACK_SIZE,
+            bench_task_entry, (void *)(address_t)i);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF hosted_bench.c
@@ -5,16 +5,27 @@ CC=$ARCH-gcc
 LD=$ARCH-ld
 AR=$ARCH-ar
 OBJDUMP=$ARCH-objdump
-C_OPT="-O0 -fno-omit-frame-pointer"
+# os/string.c must not turn its own loops into memcpy/memset calls
+C_OPT="-O0 -fno-omit-frame-pointer -fno-tree-loop-distribute-patterns"
 C_DBG="-g"
 C_WARN="-Wall -Wformat -Wstrict-prototypes -Wstrict-aliasing"
 C_ARCH="-mapcs-frame -std=gnu99 -mbig-endian -march=armv4"
-C_DEF="-DCPU_BITS=32"
+# the on-chip sram moves with the boot mode, BOOT=nor ./compile.sh
+if [ "$BOOT" == "nor" ]; then
+	SRAM_BASE="0x40000000"
+else
+	SRAM_BASE="0x00000000"
+fi
+C_DEF="-DCPU_BITS=32 -DSRAM_BASE=$SRAM_BASE"
 C_FLAGS="-c -nostdinc -fno-builtin $C_OPT $C_DBG $C_WARN $C_ARCH $C_DEF"
 
 LD_SCRIPT="port/arm7_9/arm7_9.lds"
+# nothing calls into these, they are reached through the initcall and
+# task tables only and an archive member would never be pulled in
+OS_TBL_OBJS="obj/os/init.o obj/os/netloop.o"
 TEXT_BASE="0x30000000"
 LD_FLAGS="-Bstatic -nostdlib -T $LD_SCRIPT -Ttext $TEXT_BASE"
+LD_FLAGS="$LD_FLAGS --defsym=SRAM_BASE=$SRAM_BASE"
 
 function compile()
 {
@@ -50,6 +61,92 @@ function dump()
 	`$OBJDUMP -D $1 > $2`
 }
 
+# the hosted kernel objects for 'cpus' cpus into directory $2, no app
+function hosted_kernel()
+{
+	local src obj
+	h_def="-DPORT_HOSTED -DCPU_NR=$1"
+	h_def="$h_def -DIDLE_TASK_STACK_SIZE=65536 -DTASK_DEFAULT_STACK_SIZE=65536"
+	h_flags="-O2 -g -fno-tree-loop-distribute-patterns -std=gnu99 $C_WARN"
+	h_flags="$h_flags -Wno-pointer-to-int-cast $h_def -I."
+	mkdir -p $2
+	for src in os/*.c; do
+		obj="$2/${src##*/}"
+		echo "[HOSTCC] ${src%.*}.o"
+		gcc -c -nostdinc -fno-builtin $h_flags $src -o "${obj%.*}.o" || exit 1
+	done
+	echo "[HOSTCC] port/hosted/hosted.o"
+	gcc -c $h_flags port/hosted/hosted.c -o $2/hosted.o || exit 1
+}
+
+# ./compile.sh hosted [cpus]: the kernel as a host process, a pthread per cpu
+function hosted()
+{
+	hosted_kernel ${1:-4} obj/hosted
+	echo "[HOSTCC] app/hosted_bench.o"
+	gcc -c -nostdinc -fno-builtin $h_flags app/hosted_bench.c \
+		-o obj/hosted/hosted_bench.o || exit 1
+	echo "[HOSTLD] minios_hosted"
+	# fixed addresses, tools/logdecode resolves them against the binary
+	gcc -no-pie -Wl,-T,port/hosted/hosted.lds obj/hosted/*.o \
+		-o minios_hosted -lpthread
+}
+
+# ./compile.sh test [name]: build and run the host tests in test/, all of
+# them or test_<name>.c. A test with an app_start() runs as the app of a
+# hosted kernel on 2 cpus, the others are programs of their own.
+function tests()
+{
+	t_flags="-O2 -g -fno-tree-loop-distribute-patterns -std=gnu99 $C_WARN"
+	t_flags="$t_flags -Wno-pointer-to-int-cast -DPORT_HOSTED -I."
+	failed=0
+	mkdir -p obj/test
+	for src in test/test_${1:-*}.c; do
+		name="${src##*/}"
+		name="${name%.c}"
+		if grep -q "^void app_start" $src; then
+			if [ -z "$t_kernel" ]; then
+				hosted_kernel 2 obj/test/kernel
+				t_kernel=1
+			fi
+			echo "[HOSTCC] obj/test/$name"
+			gcc -c -nostdinc -fno-builtin $h_flags $src \
+				-o obj/test/$name.o || exit 1
+			gcc -no-pie -Wl,-T,port/hosted/hosted.lds obj/test/kernel/*.o \
+				obj/test/$name.o -o obj/test/$name -lpthread || exit 1
+		else
+			echo "[HOSTCC] obj/test/$name"
+			gcc -nostdinc -fno-builtin $t_flags $src -o obj/test/$name \
+				|| exit 1
+		fi
+		echo "[TEST] $name"
+		timeout 120 obj/test/$name || failed=1
+	done
+	return $failed
+}
+
+# ./compile.sh tools: programs run on the build host
+function tools()
+{
+	echo "[HOSTCC] tools/logdecode"
+	gcc -O2 -Wall -o tools/logdecode tools/logdecode.c
+}
+
+if [ "$1" == "hosted" ]; then
+	hosted $2
+	exit $?
+fi
+
+if [ "$1" == "test" ]; then
+	tests $2
+	exit $?
+fi
+
+if [ "$1" == "tools" ]; then
+	tools
+	exit $?
+fi
+
 if [ ! -d obj ]; then 
 mkdir obj
 fi
@@ -59,6 +156,22 @@ fi
 compile "os/task.c"
 compile "os/hsr.c"
 compile "os/timer.c"
+compile "os/workqueue.c"
+compile "os/fiber.c"
+compile "os/init.c"
+compile "os/boottime.c"
+compile "os/log.c"
+compile "os/string.c"
+compile "os/device.c"
+compile "os/block.c"
+compile "os/ramdisk.c"
+compile "os/nandsim.c"
+compile "os/nfc.c"
+compile "os/logfs.c"
+compile "os/mbuf.c"
+compile "os/net.c"
+compile "os/netloop.c"
+compile "os/fb.c"
 ar "obj/os/*.o" "libos.a"
 
 compile "app/app.c"
@@ -66,8 +179,19 @@ compile "app/app.c"
 compile "port/arm7_9/context_switch.S"
 compile "port/arm7_9/interrupt.S"
 compile "port/arm7_9/head.S"
+compile "port/arm7_9/cache.S"
+compile "port/arm7_9/string.S"
+compile "port/arm7_9/blit.S"
+compile "port/arm7_9/mmu.c"
 compile "port/s3c2440/s3c2440_interrupt.c"
+compile "port/s3c2440/s3c2440_boot_clock.c"
+compile "port/s3c2440/s3c2440_mmu.c"
+compile "port/s3c2440/s3c2440_uart.c"
+compile "port/s3c2440/s3c2440_dma.c"
+compile "port/s3c2440/s3c2440_nand.c"
+compile "port/s3c2440/s3c2440_lcd.c"
 
-ld "minios.elf" "obj/app/*.o" "obj/port/arm7_9/*.o" "obj/port/s3c2440/*.o" "-los -L."
+ld "minios.elf" "obj/app/*.o" "obj/port/arm7_9/*.o" "obj/port/s3c2440/*.o" \
+	"$OS_TBL_OBJS" "-los -L."
 dump "minios.elf" "minios.elf.dump"
 
@@ -0,0 +1,408 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/block.h"
+#include "os/init.h"
+#include "os/string.h"
+#include "port/port.h"
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+} buf_waiter_t;
+
+static buf_t buffers[BLOCK_CACHE_NR];
+static hlist_head_t buf_hash[BLOCK_HASH_NR];
+
+/* buffers nobody holds, the least recently released first */
+static LIST_HEAD(buf_lru);
+static LIST_HEAD(buf_waiters);
+
+/*
+ * Taken with task_lock held in tasks, the completion and flush hsrs
+ * take it alone and so never spin on a task of their own cpu. A task
+ * looks at what it waits for, queues itself and suspends all under it,
+ * so an hsr on another cpu cannot wake the waiters in between.
+ */
+static spinlock_t buf_lock = SPINLOCK_INIT;
+static timer_t flush_timer = TIMER_INIT(flush_timer);
+
+#define BUF_HASH(bdev, block) \
+    (&buf_hash[(((address_t)(bdev) >> 4) ^ (block)) & (BLOCK_HASH_NR - 1)])
+
+/*--------------------------------------------------------------------------*/
+
+static buf_t *buf_lookup(blkdev_t *bdev, uint32_t block)
+{
+    hlist_node_t *node;
+    buf_t *b;
+
+    HLIST_FOR_EACH(node, BUF_HASH(bdev, block)) {
+        b = HLIST_ENTRY(node, buf_t, hash);
+        if ((b->bdev == bdev) && (b->block == block))
+            return b;
+    }
+
+    return NULL;
+}
+
+static void buf_hold(buf_t *b)
+{
+    if (0 == b->refs++)
+        LIST_DEL(&b->lru);
+}
+
+/* forget the block, the buffer is the next one reused */
+static void buf_drop(buf_t *b)
+{
+    HLIST_DEL(&b->hash);
+    b->flags = 0;
+    if (0 == b->refs) {
+        LIST_DEL(&b->lru);
+        LIST_ADD(&buf_lru, &b->lru);
+    }
+}
+
+static void buf_wakeup(void)
+{
+    buf_waiter_t *w, *nxt;
+
+    LIST_FOR_EACH_ENTRY_SAFE(w, nxt, &buf_waiters, node) {
+        LIST_DEL(&w->node);
+        task_resume(w->task, 0);
+    }
+}
+
+/* task_lock and buf_lock held, both held again once something changed */
+static void buf_wait(void)
+{
+    buf_waiter_t w;
+
+    w.task = current;
+    LIST_ADD_TAIL(&buf_waiters, &w.node);
+    task_suspend(current, 0, NULL, NULL);
+    spin_unlock(&buf_lock);
+
+    task_unlock();
+    task_lock();
+
+    spin_lock(&buf_lock);
+    LIST_DEL(&w.node);
+}
+
+/* hsr context */
+static void buf_io_done(dev_request_t *req, void *data)
+{
+    buf_t *b = (buf_t *)data;
+
+    spin_lock(&buf_lock);
+
+    b->flags &= ~BUF_IO;
+    if (DEV_WRITE == req->op) {
+        // still dirty, the next flush tries again
+        if (DEV_OK != req->status) {
+            b->flags |= BUF_DIRTY;
+            ++b->bdev->write_errors;
+        }
+    } else if (DEV_OK == req->status) {
+        b->flags |= BUF_VALID;
+    } else if (0 == b->refs) {
+        buf_drop(b);
+    }
+    buf_wakeup();
+
+    spin_unlock(&buf_lock);
+}
+
+static bool_t buf_start_io(buf_t *b, uint8_t op, uint8_t priority)
+{
+    b->flags |= BUF_IO;
+    if (DEV_WRITE == op)
+        b->flags &= ~BUF_DIRTY;
+
+    dev_request_init(&b->req, op, priority, buf_io_done, b);
+    if (dev_submit(b->bdev->dev, &b->req, b->block, b->data, BLOCK_SIZE))
+        return TRUE;
+
+    b->flags &= ~BUF_IO;
+    if (DEV_WRITE == op) {
+        b->flags |= BUF_DIRTY;
+        ++b->bdev->write_errors;
+    }
+    return FALSE;
+}
+
+/* write back what nobody holds, in lru order so merges see neighbours */
+static uint32_t buf_flush_lru(uint8_t priority)
+{
+    uint32_t started = 0;
+    buf_t *b;
+
+    LIST_FOR_EACH_ENTRY(b, &buf_lru, lru) {
+        if ((BUF_DIRTY == (b->flags & (BUF_DIRTY | BUF_IO)))
+            && buf_start_io(b, DEV_WRITE, priority))
+            ++started;
+    }
+
+    return started;
+}
+
+/*
+ * The oldest clean buffer, unhashed. With none left the dirty ones are
+ * written back if 'writeback', and the caller waits for them.
+ */
+static buf_t *buf_evict(bool_t writeback)
+{
+    buf_t *b;
+
+    LIST_FOR_EACH_ENTRY(b, &buf_lru, lru) {
+        if (0 == (b->flags & (BUF_DIRTY | BUF_IO))) {
+            HLIST_DEL(&b->hash);
+            return b;
+        }
+    }
+
+    if (writeback)
+        buf_flush_lru(BLOCK_PRIO_SYNC);
+
+    return NULL;
+}
+
+static void buf_assign(buf_t *b, blkdev_t *bdev, uint32_t block)
+{
+    b->bdev = bdev;
+    b->block = block;
+    b->flags = 0;
+    HLIST_ADD(BUF_HASH(bdev, block), &b->hash);
+}
+
+/* task_lock and buf_lock held, the buffer comes back held */
+static buf_t *buf_get(blkdev_t *bdev, uint32_t block)
+{
+    buf_t *b;
+
+    while (1) {
+        b = buf_lookup(bdev, block);
+        if (NULL != b) {
+            ++bdev->hits;
+            break;
+        }
+
+        // someone may bring the block in while we wait, so look again
+        b = buf_evict(TRUE);
+        if (NULL != b) {
+            ++bdev->misses;
+            buf_assign(b, bdev, block);
+            break;
+        }
+        buf_wait();
+    }
+
+    buf_hold(b);
+    return b;
+}
+
+/*
+ * A read of the block after the last one doubles the window, anything
+ * else closes it. Blocks ahead are only read into clean buffers, at low
+ * priority, and go to the young end of the lru.
+ */
+static void buf_read_ahead(blkdev_t *bdev, uint32_t block)
+{
+    uint32_t end;
+    buf_t *b;
+
+    if (block != bdev->next) {
+        bdev->ra_size = 0;
+        bdev->ra_end = 0;
+    } else if (0 == bdev->ra_size) {
+        bdev->ra_size = MIN(2, BLOCK_READ_AHEAD_MAX);
+    } else {
+        bdev->ra_size = MIN(bdev->ra_size << 1, BLOCK_READ_AHEAD_MAX);
+    }
+    bdev->next = block + 1;
+
+    if (0 == bdev->ra_size)
+        return;
+
+    end = MIN(block + 1 + bdev->ra_size, bdev->nr_blocks);
+    bdev->ra_end = MAX(bdev->ra_end, block + 1);
+
+    for (; bdev->ra_end < end; bdev->ra_end++) {
+        if (NULL != buf_lookup(bdev, bdev->ra_end))
+            continue;
+
+        b = buf_evict(FALSE);
+        if (NULL == b)
+            break;
+
+        buf_assign(b, bdev, bdev->ra_end);
+        LIST_DEL(&b->lru);
+        LIST_ADD_TAIL(&buf_lru, &b->lru);
+        if (!buf_start_io(b, DEV_READ, BLOCK_PRIO_READ_AHEAD)) {
+            buf_drop(b);
+            break;
+        }
+        ++bdev->read_aheads;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+bool_t blkdev_open(blkdev_t *bdev, const char *name, uint32_t nr_blocks)
+{
+    memset(bdev, 0, sizeof(*bdev));
+    bdev->dev = device_find(name);
+    bdev->nr_blocks = nr_blocks;
+
+    return (NULL != bdev->dev) ? TRUE : FALSE;
+}
+
+buf_t *bread(blkdev_t *bdev, uint32_t block)
+{
+    buf_t *b;
+
+    if (block >= bdev->nr_blocks)
+        return NULL;
+
+    task_lock();
+    spin_lock(&buf_lock);
+
+    b = buf_get(bdev, block);
+    if (0 == (b->flags & (BUF_VALID | BUF_IO)))
+        buf_start_io(b, DEV_READ, BLOCK_PRIO_READ);
+
+    // queued behind our own read, the device works on both at once
+    buf_read_ahead(bdev, block);
+
+    while (b->flags & BUF_IO)
+        buf_wait();
+
+    spin_unlock(&buf_lock);
+    task_unlock();
+
+    if (b->flags & BUF_VALID)
+        return b;
+
+    brelse(b);
+    return NULL;
+}
+
+buf_t *bget(blkdev_t *bdev, uint32_t block)
+{
+    buf_t *b;
+
+    if (block >= bdev->nr_blocks)
+        return NULL;
+
+    task_lock();
+    spin_lock(&buf_lock);
+
+    b = buf_get(bdev, block);
+    while (b->flags & BUF_IO)
+        buf_wait();
+    b->flags |= BUF_VALID;
+
+    spin_unlock(&buf_lock);
+    task_unlock();
+
+    return b;
+}
+
+void brelse(buf_t *b)
+{
+    task_lock();
+    spin_lock(&buf_lock);
+
+    BUG_ON(0 == b->refs);
+
+    if (0 == --b->refs) {
+        if (b->flags & (BUF_VALID | BUF_IO)) {
+            LIST_ADD_TAIL(&buf_lru, &b->lru);
+        } else {
+            // a failed read, no use keeping it
+            LIST_ADD(&buf_lru, &b->lru);
+            HLIST_DEL(&b->hash);
+        }
+        buf_wakeup();
+    }
+
+    spin_unlock(&buf_lock);
+    task_unlock();
+}
+
+void bdirty(buf_t *b)
+{
+    task_lock();
+    spin_lock(&buf_lock);
+    b->flags |= BUF_DIRTY | BUF_VALID;
+    spin_unlock(&buf_lock);
+    task_unlock();
+}
+
+status_t bsync(blkdev_t *bdev)
+{
+    uint32_t errors;
+    bool_t busy;
+    buf_t *b;
+
+    task_lock();
+    spin_lock(&buf_lock);
+
+    // held buffers too, until none is dirty or a write failed
+    errors = bdev->write_errors;
+    while (errors == bdev->write_errors) {
+        busy = FALSE;
+        for (b = buffers; b < buffers + BLOCK_CACHE_NR; b++) {
+            if ((b->bdev != bdev) || HLIST_UNHASHED(&b->hash))
+                continue;
+            if (b->flags & BUF_IO)
+                busy = TRUE;
+            else if (b->flags & BUF_DIRTY)
+                busy |= buf_start_io(b, DEV_WRITE, BLOCK_PRIO_SYNC);
+        }
+        if (!busy)
+            break;
+        buf_wait();
+    }
+
+    spin_unlock(&buf_lock);
+    task_unlock();
+
+    return (errors == bdev->write_errors) ? DEV_OK : DEV_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* hsr context, a one-shot timer that arms itself again */
+static void buf_flush_timeout(void *data)
+{
+    spin_lock(&buf_lock);
+    buf_flush_lru(BLOCK_PRIO_FLUSH);
+    spin_unlock(&buf_lock);
+
+    timer_start(&flush_timer, BLOCK_FLUSH_TICKS, buf_flush_timeout, NULL);
+}
+
+/* level 5, the devices are probed at 4 */
+static bool_t block_init(void)
+{
+    buf_t *b;
+
+    for (b = buffers; b < buffers + BLOCK_CACHE_NR; b++) {
+        INIT_HLIST_NODE(&b->hash);
+        LIST_ADD_TAIL(&buf_lru, &b->lru);
+    }
+
+    timer_start(&flush_timer, BLOCK_FLUSH_TICKS, buf_flush_timeout, NULL);
+    return TRUE;
+}
+
+DECLARE_INITCALL(block_init, 5);
+
+/*--------------------------------------------------------------------------*/
+// EOF block.c
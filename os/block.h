@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_BLOCK_H_
+#define _MINIOS_BLOCK_H_
+
+#include "os/device.h"
+#include "os/timer.h"
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE              512
+#endif
+
+/* buffers in the cache, all of them allocated up front */
+#ifndef BLOCK_CACHE_NR
+#define BLOCK_CACHE_NR          32
+#endif
+
+/* hash buckets, a power of two */
+#ifndef BLOCK_HASH_NR
+#define BLOCK_HASH_NR           16
+#endif
+
+/* ticks between two write-backs of the dirty buffers */
+#ifndef BLOCK_FLUSH_TICKS
+#define BLOCK_FLUSH_TICKS       100
+#endif
+
+/* most blocks read ahead of a sequential reader */
+#ifndef BLOCK_READ_AHEAD_MAX
+#define BLOCK_READ_AHEAD_MAX    (BLOCK_CACHE_NR / 4)
+#endif
+
+/* request priorities, demand reads go first and write-back last */
+#define BLOCK_PRIO_READ         0
+#define BLOCK_PRIO_SYNC         1
+#define BLOCK_PRIO_READ_AHEAD   2
+#define BLOCK_PRIO_FLUSH        3
+
+/*
+ * A device driven in BLOCK_SIZE units: requests carry the block number
+ * in 'pos' and BLOCK_SIZE in 'len'. The rest is the read-ahead state.
+ */
+typedef struct blkdev {
+    device_t *dev;
+    uint32_t nr_blocks;
+    uint32_t next;              /* block after the last one read */
+    uint32_t ra_size;           /* 0 until reads look sequential */
+    uint32_t ra_end;            /* read ahead up to here */
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t read_aheads;
+    uint32_t write_errors;
+} blkdev_t;
+
+#define BUF_VALID               (1 << 0)
+#define BUF_DIRTY               (1 << 1)
+#define BUF_IO                  (1 << 2)    /* request on the device */
+
+/*
+ * A cached block, hashed by (bdev, block). Held buffers stay put, the
+ * others sit on the lru list and are reused oldest first.
+ */
+typedef struct buf {
+    hlist_node_t hash;
+    list_head_t lru;
+    blkdev_t *bdev;
+    uint32_t block;
+    uint32_t refs;
+    volatile uint32_t flags;
+    dev_request_t req;
+    uint8_t data[BLOCK_SIZE] __attribute__((aligned(32)));
+} buf_t;
+
+/* FALSE if there is no ready device of that name */
+bool_t blkdev_open(blkdev_t *bdev, const char *name, uint32_t nr_blocks);
+
+/*
+ * Task context, the cache is usable from initcall level 5 on. bread()
+ * returns the block held and read, NULL if it is out of range or the
+ * read failed; bget() skips the read for callers that overwrite all of
+ * it. Either way the caller gives it back with brelse().
+ */
+buf_t *bread(blkdev_t *bdev, uint32_t block);
+buf_t *bget(blkdev_t *bdev, uint32_t block);
+void brelse(buf_t *b);
+
+/* written back by the flush timer, or by bsync() */
+void bdirty(buf_t *b);
+
+/* task context, writes all dirty blocks of 'bdev' and waits for them */
+status_t bsync(blkdev_t *bdev);
+
+#endif // _MINIOS_BLOCK_H_
+// EOF block.h
@@ -0,0 +1,44 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/boottime.h"
+#include "port/port.h"
+
+typedef struct {
+    const char *phase;
+    uint32_t us;
+} boot_phase_t;
+
+static boot_phase_t boot_phases[BOOT_PHASE_MAX_NR];
+static uint32_t boot_phase_nr;
+
+void boot_time_mark(const char *phase)
+{
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+
+    if (boot_phase_nr < BOOT_PHASE_MAX_NR) {
+        boot_phases[boot_phase_nr].phase = phase;
+        boot_phases[boot_phase_nr].us = platform_boot_clock();
+        ++boot_phase_nr;
+    }
+
+    HAL_IRQ_RESTORE(flags);
+}
+
+void boot_time_dump(boot_print_t print)
+{
+    uint32_t last = 0;
+
+    for (int i = 0; i < boot_phase_nr; i++) {
+        print(boot_phases[i].phase, boot_phases[i].us,
+            boot_phases[i].us - last);
+        last = boot_phases[i].us;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF boottime.c
@@ -0,0 +1,32 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_BOOTTIME_H_
+#define _MINIOS_BOOTTIME_H_
+
+#include "os/minios_type.h"
+
+#ifndef BOOT_PHASE_MAX_NR
+#define BOOT_PHASE_MAX_NR 16
+#endif
+
+/* phase, when it ended and how long it took, in microseconds */
+typedef void (*boot_print_t)(const char *phase, uint32_t us, uint32_t delta);
+
+/* record the end of a boot phase, dropped once the table is full */
+void boot_time_mark(const char *phase);
+
+void boot_time_dump(boot_print_t print);
+
+/*
+ * Microseconds since reset, from a clock the platform starts before
+ * .bss is cleared. It may only be good for the first seconds of boot.
+ */
+uint32_t platform_boot_clock(void);
+
+#endif // _MINIOS_BOOTTIME_H_
+// EOF boottime.h
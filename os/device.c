@@ -0,0 +1,246 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/device.h"
+#include "os/init.h"
+#include "os/string.h"
+#include "port/port.h"
+
+/* weak, a hosted build has no table until some device is declared */
+extern device_t __DEV_TBL_START__[] __attribute__((weak));
+extern device_t __DEV_TBL_END__[] __attribute__((weak));
+
+/*--------------------------------------------------------------------------*/
+
+static void dev_finish(dev_request_t *req)
+{
+    cpu_flags_t flags;
+    task_t *waiter;
+
+    // done first, the callback may submit it again; under the lock
+    // dev_wait() checks it with, or a waiter could be missed
+    flags = spin_lock_irqsave(&req->dev->lock);
+    waiter = req->waiter;
+    req->waiter = NULL;
+    req->done = 1;
+    spin_unlock_irqrestore(&req->dev->lock, flags);
+
+    if (req->callback)
+        req->callback(req, req->data);
+    if (waiter)
+        task_resume(waiter, 0);
+}
+
+/* completions in order, merged requests finish with the one they rode on */
+static void dev_complete_hsr(void *data)
+{
+    device_t *dev = (device_t *)data;
+    dev_request_t *req, *m, *nxt;
+    list_head_t *node;
+    cpu_flags_t flags;
+
+    while (1) {
+        flags = spin_lock_irqsave(&dev->lock);
+        node = LIST_FIRST(&dev->done);
+        if (NULL != node)
+            LIST_DEL(node);
+        spin_unlock_irqrestore(&dev->lock, flags);
+
+        if (NULL == node)
+            break;
+
+        req = LIST_ENTRY(node, dev_request_t, node);
+        LIST_FOR_EACH_ENTRY_SAFE(m, nxt, &req->merged, node) {
+            LIST_DEL(&m->node);
+            m->status = req->status;
+            dev_finish(m);
+        }
+        dev_finish(req);
+    }
+}
+
+/*
+ * Feed the hardware up to 'depth' requests, most urgent first. start()
+ * runs unlocked, and a driver completing inside it only lets the loop
+ * here go on instead of recursing.
+ */
+static void dev_dispatch(device_t *dev)
+{
+    cpu_flags_t flags;
+    dev_request_t *req;
+    list_head_t *node;
+    int prio;
+
+    flags = spin_lock_irqsave(&dev->lock);
+
+    if (dev->dispatching) {
+        spin_unlock_irqrestore(&dev->lock, flags);
+        return;
+    }
+    dev->dispatching = TRUE;
+
+    while ((dev->active < dev->depth) && (0 != dev->queue_map)) {
+        prio = HAL_FIND_FIRST_SET(dev->queue_map);
+        node = LIST_FIRST(&dev->queue[prio]);
+        LIST_DEL(node);
+        if (LIST_EMPTY(&dev->queue[prio]))
+            dev->queue_map &= ~(1 << prio);
+        --dev->queued;
+        ++dev->active;
+
+        spin_unlock_irqrestore(&dev->lock, flags);
+
+        req = LIST_ENTRY(node, dev_request_t, node);
+        dev->ops->start(dev, req);
+
+        flags = spin_lock_irqsave(&dev->lock);
+    }
+
+    dev->dispatching = FALSE;
+    spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+/*--------------------------------------------------------------------------*/
+
+device_t *device_find(const char *name)
+{
+    device_t *dev;
+
+    for (dev = __DEV_TBL_START__; dev < __DEV_TBL_END__; dev++) {
+        if (dev->ready && (0 == strcmp(dev->name, name)))
+            return dev;
+    }
+
+    return NULL;
+}
+
+void dev_request_init(dev_request_t *req, uint8_t op, uint8_t priority,
+    dev_callback_t callback, void *data)
+{
+    BUG_ON(priority >= DEV_PRIORITY_MAX_NR);
+
+    INIT_LIST_HEAD(&req->node);
+    INIT_LIST_HEAD(&req->merged);
+    req->dev = NULL;
+    req->op = op;
+    req->priority = priority;
+    req->status = DEV_OK;
+    req->callback = callback;
+    req->data = data;
+    req->waiter = NULL;
+    req->done = 1;
+}
+
+bool_t dev_submit(device_t *dev, dev_request_t *req, uint32_t pos,
+    void *buf, uint32_t len)
+{
+    cpu_flags_t flags;
+    dev_request_t *q;
+    bool_t merged = FALSE;
+
+    if (!dev->ready || !req->done)
+        return FALSE;
+
+    req->dev = dev;
+    req->pos = pos;
+    req->buf = buf;
+    req->len = len;
+    req->status = DEV_PENDING;
+    req->done = 0;
+
+    flags = spin_lock_irqsave(&dev->lock);
+
+    // only requests still queued can take it, never one on the hardware
+    if (dev->ops->merge) {
+        LIST_FOR_EACH_ENTRY(q, &dev->queue[req->priority], node) {
+            if ((q->op == req->op) && dev->ops->merge(dev, q, req)) {
+                LIST_ADD_TAIL(&q->merged, &req->node);
+                ++dev->merges;
+                merged = TRUE;
+                break;
+            }
+        }
+    }
+
+    if (!merged) {
+        LIST_ADD_TAIL(&dev->queue[req->priority], &req->node);
+        dev->queue_map |= (1 << req->priority);
+        ++dev->queued;
+    }
+
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    dev_dispatch(dev);
+    return TRUE;
+}
+
+status_t dev_wait(dev_request_t *req)
+{
+    cpu_flags_t flags;
+
+    // the completion hsr, on any cpu, cannot run between the check and
+    // the suspend: both are under the lock it sets 'done' with
+    task_lock();
+    while (!req->done) {
+        flags = spin_lock_irqsave(&req->dev->lock);
+        if (!req->done) {
+            req->waiter = current;
+            task_suspend(current, 0, NULL, NULL);
+        }
+        spin_unlock_irqrestore(&req->dev->lock, flags);
+        task_unlock();
+        task_lock();
+    }
+    task_unlock();
+
+    return req->status;
+}
+
+void dev_complete(dev_request_t *req, status_t status)
+{
+    device_t *dev = req->dev;
+    cpu_flags_t flags = spin_lock_irqsave(&dev->lock);
+
+    req->status = status;
+    --dev->active;
+    LIST_ADD_TAIL(&dev->done, &req->node);
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    activiate_hsr(&dev->hsr, dev);
+    dev_dispatch(dev);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* level 4, after the buses and dma the drivers use */
+static bool_t device_init(void)
+{
+    bool_t ok = TRUE;
+    device_t *dev;
+
+    for (dev = __DEV_TBL_START__; dev < __DEV_TBL_END__; dev++) {
+        for (int i = 0; i < DEV_PRIORITY_MAX_NR; i++)
+            INIT_LIST_HEAD(&dev->queue[i]);
+        INIT_LIST_HEAD(&dev->done);
+        INIT_HSR(&dev->hsr, 0, dev_complete_hsr, "dev_hsr");
+        if (0 == dev->depth)
+            dev->depth = 1;
+
+        if (dev->ops->probe && !dev->ops->probe(dev)) {
+            ok = FALSE;
+            continue;
+        }
+        dev->ready = TRUE;
+    }
+
+    return ok;
+}
+
+DECLARE_INITCALL(device_init, 4);
+
+/*--------------------------------------------------------------------------*/
+// EOF device.c
@@ -0,0 +1,115 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_DEVICE_H_
+#define _MINIOS_DEVICE_H_
+
+#include "os/task.h"
+
+/* request priorities, 0 is served first */
+#define DEV_PRIORITY_MAX_NR 4
+
+#define DEV_READ            0
+#define DEV_WRITE           1
+#define DEV_CONTROL         2
+
+/* request status */
+#define DEV_OK              0
+#define DEV_ERROR           -1
+#define DEV_PENDING         1
+
+struct device;
+struct dev_request;
+
+typedef void (*dev_callback_t)(struct dev_request *, void *);
+
+/*
+ * Owned by the caller until it is done. A request the driver merged into
+ * a queued one rides along on its 'merged' list and completes with it.
+ */
+typedef struct dev_request {
+    list_head_t node;
+    list_head_t merged;
+    struct device *dev;
+    uint8_t op;
+    uint8_t priority;
+    uint32_t pos;
+    void *buf;
+    uint32_t len;
+    status_t status;
+    dev_callback_t callback;
+    void *data;
+    task_t *waiter;
+    volatile uint32_t done;
+} dev_request_t;
+
+/*
+ * start() hands a request to the hardware and returns, it runs in any
+ * context and must not block; the driver calls dev_complete() when the
+ * hardware is done, usually from its isr. merge() is optional: it may
+ * grow the queued request 'into' so that it also covers 'req', it is
+ * called with the queue locked and interrupts masked.
+ */
+typedef struct {
+    bool_t (*probe)(struct device *);
+    void (*start)(struct device *, dev_request_t *);
+    bool_t (*merge)(struct device *, dev_request_t *into, dev_request_t *req);
+} dev_ops_t;
+
+typedef struct device {
+    const char *name;
+    const dev_ops_t *ops;
+    void *priv;
+    uint32_t depth;             /* requests the hardware takes at once */
+    uint32_t active;
+    uint32_t queued;
+    uint32_t merges;
+    uint32_t queue_map;         /* priorities with queued requests */
+    list_head_t queue[DEV_PRIORITY_MAX_NR];
+    list_head_t done;
+    spinlock_t lock;
+    hsr_t hsr;
+    bool_t dispatching;
+    bool_t ready;
+} device_t;
+
+#ifndef DEV_TBL_SECTION
+#define DEV_TBL_SECTION ".dev_tbl"
+#endif
+
+/*
+ * Devices live in the device table section, the framework probes all
+ * of them from an initcall at level 4 so drivers may rely on what the
+ * lower levels set up. 'depth' is how many requests may be in flight.
+ */
+#define DECLARE_DEVICE(_name, _ops, _priv, _depth)                          \
+device_t _name __attribute__((used, section(DEV_TBL_SECTION),             \
+    aligned(__alignof__(device_t)))) = {                                    \
+    .name = #_name,                                                         \
+    .ops = (_ops),                                                          \
+    .priv = (_priv),                                                        \
+    .depth = (_depth),                                                      \
+    .lock = SPINLOCK_INIT,                                                  \
+}
+
+device_t *device_find(const char *name);
+
+void dev_request_init(dev_request_t *req, uint8_t op, uint8_t priority,
+    dev_callback_t callback, void *data);
+
+/* any context, FALSE if the device is not ready or 'req' still busy */
+bool_t dev_submit(device_t *dev, dev_request_t *req, uint32_t pos,
+    void *buf, uint32_t len);
+
+/* task context, sleeps until done and returns the status */
+status_t dev_wait(dev_request_t *req);
+
+/* driver side, any context */
+void dev_complete(dev_request_t *req, status_t status);
+
+#endif // _MINIOS_DEVICE_H_
+// EOF device.h
@@ -0,0 +1,322 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/fb.h"
+#include "os/string.h"
+#include "port/port.h"
+
+/* two pixels, reached through pointers to pixels */
+typedef uint32_t fb_word_t __attribute__((may_alias));
+
+/* the word of two source pixels straddling two aligned words */
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define FB_MERGE(a, b)      (((a) << 16) | ((b) >> 16))
+#else
+#define FB_MERGE(a, b)      (((a) >> 16) | ((b) << 16))
+#endif
+
+/* a pixel spread to g at 21, r at 11 and b at 0, room for 5 bits more each */
+#define FB_SPREAD_MASK      0x07e0f81f
+
+/*--------------------------------------------------------------------------*/
+
+#ifndef HAL_ARCH_FB_FILL
+void fb_fill_span(fb_pixel_t *dst, fb_pixel_t color, uint32_t n)
+{
+    uint32_t v = color | ((uint32_t)color << 16);
+    fb_word_t *w;
+
+    if ((n > 0) && ((address_t)dst & 2)) {
+        *dst++ = color;
+        --n;
+    }
+
+    w = (fb_word_t *)dst;
+    for (; n >= 16; n -= 16) {
+        w[0] = v;
+        w[1] = v;
+        w[2] = v;
+        w[3] = v;
+        w[4] = v;
+        w[5] = v;
+        w[6] = v;
+        w[7] = v;
+        w += 8;
+    }
+    for (; n >= 2; n -= 2)
+        *w++ = v;
+
+    if (n > 0)
+        *(fb_pixel_t *)w = color;
+}
+#endif
+
+#ifndef HAL_ARCH_FB_COPY
+void fb_copy_span(fb_pixel_t *dst, const fb_pixel_t *src, uint32_t n)
+{
+    const fb_word_t *s;
+    uint32_t cur, nxt;
+    fb_word_t *d;
+
+    // aligned alike, memcpy moves it by blocks of words
+    if (0 == (((address_t)dst ^ (address_t)src) & 2)) {
+        memcpy(dst, src, n * sizeof(fb_pixel_t));
+        return;
+    }
+
+    if ((n > 0) && ((address_t)dst & 2)) {
+        *dst++ = *src++;
+        --n;
+    }
+    if (0 == n)
+        return;
+
+    // a pixel apart, each word is put together from two source words; the
+    // last read may take the pixel after the end, never a word beyond it
+    d = (fb_word_t *)dst;
+    s = (const fb_word_t *)(src - 1);
+    cur = *s++;
+    for (; n >= 2; n -= 2) {
+        nxt = *s++;
+        *d++ = FB_MERGE(cur, nxt);
+        cur = nxt;
+        src += 2;
+    }
+
+    if (n > 0)
+        *(fb_pixel_t *)d = *src;
+}
+#endif
+
+#ifndef HAL_ARCH_FB_BLEND
+/*
+ * Each channel becomes (s * a + d * (32 - a)) / 32. Spread apart, the
+ * channels have the room to be scaled together by one multiply each.
+ */
+static inline uint32_t fb_blend_pixel(uint32_t d, uint32_t s, uint32_t a)
+{
+    d = (d | (d << 16)) & FB_SPREAD_MASK;
+    s = (s | (s << 16)) & FB_SPREAD_MASK;
+    d = ((s * a + d * (32 - a)) >> 5) & FB_SPREAD_MASK;
+    return (d | (d >> 16)) & 0xffff;
+}
+
+void fb_blend_span(fb_pixel_t *dst, const fb_pixel_t *src, uint32_t n,
+    uint32_t alpha)
+{
+    uint32_t a = (MIN(alpha, 255) * 32 + 127) / 255;
+    const fb_word_t *s;
+    uint32_t dw, sw;
+    fb_word_t *d;
+
+    // the halves of a word are pixels at the same place on both sides
+    if (0 == (((address_t)dst ^ (address_t)src) & 2)) {
+        if ((n > 0) && ((address_t)dst & 2)) {
+            *dst = (fb_pixel_t)fb_blend_pixel(*dst, *src++, a);
+            ++dst;
+            --n;
+        }
+
+        d = (fb_word_t *)dst;
+        s = (const fb_word_t *)src;
+        for (; n >= 2; n -= 2) {
+            dw = *d;
+            sw = *s++;
+            *d++ = fb_blend_pixel(dw & 0xffff, sw & 0xffff, a)
+                | (fb_blend_pixel(dw >> 16, sw >> 16, a) << 16);
+        }
+        dst = (fb_pixel_t *)d;
+        src = (const fb_pixel_t *)s;
+    }
+
+    while (n-- > 0) {
+        *dst = (fb_pixel_t)fb_blend_pixel(*dst, *src++, a);
+        ++dst;
+    }
+}
+#endif
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t fb_area(const fb_rect_t *r)
+{
+    return (uint32_t)r->w * (uint32_t)r->h;
+}
+
+static void fb_union(fb_rect_t *u, const fb_rect_t *a, const fb_rect_t *b)
+{
+    int32_t x1 = MAX(a->x + a->w, b->x + b->w);
+    int32_t y1 = MAX(a->y + a->h, b->y + b->h);
+
+    u->x = MIN(a->x, b->x);
+    u->y = MIN(a->y, b->y);
+    u->w = x1 - u->x;
+    u->h = y1 - u->y;
+}
+
+/* cut down to the screen, FALSE if nothing is left */
+static bool_t fb_clip(fb_t *fb, fb_rect_t *r)
+{
+    if (r->x < 0) {
+        r->w += r->x;
+        r->x = 0;
+    }
+    if (r->y < 0) {
+        r->h += r->y;
+        r->y = 0;
+    }
+    if (r->x + r->w > (int32_t)fb->width)
+        r->w = (int32_t)fb->width - r->x;
+    if (r->y + r->h > (int32_t)fb->height)
+        r->h = (int32_t)fb->height - r->y;
+
+    return ((r->w > 0) && (r->h > 0)) ? TRUE : FALSE;
+}
+
+/*
+ * 'add' joins a rectangle it overlaps or touches, as the union costs no
+ * pixels more than the two. With the list full it joins the one it
+ * grows least instead. The result may join others in turn.
+ */
+static void fb_dirty(fb_t *fb, fb_rect_t add)
+{
+    int32_t cost, least;
+    uint32_t i, best;
+    fb_rect_t u;
+
+    while (fb->nr_dirty > 0) {
+        best = 0;
+        least = 0x7fffffff;
+        for (i = 0; i < fb->nr_dirty; i++) {
+            fb_union(&u, &fb->dirty[i], &add);
+            cost = (int32_t)(fb_area(&u) - fb_area(&fb->dirty[i])
+                - fb_area(&add));
+            if (cost < least) {
+                least = cost;
+                best = i;
+            }
+        }
+
+        if ((least > 0) && (fb->nr_dirty < FB_DIRTY_MAX))
+            break;
+
+        fb_union(&add, &fb->dirty[best], &add);
+        fb->dirty[best] = fb->dirty[--fb->nr_dirty];
+    }
+
+    fb->dirty[fb->nr_dirty++] = add;
+}
+
+void fb_init(fb_t *fb, fb_pixel_t *front, fb_pixel_t *back, uint32_t width,
+    uint32_t height, uint32_t stride)
+{
+    fb->front = front;
+    fb->back = back;
+    fb->width = width;
+    fb->height = height;
+    fb->stride = stride;
+    fb->nr_dirty = 0;
+    fb->updates = 0;
+    fb->pushed = 0;
+
+    memset(front, 0, stride * height * sizeof(fb_pixel_t));
+    memset(back, 0, stride * height * sizeof(fb_pixel_t));
+    HAL_DCACHE_CLEAN(front, stride * height * sizeof(fb_pixel_t));
+}
+
+void fb_mark(fb_t *fb, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    fb_rect_t r = {x, y, w, h};
+
+    if (fb_clip(fb, &r))
+        fb_dirty(fb, r);
+}
+
+void fb_fill(fb_t *fb, int32_t x, int32_t y, int32_t w, int32_t h,
+    fb_pixel_t color)
+{
+    fb_rect_t r = {x, y, w, h};
+    fb_pixel_t *dst;
+
+    if (!fb_clip(fb, &r))
+        return;
+
+    dst = fb->back + r.y * fb->stride + r.x;
+    for (int32_t row = 0; row < r.h; row++, dst += fb->stride)
+        fb_fill_span(dst, color, r.w);
+
+    fb_dirty(fb, r);
+}
+
+void fb_blit(fb_t *fb, int32_t x, int32_t y, const fb_pixel_t *src,
+    uint32_t src_stride, int32_t w, int32_t h)
+{
+    fb_rect_t r = {x, y, w, h};
+    fb_pixel_t *dst;
+
+    if (!fb_clip(fb, &r))
+        return;
+
+    src += (r.y - y) * src_stride + (r.x - x);
+    dst = fb->back + r.y * fb->stride + r.x;
+    for (int32_t row = 0; row < r.h; row++) {
+        fb_copy_span(dst, src, r.w);
+        dst += fb->stride;
+        src += src_stride;
+    }
+
+    fb_dirty(fb, r);
+}
+
+void fb_blend(fb_t *fb, int32_t x, int32_t y, const fb_pixel_t *src,
+    uint32_t src_stride, int32_t w, int32_t h, uint32_t alpha)
+{
+    fb_rect_t r = {x, y, w, h};
+    fb_pixel_t *dst;
+
+    if (alpha >= FB_ALPHA_OPAQUE) {
+        fb_blit(fb, x, y, src, src_stride, w, h);
+        return;
+    }
+    if ((0 == alpha) || !fb_clip(fb, &r))
+        return;
+
+    src += (r.y - y) * src_stride + (r.x - x);
+    dst = fb->back + r.y * fb->stride + r.x;
+    for (int32_t row = 0; row < r.h; row++) {
+        fb_blend_span(dst, src, r.w, alpha);
+        dst += fb->stride;
+        src += src_stride;
+    }
+
+    fb_dirty(fb, r);
+}
+
+void fb_update(fb_t *fb)
+{
+    fb_pixel_t *dst, *src;
+    fb_rect_t *r;
+
+    for (uint32_t i = 0; i < fb->nr_dirty; i++) {
+        r = &fb->dirty[i];
+        dst = fb->front + r->y * fb->stride + r->x;
+        src = fb->back + r->y * fb->stride + r->x;
+        for (int32_t row = 0; row < r->h; row++) {
+            fb_copy_span(dst, src, r->w);
+            HAL_DCACHE_CLEAN(dst, r->w * sizeof(fb_pixel_t));
+            dst += fb->stride;
+            src += fb->stride;
+        }
+        fb->pushed += fb_area(r);
+    }
+
+    fb->nr_dirty = 0;
+    ++fb->updates;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF fb.c
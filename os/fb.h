@@ -0,0 +1,82 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_FB_H_
+#define _MINIOS_FB_H_
+
+#include "os/minios_type.h"
+
+/* rectangles tracked before close ones are merged */
+#ifndef FB_DIRTY_MAX
+#define FB_DIRTY_MAX            8
+#endif
+
+/* rgb 5:6:5 */
+typedef unsigned short fb_pixel_t;
+
+#define FB_RGB(r, g, b)                                                     \
+    ((fb_pixel_t)((((r) & 0xf8) << 8) | (((g) & 0xfc) << 3) | ((b) >> 3)))
+
+#define FB_ALPHA_OPAQUE         255
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+} fb_rect_t;
+
+/*
+ * Drawing goes to the back buffer and marks what it touched, update()
+ * copies just those rectangles to the front buffer the controller scans
+ * out. 'stride' is in pixels and the same for both. A screen is drawn
+ * and updated by one task.
+ */
+typedef struct fb {
+    fb_pixel_t *front;
+    fb_pixel_t *back;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t nr_dirty;
+    fb_rect_t dirty[FB_DIRTY_MAX];
+    uint32_t updates;
+    uint32_t pushed;            /* pixels copied to the front */
+} fb_t;
+
+/* both buffers cleared to black */
+void fb_init(fb_t *fb, fb_pixel_t *front, fb_pixel_t *back, uint32_t width,
+    uint32_t height, uint32_t stride);
+
+/*
+ * Clipped to the screen. blit() and blend() take a source image with
+ * its own stride, blend() mixes it in by 'alpha' out of 255. A caller
+ * drawing into 'back' itself tells about it with mark().
+ */
+void fb_fill(fb_t *fb, int32_t x, int32_t y, int32_t w, int32_t h,
+    fb_pixel_t color);
+void fb_blit(fb_t *fb, int32_t x, int32_t y, const fb_pixel_t *src,
+    uint32_t src_stride, int32_t w, int32_t h);
+void fb_blend(fb_t *fb, int32_t x, int32_t y, const fb_pixel_t *src,
+    uint32_t src_stride, int32_t w, int32_t h, uint32_t alpha);
+void fb_mark(fb_t *fb, int32_t x, int32_t y, int32_t w, int32_t h);
+
+/* the dirty rectangles to the front buffer, and out of the cache */
+void fb_update(fb_t *fb);
+
+/*
+ * The kernels, one row of 'n' pixels. They go by words, two pixels at a
+ * time, wherever the alignment allows; the port may have them in
+ * assembly (HAL_ARCH_FB_FILL, HAL_ARCH_FB_COPY, HAL_ARCH_FB_BLEND).
+ */
+void fb_fill_span(fb_pixel_t *dst, fb_pixel_t color, uint32_t n);
+void fb_copy_span(fb_pixel_t *dst, const fb_pixel_t *src, uint32_t n);
+void fb_blend_span(fb_pixel_t *dst, const fb_pixel_t *src, uint32_t n,
+    uint32_t alpha);
+
+#endif // _MINIOS_FB_H_
+// EOF fb.h
@@ -0,0 +1,218 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/fiber.h"
+#include "port/port.h"
+
+extern volatile uint32_t jiffies;
+
+/* ready lists and event waiters, taken with interrupts masked */
+static spinlock_t fiber_lock = SPINLOCK_INIT;
+
+/*--------------------------------------------------------------------------*/
+
+static void fiber_sched_wakeup(void *data)
+{
+    fiber_sched_t *fs = (fiber_sched_t *)data;
+    task_resume(fs->task, 0);
+}
+
+/* under the lock the task sleeps with, it may still be on the way there */
+static void fiber_sched_timeout(void *data)
+{
+    fiber_sched_t *fs = (fiber_sched_t *)data;
+    cpu_flags_t flags;
+
+    flags = spin_lock_irqsave(&fiber_lock);
+    task_resume(fs->task, 0);
+    spin_unlock_irqrestore(&fiber_lock, flags);
+}
+
+/* fiber_lock held */
+static inline void fiber_make_ready(fiber_t *f)
+{
+    f->state = FIBER_READY;
+    LIST_ADD_TAIL(&f->sched->ready, &f->node);
+}
+
+static fiber_t *fiber_next(fiber_sched_t *fs)
+{
+    cpu_flags_t flags;
+    list_head_t *node;
+    fiber_t *f;
+
+    flags = spin_lock_irqsave(&fiber_lock);
+
+    while (NULL != (node = LIST_FIRST(&fs->sleeping))) {
+        f = LIST_ENTRY(node, fiber_t, node);
+        if (time_before(jiffies, f->wakeup))
+            break;
+        LIST_DEL(&f->node);
+        fiber_make_ready(f);
+    }
+
+    f = NULL;
+    node = LIST_FIRST(&fs->ready);
+    if (node) {
+        f = LIST_ENTRY(node, fiber_t, node);
+        LIST_DEL(&f->node);
+    }
+
+    spin_unlock_irqrestore(&fiber_lock, flags);
+
+    return f;
+}
+
+/*
+ * Sleep until a fiber is signalled or the first sleeper is due. The check,
+ * the timer and the suspend are all under fiber_lock: a fiber made ready
+ * on another cpu is either seen here or its wakeup finds the task asleep.
+ */
+static void fiber_sched_idle(fiber_sched_t *fs)
+{
+    cpu_flags_t flags;
+    list_head_t *node;
+
+    task_lock();
+    flags = spin_lock_irqsave(&fiber_lock);
+
+    if (LIST_EMPTY(&fs->ready)) {
+        timer_stop(&fs->timer);
+        node = LIST_FIRST(&fs->sleeping);
+        if (node) {
+            timer_start_at(&fs->timer, LIST_ENTRY(node, fiber_t, node)->wakeup,
+                fiber_sched_timeout, fs);
+        }
+        task_suspend(fs->task, 0, NULL, NULL);
+    }
+
+    spin_unlock_irqrestore(&fiber_lock, flags);
+    task_unlock();
+}
+
+static void fiber_finish(fiber_sched_t *fs, fiber_t *f, int ret)
+{
+    cpu_flags_t flags;
+
+    if (FIBER_BLOCKED == ret)
+        return;
+
+    if (FIBER_EXITED == ret) {
+        f->state = FIBER_DONE;
+        --fs->nr;
+        return;
+    }
+
+    flags = spin_lock_irqsave(&fiber_lock);
+    fiber_make_ready(f);
+    spin_unlock_irqrestore(&fiber_lock, flags);
+}
+
+static void fiber_sched_entry(void *para)
+{
+    fiber_sched_t *fs = (fiber_sched_t *)para;
+    fiber_t *f;
+
+    while (1) {
+        f = fiber_next(fs);
+        if (NULL == f) {
+            fiber_sched_idle(fs);
+            continue;
+        }
+
+        ++fs->runs;
+        fiber_finish(fs, f, f->func(f));
+    }
+}
+
+void fiber_sched_create(fiber_sched_t *fs, char *name, uint8_t priority,
+    void *task)
+{
+    INIT_LIST_HEAD(&fs->ready);
+    INIT_LIST_HEAD(&fs->sleeping);
+    fs->task = &((task_struct_t *)task)->task;
+    INIT_TIMER(&fs->timer);
+    INIT_HSR(&fs->wakeup, 0, fiber_sched_wakeup, "fiber_hsr");
+    fs->nr = 0;
+    fs->runs = 0;
+
+    task_struct_create(task, name, priority, 0, fiber_sched_entry, fs);
+}
+
+void fiber_spawn(fiber_sched_t *fs, fiber_t *f, fiber_func_t func,
+    void *data)
+{
+    cpu_flags_t flags;
+
+    f->sched = fs;
+    f->func = func;
+    f->data = data;
+    f->wakeup = 0;
+    f->lc = 0;
+
+    flags = spin_lock_irqsave(&fiber_lock);
+    ++fs->nr;
+    fiber_make_ready(f);
+    spin_unlock_irqrestore(&fiber_lock, flags);
+
+    activiate_hsr(&fs->wakeup, fs);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* runs in the fiber, only its own task walks the sleeping list */
+void fiber_sleep(fiber_t *f, int32_t ticks)
+{
+    fiber_t *t;
+
+    f->wakeup = jiffies + ((ticks > 0) ? ticks : 0);
+    f->state = FIBER_SLEEPING;
+
+    LIST_FOR_EACH_ENTRY(t, &f->sched->sleeping, node) {
+        if (time_after(t->wakeup, f->wakeup))
+            break;
+    }
+    __list_add(&f->node, t->node.prev, &t->node);
+}
+
+bool_t fiber_event_try(fiber_t *f, fiber_event_t *ev)
+{
+    cpu_flags_t flags;
+    bool_t ret = TRUE;
+
+    flags = spin_lock_irqsave(&fiber_lock);
+    if (ev->pending) {
+        ev->pending = 0;
+    } else {
+        f->state = FIBER_WAITING;
+        LIST_ADD_TAIL(&ev->waiters, &f->node);
+        ret = FALSE;
+    }
+    spin_unlock_irqrestore(&fiber_lock, flags);
+    return ret;
+}
+
+void fiber_event_signal(fiber_event_t *ev)
+{
+    cpu_flags_t flags;
+    fiber_t *f, *nxt;
+
+    flags = spin_lock_irqsave(&fiber_lock);
+    if (LIST_EMPTY(&ev->waiters)) {
+        ev->pending = 1;
+    } else {
+        LIST_FOR_EACH_ENTRY_SAFE(f, nxt, &ev->waiters, node) {
+            LIST_DEL(&f->node);
+            fiber_make_ready(f);
+            activiate_hsr(&f->sched->wakeup, f->sched);
+        }
+    }
+    spin_unlock_irqrestore(&fiber_lock, flags);
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF fiber.c
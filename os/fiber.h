@@ -0,0 +1,117 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_FIBER_H_
+#define _MINIOS_FIBER_H_
+
+#include "os/task.h"
+
+/*
+ * Stackless fibers: many state machines run by one task on its stack.
+ * A fiber function is re-entered from the top on every run and jumps to
+ * the point it last waited at, so locals do not survive a wait (keep
+ * state in the structure 'data' points to) and no switch statement may
+ * contain a wait.
+ */
+
+#define FIBER_READY    1
+#define FIBER_SLEEPING 2
+#define FIBER_WAITING  3
+#define FIBER_DONE     4
+
+/* what a fiber function returns to its scheduler */
+#define FIBER_YIELDED  0
+#define FIBER_BLOCKED  1
+#define FIBER_EXITED   2
+
+struct fiber;
+struct fiber_sched;
+
+typedef int (*fiber_func_t)(struct fiber *);
+
+typedef struct fiber {
+    list_head_t node;
+    struct fiber_sched *sched;
+    fiber_func_t func;
+    void *data;
+    uint32_t wakeup;
+    uint32_t lc;
+    uint8_t state;
+} fiber_t;
+
+typedef struct fiber_sched {
+    list_head_t ready;
+    list_head_t sleeping;  /* sorted by wakeup, only touched by the task */
+    task_t *task;
+    timer_t timer;
+    hsr_t wakeup;
+    uint32_t nr;
+    uint32_t runs;
+} fiber_sched_t;
+
+/* auto-reset: wakes every waiter, or the next one to wait if none */
+typedef struct {
+    list_head_t waiters;
+    uint32_t pending;
+} fiber_event_t;
+
+#define FIBER_EVENT_INIT(name) {LIST_HEAD_INIT((name).waiters), 0}
+#define INIT_FIBER_EVENT(ev) do { \
+    INIT_LIST_HEAD(&(ev)->waiters);  \
+    (ev)->pending = 0;               \
+} while (0)
+
+/*--------------------------------------------------------------------------*/
+
+#define FIBER_BEGIN(f) switch ((f)->lc) { case 0:
+
+#define FIBER_END(f) } (f)->lc = 0; return FIBER_EXITED
+
+#define FIBER_EXIT(f) do { (f)->lc = 0; return FIBER_EXITED; } while (0)
+
+/* let the other ready fibers run first */
+#define FIBER_YIELD(f) do {                      \
+    (f)->lc = __LINE__; return FIBER_YIELDED;    \
+    case __LINE__:;                              \
+} while (0)
+
+/* polled once per round of the scheduler */
+#define FIBER_WAIT_UNTIL(f, cond) do {           \
+    (f)->lc = __LINE__;                          \
+    case __LINE__: if (!(cond))                  \
+        return FIBER_YIELDED;                    \
+} while (0)
+
+#define FIBER_SLEEP(f, ticks) do {               \
+    fiber_sleep(f, ticks);                       \
+    (f)->lc = __LINE__; return FIBER_BLOCKED;    \
+    case __LINE__:;                              \
+} while (0)
+
+#define FIBER_AWAIT_EVENT(f, ev) do {            \
+    if (!fiber_event_try(f, ev)) {               \
+        (f)->lc = __LINE__; return FIBER_BLOCKED; \
+        case __LINE__:;                          \
+    }                                            \
+} while (0)
+
+/*--------------------------------------------------------------------------*/
+
+void fiber_sched_create(fiber_sched_t *fs, char *name, uint8_t priority,
+    void *task);
+void fiber_spawn(fiber_sched_t *fs, fiber_t *f, fiber_func_t func,
+    void *data);
+
+/* used by the wait macros */
+void fiber_sleep(fiber_t *f, int32_t ticks);
+bool_t fiber_event_try(fiber_t *f, fiber_event_t *ev);
+
+/* isr, hsr or task context */
+void fiber_event_signal(fiber_event_t *ev);
+
+#endif // _MINIOS_FIBER_H_
+// EOF fiber.h
@@ -6,68 +6,104 @@
 /*--------------------------------------------------------------------------*/
 
 #include "os/hsr.h"
+#include "os/task.h"
 #include "port/port.h"
 
-#if ((HSR_PRIORITY_MAX_NR <= 0) || (HSR_PRIORITY_MAX_NR > 1024))
+#if ((HSR_PRIORITY_MAX_NR <= 0) || (HSR_PRIORITY_MAX_NR > 32))
 #error HSR_PRIORITY_MAX_NR is out of range(1 ~ 32)
 #endif
 
-static uint32_t hsr_bitmap;
-static list_head_t hsr_array[HSR_PRIORITY_MAX_NR];
+/* per-priority lifo of posted hsrs, pushed by isrs, detached by swap */
+static hsr_t *volatile hsr_pending[HSR_PRIORITY_MAX_NR] HAL_FAST_DATA;
+
+static inline hsr_t *hsr_list_reverse(hsr_t *list)
+{
+    hsr_t *fifo = NULL;
+    hsr_t *nxt;
+
+    while (list) {
+        nxt = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = nxt;
+    }
+
+    return fifo;
+}
 
 void handle_pending_hsrs(void)
 {
-    extern int32_t sched_lock;
-    int nr;
-    list_head_t *list, *node;
-    hsr_t *hsr;
+    int nr = 0;
+    int32_t count;
+    hsr_t *list, *hsr;
 
     if (sched_lock > 0)
         return;
 
+    // interrupts are routed to cpu 0, so are their hsrs
+    if (0 != cpu_id())
+        return;
+
     // just only to prevent hisrs to schedule
     ++sched_lock;
 
-    while (1) {
-        nr = HAL_FIND_FIRST_SET(hsr_bitmap);
-        if (nr < 0)
-            break;
-
-        list = hsr_array + nr;
-        node = LIST_FIRST(list);
-        BUG_ON(NULL == node);
-        hsr = LIST_ENTRY(node, hsr_t, node);
-        hsr->function(hsr->data);
-
-        HAL_DISABLE_INTERRUPTS();
-        --hsr->count;
-        if (hsr->count <= 0)
-            LIST_DEL(node);
-        if (LIST_EMPTY(list))
-            hsr_bitmap &= ~(1 << nr);
-        HAL_ENABLE_INTERRUPTS();
+    while (nr < HSR_PRIORITY_MAX_NR) {
+        if (NULL == hsr_pending[nr]) {
+            ++nr;
+            continue;
+        }
+
+        // take the whole slot at once, isrs keep posting to an empty one
+        list = HAL_ATOMIC_SWAP_PTR(hsr_pending + nr, NULL);
+        list = hsr_list_reverse(list);
+
+        while (list) {
+            hsr = list;
+            list = hsr->next;
+
+            // once 'queued' is cleared an isr may push the hsr again
+            hsr->queued = 0;
+
+            count = (int32_t)HAL_ATOMIC_SWAP(&hsr->count, 0);
+            while (count-- > 0)
+                hsr->function(hsr->data);
+        }
+
+        // higher priorities may have been posted meanwhile
+        nr = 0;
     }
 
     --sched_lock;
 }
 
+/*
+ * Irq masked, on the way out of the outermost irq: something an irq
+ * nested in the drain posted after handle_pending_hsrs() looked at it.
+ */
+bool_t hsrs_pending(void)
+{
+    if ((sched_lock > 0) || (0 != cpu_id()))
+        return FALSE;
+
+    for (int nr = 0; nr < HSR_PRIORITY_MAX_NR; nr++) {
+        if (NULL != hsr_pending[nr])
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 void activiate_hsr(hsr_t *hsr, void *data)
 {
     BUG_ON(hsr->priority >= HSR_PRIORITY_MAX_NR);
 
-    ++hsr->count;
     hsr->data = data;
 
-    if (!LIST_INLIST(&hsr->node)) {
-        LIST_ADD_TAIL(hsr_array + hsr->priority, &hsr->node);
-        hsr_bitmap |= (1 << hsr->priority);
-    }
-}
+    // isrs on other cpus may post it too while cpu 0 swaps the count out
+    HAL_ATOMIC_ADD(&hsr->count, 1);
 
-void init_hsr(void)
-{
-    for (int i = 0; i < HSR_PRIORITY_MAX_NR; i++)
-        INIT_LIST_HEAD(hsr_array + i);
+    if (0 == HAL_ATOMIC_SWAP(&hsr->queued, 1))
+        hsr->next = HAL_ATOMIC_SWAP_PTR(hsr_pending + hsr->priority, hsr);
 }
 
 /*--------------------------------------------------------------------------*/
@@ -9,23 +9,41 @@
 #define _MINIOS_HSR_H_
 
 #include "os/minios_type.h"
-#include "os/list.h"
 
 #define HSR_PRIORITY_MAX_NR 8
 
 typedef void (*hsr_func_t)(void *);
 
-typedef struct {
-    list_head_t node;
+/*
+ * An hsr is posted by an isr and run later by handle_pending_hsrs().
+ * Each field has a single writer per side: isrs only set 'queued', bump
+ * 'count' and push onto the pending slot; the drain loop takes them back
+ * with atomic swaps. Isrs of several cpus may post the same hsr, so the
+ * bump is an atomic add.
+ */
+typedef struct hsr {
+    struct hsr *volatile next;
     hsr_func_t function;
-    void *data;
-    int32_t count;
+    void *volatile data;
+    volatile int32_t count;
+    volatile uint32_t queued;
     uint8_t priority;
     char *desc;
 } hsr_t;
 
+#define HSR_INIT(prio, func, desc) {NULL, func, NULL, 0, 0, prio, desc}
 #define DECLARE_HSR(name, prio, func, desc) \
-    hsr_t name = {LIST_HEAD_INIT((name).node), func, NULL, 0, prio, desc}
+    hsr_t name = HSR_INIT(prio, func, desc)
+
+#define INIT_HSR(hsr, prio, func, _desc) do { \
+    (hsr)->next = NULL;                          \
+    (hsr)->function = (func);                    \
+    (hsr)->data = NULL;                          \
+    (hsr)->count = 0;                            \
+    (hsr)->queued = 0;                           \
+    (hsr)->priority = (prio);                    \
+    (hsr)->desc = (_desc);                       \
+} while (0)
 
 void activiate_hsr(hsr_t *, void *);
 
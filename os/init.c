@@ -0,0 +1,34 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/init.h"
+#include "os/task.h"
+#include "os/boottime.h"
+
+/* level by level, laid out by arm7_9.lds or hosted.lds */
+extern initcall_t __dev_init_start[];
+extern initcall_t __dev_init_end[];
+
+uint32_t initcall_failures;
+
+static void init_task_entry(void *para)
+{
+    initcall_t *call;
+
+    for (call = __dev_init_start; call < __dev_init_end; call++) {
+        if (!(*call)())
+            ++initcall_failures;
+    }
+
+    boot_time_mark("initcalls");
+}
+
+DECLARE_TASK(init_task, INIT_TASK_PRIORITY, 0, TASK_DEFAULT_STACK_SIZE,
+    init_task_entry, NULL);
+
+/*--------------------------------------------------------------------------*/
+// EOF init.c
@@ -0,0 +1,38 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_INIT_H_
+#define _MINIOS_INIT_H_
+
+#include "os/minios_type.h"
+#include "port/port.h"
+
+/* priority of the task running the initcalls, just above the background */
+#ifndef INIT_TASK_PRIORITY
+#define INIT_TASK_PRIORITY 29
+#endif
+
+typedef bool_t (*initcall_t)(void);
+
+#ifndef INITCALL_SECTION
+#define INITCALL_SECTION(level) ".initcall" #level ".init"
+#endif
+
+/*
+ * Bring-up deferred until the scheduler runs: the init task calls them
+ * level by level (0 - 8) while the other tasks already run, so nothing
+ * needed by the first tasks may be set up here.
+ */
+#define DECLARE_INITCALL(fn, level)                 \
+static initcall_t __initcall_##fn                   \
+    __attribute__((used, section(INITCALL_SECTION(level)))) = fn
+
+/* initcalls that returned FALSE */
+extern uint32_t initcall_failures;
+
+#endif // _MINIOS_INIT_H_
+// EOF init.h
@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/log.h"
+#include "os/task.h"
+#include "os/string.h"
+#include "port/port.h"
+
+/* timestamp of a record, ticks unless the port has a finer clock */
+#ifndef HAL_LOG_CLOCK
+extern volatile uint32_t jiffies;
+#define HAL_LOG_CLOCK() jiffies
+#endif
+
+static log_record_t log_ring[LOG_RING_SIZE];
+static uint32_t log_head;
+static uint32_t log_tail;
+static spinlock_t log_lock = SPINLOCK_INIT;
+
+uint32_t log_dropped;
+
+#ifdef HAL_LOG_OUTPUT
+#ifndef LOG_DRAIN_PRIORITY
+#define LOG_DRAIN_PRIORITY (SCHED_BACKGROUND_PRIORITY - 1)
+#endif
+
+/* records taken out of the ring per write to the port */
+#define LOG_DRAIN_BATCH    16
+
+static void log_drain_entry(void *para);
+
+DECLARE_TASK(log_drain_task, LOG_DRAIN_PRIORITY, 0, TASK_DEFAULT_STACK_SIZE,
+    log_drain_entry, NULL);
+#endif
+
+/*--------------------------------------------------------------------------*/
+
+/* the record is filled under the lock, a reader never sees half of one */
+void log_write(const char *fmt, const address_t *args, uint32_t nr)
+{
+    cpu_flags_t flags;
+    log_record_t *rec;
+
+    flags = spin_lock_irqsave(&log_lock);
+
+    if (log_head - log_tail < LOG_RING_SIZE) {
+        rec = log_ring + (log_head++ & (LOG_RING_SIZE - 1));
+        rec->fmt = (address_t)fmt;
+        rec->stamp = HAL_LOG_CLOCK();
+        rec->task = (address_t)current;
+        memcpy(rec->args, args, nr * sizeof(address_t));
+    } else {
+        ++log_dropped;
+    }
+
+    spin_unlock_irqrestore(&log_lock, flags);
+}
+
+uint32_t log_read(log_record_t *records, uint32_t nr)
+{
+    cpu_flags_t flags;
+    uint32_t n = 0;
+
+    // one at a time, writers are not held off for the whole copy
+    while (n < nr) {
+        flags = spin_lock_irqsave(&log_lock);
+
+        if (log_tail == log_head) {
+            spin_unlock_irqrestore(&log_lock, flags);
+            break;
+        }
+        records[n++] = log_ring[log_tail++ & (LOG_RING_SIZE - 1)];
+
+        spin_unlock_irqrestore(&log_lock, flags);
+    }
+
+    return n;
+}
+
+#ifdef HAL_LOG_OUTPUT
+static void log_drain_entry(void *para)
+{
+    static log_record_t batch[LOG_DRAIN_BATCH];
+    uint32_t n;
+
+    while (1) {
+        while ((n = log_read(batch, LOG_DRAIN_BATCH)) > 0)
+            HAL_LOG_OUTPUT(batch, n * sizeof(log_record_t));
+        task_sleep(LOG_DRAIN_PERIOD);
+    }
+}
+#endif
+
+/*--------------------------------------------------------------------------*/
+// EOF log.c
@@ -0,0 +1,80 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_LOG_H_
+#define _MINIOS_LOG_H_
+
+#include "os/minios_type.h"
+
+/* records kept, a power of 2 */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 256
+#endif
+
+#define LOG_MAX_ARGS  5
+
+/*
+ * Nothing is formatted on the target. A record holds the address of the
+ * format string, a timestamp, the running task and the raw arguments,
+ * and tools/logdecode turns it into text with the strings and symbols of
+ * the elf image. All fields are address_t wide, 8 of them.
+ */
+typedef struct {
+    address_t fmt;
+    address_t stamp;
+    address_t task;
+    address_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+/* ", (address_t)(a)" for each argument, more than LOG_MAX_ARGS fail */
+#define __LOG_NTH(_0, _1, _2, _3, _4, _5, _6, _7, n, ...) n
+#define __LOG_NARGS(...) __LOG_NTH(0, ##__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+#define __LOG_CAT(a, b)  __LOG_CAT2(a, b)
+#define __LOG_CAT2(a, b) a##b
+#define __LOG_CAST(...)                                                    \
+    __LOG_CAT(__LOG_CAST_, __LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define __LOG_CAST_0()
+#define __LOG_CAST_1(a)  , (address_t)(a)
+#define __LOG_CAST_2(a, ...) , (address_t)(a) __LOG_CAST_1(__VA_ARGS__)
+#define __LOG_CAST_3(a, ...) , (address_t)(a) __LOG_CAST_2(__VA_ARGS__)
+#define __LOG_CAST_4(a, ...) , (address_t)(a) __LOG_CAST_3(__VA_ARGS__)
+#define __LOG_CAST_5(a, ...) , (address_t)(a) __LOG_CAST_4(__VA_ARGS__)
+#define __LOG_CAST_6(...) , LOG_takes_at_most_5_arguments
+#define __LOG_CAST_7(...) , LOG_takes_at_most_5_arguments
+
+/*
+ * printf-like, any context. The format must be a string literal and
+ * arguments integers, chars or pointers, each is stored converted to
+ * address_t; %s only works for strings in the image. Records are
+ * dropped while the ring is full.
+ */
+#define LOG(fmt, ...) do {                                                 \
+    address_t __log_args[] = {0 __LOG_CAST(__VA_ARGS__)};                  \
+    log_write("" fmt, __log_args + 1,                                      \
+        sizeof(__log_args) / sizeof(address_t) - 1);                       \
+} while (0)
+
+void log_write(const char *fmt, const address_t *args, uint32_t nr);
+
+/* task context, copy out up to 'nr' records, oldest first */
+uint32_t log_read(log_record_t *records, uint32_t nr);
+
+/* records lost to a full ring */
+extern uint32_t log_dropped;
+
+/*
+ * A port with a way out to the host defines HAL_LOG_OUTPUT(buf, len),
+ * and a background task then drains the ring to it every
+ * LOG_DRAIN_PERIOD ticks, as the raw records tools/logdecode reads.
+ * Without one the ring is left to log_read().
+ */
+#ifndef LOG_DRAIN_PERIOD
+#define LOG_DRAIN_PERIOD 10
+#endif
+
+#endif // _MINIOS_LOG_H_
+// EOF log.h
@@ -0,0 +1,1085 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/logfs.h"
+#include "os/string.h"
+#include "port/port.h"
+
+#define LOGFS_NO_PAGE       0xffffffff
+#define LOGFS_CHUNK_HDR     0xffffffff
+#define LOGFS_DELETED       0xffffffff  /* header size of a removed file */
+
+#define TAG_ID(ino, ver)    (((ino) << 24) | ((ver) & 0xffffff))
+#define TAG_INO(id)         ((id) >> 24)
+#define TAG_VER(id)         ((id) & 0xffffff)
+#define TAG_CRC_LEN         OFFSETOF(logfs_tag_t, tcrc)
+
+/* block states */
+#define LOGFS_BLK_FREE      0
+#define LOGFS_BLK_OPEN      1
+#define LOGFS_BLK_FULL      2
+#define LOGFS_BLK_RETIRE    3   /* a program failed, moved out then bad */
+#define LOGFS_BLK_BAD       4
+
+/* gc victims */
+#define LOGFS_GC_GREEDY     0   /* the fewest valid pages */
+#define LOGFS_GC_WEAR       1   /* the least worn, its data is cold */
+
+/* programs tried on fresh blocks before a write gives up */
+#define LOGFS_PROGRAM_TRIES 3
+
+#ifndef LOGFS_GC_STACK_SIZE
+#define LOGFS_GC_STACK_SIZE TASK_DEFAULT_STACK_SIZE
+#endif
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+} logfs_waiter_t;
+
+static void logfs_gc_entry(void *para);
+
+DECLARE_TASK(logfs_gc_task, LOGFS_GC_PRIORITY, 0, LOGFS_GC_STACK_SIZE,
+    logfs_gc_entry, NULL);
+
+/*
+ * File systems the gc task has to look at, and their 'gc_queued', under
+ * task_lock and logfs_gc_lock. The gc task looks at the list, and a task
+ * at fs->locked, then queues itself and suspends all under the spinlock
+ * the waker takes, so a wakeup from another cpu cannot come in between.
+ */
+static LIST_HEAD(logfs_gc_list);
+static spinlock_t logfs_gc_lock = SPINLOCK_INIT;
+
+/*--------------------------------------------------------------------------*/
+
+/* crc-32 (ieee), a nibble at a time */
+static uint32_t logfs_crc32(const void *buf, uint32_t len)
+{
+    static const uint32_t nibble[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t crc = 0xffffffff;
+
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ nibble[crc & 0xf];
+        crc = (crc >> 4) ^ nibble[crc & 0xf];
+    }
+
+    return ~crc;
+}
+
+/* sleeps, held over whole operations and single gc steps */
+static void logfs_lock(logfs_t *fs)
+{
+    logfs_waiter_t w;
+
+    task_lock();
+    spin_lock(&fs->lock);
+    while (fs->locked) {
+        w.task = current;
+        LIST_ADD_TAIL(&fs->waiters, &w.node);
+        task_suspend(current, 0, NULL, NULL);
+        spin_unlock(&fs->lock);
+
+        task_unlock();
+        task_lock();
+
+        spin_lock(&fs->lock);
+        LIST_DEL(&w.node);
+    }
+    fs->locked = TRUE;
+    spin_unlock(&fs->lock);
+    task_unlock();
+}
+
+static void logfs_unlock(logfs_t *fs)
+{
+    list_head_t *node;
+
+    task_lock();
+    spin_lock(&fs->lock);
+    fs->locked = FALSE;
+    node = LIST_FIRST(&fs->waiters);
+    if (NULL != node) {
+        LIST_DEL(node);
+        task_resume(LIST_ENTRY(node, logfs_waiter_t, node)->task, 0);
+    }
+    spin_unlock(&fs->lock);
+    task_unlock();
+}
+
+static void logfs_gc_kick(logfs_t *fs)
+{
+    task_lock();
+    spin_lock(&logfs_gc_lock);
+    if (!fs->gc_queued) {
+        fs->gc_queued = TRUE;
+        LIST_ADD_TAIL(&logfs_gc_list, &fs->gc_node);
+        task_resume(&logfs_gc_task, 0);
+    }
+    spin_unlock(&logfs_gc_lock);
+    task_unlock();
+}
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t logfs_nand_page(logfs_t *fs, uint32_t page)
+{
+    return fs->first * fs->ppb + page;
+}
+
+static bool_t logfs_tag_erased(logfs_t *fs)
+{
+    for (uint32_t i = 0; i < sizeof(logfs_tag_t); i++) {
+        if (0xff != fs->oob[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* 'data' may be NULL, the tag lands in fs->oob and 'tag' */
+static status_t logfs_read_page(logfs_t *fs, uint32_t page, void *data,
+    logfs_tag_t *tag)
+{
+    status_t st;
+
+    st = nand_read(fs->nand, logfs_nand_page(fs, page), data, fs->oob);
+    memcpy(tag, fs->oob, sizeof(*tag));
+
+    return (NAND_CORRECTED == st) ? NAND_OK : st;
+}
+
+static bool_t logfs_tag_valid(logfs_tag_t *tag)
+{
+    return (tag->tcrc == logfs_crc32(tag, TAG_CRC_LEN)) ? TRUE : FALSE;
+}
+
+static void logfs_invalidate(logfs_t *fs, uint32_t page)
+{
+    if (LOGFS_NO_PAGE != page)
+        --fs->blocks[page / fs->ppb].valid;
+}
+
+/*
+ * A block takes one seq after the other from its first page on, a failed
+ * program retires it and the next page goes to another block.
+ */
+static uint32_t logfs_page_seq(logfs_t *fs, uint32_t page)
+{
+    return fs->blocks[page / fs->ppb].seq + page % fs->ppb;
+}
+
+/*
+ * A page a failed program or a power cut left with a good looking tag
+ * would replay once newer pages hide it. Clearing the spare again is a
+ * second partial program of it, which slc parts allow.
+ */
+static void logfs_kill_page(logfs_t *fs, uint32_t page)
+{
+    memset(fs->oob, 0, fs->nand->oob_size);
+    nand_program(fs->nand, logfs_nand_page(fs, page), NULL, fs->oob);
+}
+
+static bool_t logfs_erase_block(logfs_t *fs, uint32_t blk)
+{
+    logfs_block_t *b = &fs->blocks[blk];
+
+    ++fs->erases;
+    if (NAND_OK == nand_erase(fs->nand, fs->first + blk)) {
+        ++b->ec;
+        b->valid = 0;
+        b->erased = TRUE;
+        return TRUE;
+    }
+
+    nand_mark_bad(fs->nand, fs->first + blk);
+    b->state = LOGFS_BLK_BAD;
+    return FALSE;
+}
+
+/*
+ * The least worn free block. One found free at the mount is erased
+ * again, an erase cut short by a power loss looks just like it.
+ */
+static bool_t logfs_open_block(logfs_t *fs, bool_t gc)
+{
+    uint32_t floor = gc ? 0 : LOGFS_RESERVE_BLOCKS;
+    uint32_t blk, best;
+    logfs_block_t *b;
+
+    while (fs->free_blocks > floor) {
+        best = LOGFS_NO_PAGE;
+        for (blk = 0; blk < fs->nr_blocks; blk++) {
+            b = &fs->blocks[blk];
+            if ((LOGFS_BLK_FREE == b->state) && ((LOGFS_NO_PAGE == best)
+                || (b->ec < fs->blocks[best].ec)))
+                best = blk;
+        }
+        BUG_ON(LOGFS_NO_PAGE == best);
+
+        --fs->free_blocks;
+        b = &fs->blocks[best];
+        // one that went bad is made up from the reserve, as after a
+        // failed program
+        if (!b->erased && !logfs_erase_block(fs, best)) {
+            floor = 0;
+            continue;
+        }
+
+        b->state = LOGFS_BLK_OPEN;
+        b->valid = 0;
+        b->seq = fs->seq;
+        b->erased = FALSE;
+        fs->head = best * fs->ppb;
+
+        // a good moment to see if the gc has anything to do
+        if (!gc)
+            logfs_gc_kick(fs);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* the next page of the log, a failed program retires its block */
+static status_t logfs_append(logfs_t *fs, uint32_t id, uint32_t chunk,
+    uint32_t len, const void *data, bool_t gc, uint32_t *page)
+{
+    logfs_tag_t tag;
+    logfs_block_t *b;
+    status_t st;
+
+    for (int tries = 0; tries < LOGFS_PROGRAM_TRIES; tries++) {
+        // a retry cannot make room, the data may be in fs->page
+        if ((LOGFS_NO_PAGE == fs->head)
+            && !logfs_open_block(fs, gc || (tries > 0)))
+            return LOGFS_ERR_NOSPC;
+
+        b = &fs->blocks[fs->head / fs->ppb];
+        tag.seq = fs->seq++;
+        tag.id = id;
+        tag.chunk = chunk;
+        tag.len = len;
+        tag.ec = b->ec;
+        tag.dcrc = logfs_crc32(data, fs->page_size);
+        tag.tcrc = logfs_crc32(&tag, TAG_CRC_LEN);
+
+        memset(fs->oob, 0xff, fs->nand->oob_size);
+        memcpy(fs->oob, &tag, sizeof(tag));
+        st = nand_program(fs->nand, logfs_nand_page(fs, fs->head), data,
+            fs->oob);
+
+        *page = fs->head++;
+        if (0 == fs->head % fs->ppb) {
+            fs->head = LOGFS_NO_PAGE;
+            b->state = LOGFS_BLK_FULL;
+        }
+
+        if (NAND_OK == st) {
+            ++b->valid;
+            return LOGFS_OK;
+        }
+
+        // the gc moves what is left in it
+        logfs_kill_page(fs, *page);
+        b->state = LOGFS_BLK_RETIRE;
+        fs->head = LOGFS_NO_PAGE;
+    }
+
+    return LOGFS_ERR_IO;
+}
+
+/* a header page in fs->page from what is in ram */
+static void logfs_fill_header(logfs_t *fs, logfs_file_t *f)
+{
+    memset(fs->page, 0, fs->page_size);
+    if (f->live) {
+        memcpy(fs->page, f->name, strlen(f->name) + 1);
+        memcpy(fs->page + LOGFS_NAME_MAX, f->drop, sizeof(f->drop));
+    }
+}
+
+/* chunks from 'cut' on are dropped as of this header */
+static status_t logfs_write_header(logfs_t *fs, uint32_t ino, uint32_t cut)
+{
+    logfs_file_t *f = &fs->files[ino];
+    uint32_t page, k, seq = fs->seq;
+    status_t st;
+
+    logfs_fill_header(fs, f);
+    for (k = cut; k < LOGFS_FILE_CHUNKS; k++)
+        memcpy(fs->page + LOGFS_NAME_MAX + k * sizeof(seq), &seq,
+            sizeof(seq));
+    st = logfs_append(fs, TAG_ID(ino, f->ver), LOGFS_CHUNK_HDR,
+        f->live ? f->size : LOGFS_DELETED, fs->page, FALSE, &page);
+    if (LOGFS_OK != st)
+        return st;
+
+    for (k = cut; k < LOGFS_FILE_CHUNKS; k++)
+        f->drop[k] = seq;
+    logfs_invalidate(fs, f->hdr);
+    f->hdr = page;
+    return LOGFS_OK;
+}
+
+/* chunks from 'chunk' on are gone */
+static void logfs_drop_chunks(logfs_t *fs, logfs_file_t *f, uint32_t chunk)
+{
+    for (; chunk < LOGFS_FILE_CHUNKS; chunk++) {
+        logfs_invalidate(fs, f->map[chunk]);
+        f->map[chunk] = LOGFS_NO_PAGE;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t logfs_gc_victim(logfs_t *fs, int how)
+{
+    uint32_t blk, best = LOGFS_NO_PAGE, cold = LOGFS_NO_PAGE, max_ec = 0;
+    uint32_t retire = LOGFS_NO_PAGE;
+    logfs_block_t *b;
+
+    for (blk = 0; blk < fs->nr_blocks; blk++) {
+        b = &fs->blocks[blk];
+        if (LOGFS_BLK_RETIRE == b->state) {
+            retire = blk;
+            continue;
+        }
+        if (LOGFS_BLK_BAD == b->state)
+            continue;
+
+        max_ec = MAX(max_ec, b->ec);
+        if (LOGFS_BLK_FULL != b->state)
+            continue;
+
+        // among equals the least worn, it comes back for new data
+        if ((LOGFS_NO_PAGE == best) || (b->valid < fs->blocks[best].valid)
+            || ((b->valid == fs->blocks[best].valid)
+            && (b->ec < fs->blocks[best].ec)))
+            best = blk;
+        if ((LOGFS_NO_PAGE == cold) || (b->ec < fs->blocks[cold].ec))
+            cold = blk;
+    }
+
+    // a retired block goes first unless another has less to move: with
+    // the reserve used up, only an emptier one gives back the room to
+    // move it out
+    if ((LOGFS_NO_PAGE != retire) && ((LOGFS_NO_PAGE == best)
+        || (fs->blocks[retire].valid <= fs->blocks[best].valid)))
+        return retire;
+
+    if (LOGFS_GC_WEAR == how) {
+        if ((LOGFS_NO_PAGE != cold)
+            && (max_ec - fs->blocks[cold].ec >= LOGFS_WEAR_DELTA))
+            return cold;
+        return LOGFS_NO_PAGE;
+    }
+
+    if ((LOGFS_NO_PAGE != best) && (fs->blocks[best].valid < fs->ppb))
+        return best;
+    return LOGFS_NO_PAGE;
+}
+
+/* a page the index points at moves to the open block */
+static bool_t logfs_gc_move(logfs_t *fs, uint32_t ino, uint32_t chunk,
+    uint32_t *page)
+{
+    logfs_file_t *f = &fs->files[ino];
+    uint32_t len, to;
+    logfs_tag_t tag;
+
+    if (LOGFS_CHUNK_HDR == chunk) {
+        logfs_fill_header(fs, f);
+        len = f->live ? f->size : LOGFS_DELETED;
+    } else if (logfs_read_page(fs, *page, fs->page, &tag) < 0) {
+        // gone, it reads as a hole from now on
+        ++fs->lost;
+        logfs_invalidate(fs, *page);
+        *page = LOGFS_NO_PAGE;
+        return TRUE;
+    } else {
+        len = MIN(fs->page_size, f->size - chunk * fs->page_size);
+    }
+
+    if (LOGFS_OK != logfs_append(fs, TAG_ID(ino, f->ver), chunk, len,
+        fs->page, TRUE, &to))
+        return FALSE;
+
+    logfs_invalidate(fs, *page);
+    *page = to;
+    ++fs->gc_moved;
+    return TRUE;
+}
+
+/*
+ * Move what the index still points at out of a victim and erase it.
+ * Copies carry the current size so that their newer seq replays right,
+ * and a header is rebuilt from ram.
+ */
+static bool_t logfs_gc_step(logfs_t *fs, int how)
+{
+    uint32_t victim, ino, k;
+    logfs_block_t *b;
+    logfs_file_t *f;
+
+    victim = logfs_gc_victim(fs, how);
+    if (LOGFS_NO_PAGE == victim)
+        return FALSE;
+
+    b = &fs->blocks[victim];
+    for (ino = 0; (ino < LOGFS_FILE_MAX) && b->valid; ino++) {
+        f = &fs->files[ino];
+        if ((LOGFS_NO_PAGE != f->hdr) && (f->hdr / fs->ppb == victim)
+            && !logfs_gc_move(fs, ino, LOGFS_CHUNK_HDR, &f->hdr))
+            return FALSE;
+
+        for (k = 0; k < LOGFS_FILE_CHUNKS; k++) {
+            if ((LOGFS_NO_PAGE != f->map[k]) && (f->map[k] / fs->ppb == victim)
+                && !logfs_gc_move(fs, ino, k, &f->map[k]))
+                return FALSE;
+        }
+    }
+
+    BUG_ON(0 != b->valid);
+
+    if (LOGFS_BLK_RETIRE == b->state) {
+        nand_mark_bad(fs->nand, fs->first + victim);
+        b->state = LOGFS_BLK_BAD;
+    } else if (logfs_erase_block(fs, victim)) {
+        b->state = LOGFS_BLK_FREE;
+        ++fs->free_blocks;
+    }
+
+    ++fs->gc_runs;
+    return TRUE;
+}
+
+/* before a write fills fs->page, the gc uses it too */
+static void logfs_make_room(logfs_t *fs)
+{
+    if (LOGFS_NO_PAGE != fs->head)
+        return;
+
+    while ((fs->free_blocks <= LOGFS_RESERVE_BLOCKS)
+        && logfs_gc_step(fs, LOGFS_GC_GREEDY));
+}
+
+/* low priority, collects while the writers are busy elsewhere */
+static void logfs_gc_entry(void *para)
+{
+    list_head_t *node;
+    logfs_t *fs;
+
+    while (1) {
+        task_lock();
+        spin_lock(&logfs_gc_lock);
+        while (NULL == (node = LIST_FIRST(&logfs_gc_list))) {
+            task_suspend(current, 0, NULL, NULL);
+            spin_unlock(&logfs_gc_lock);
+
+            task_unlock();
+            task_lock();
+
+            spin_lock(&logfs_gc_lock);
+        }
+        LIST_DEL(node);
+        fs = LIST_ENTRY(node, logfs_t, gc_node);
+        fs->gc_queued = FALSE;
+        spin_unlock(&logfs_gc_lock);
+        task_unlock();
+
+        logfs_lock(fs);
+        if (fs->mounted) {
+            while ((fs->free_blocks < LOGFS_GC_HIGH)
+                && logfs_gc_step(fs, LOGFS_GC_GREEDY)) {
+                logfs_unlock(fs);
+                logfs_lock(fs);
+            }
+            logfs_gc_step(fs, LOGFS_GC_WEAR);
+        }
+        logfs_unlock(fs);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void logfs_sort(logfs_t *fs, uint32_t n)
+{
+    uint32_t gap, i, j, t;
+
+    for (gap = n / 2; gap; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            t = fs->order[i];
+            for (j = i; (j >= gap)
+                && (fs->blocks[fs->order[j - gap]].seq > fs->blocks[t].seq);
+                j -= gap)
+                fs->order[j] = fs->order[j - gap];
+            fs->order[j] = t;
+        }
+    }
+}
+
+/* one page of the log, in seq order */
+static void logfs_replay(logfs_t *fs, uint32_t page, logfs_tag_t *tag)
+{
+    uint32_t ino = TAG_INO(tag->id);
+    uint32_t ver = TAG_VER(tag->id);
+    logfs_file_t *f;
+    uint32_t k;
+
+    if (ino >= LOGFS_FILE_MAX)
+        return;
+    f = &fs->files[ino];
+
+    if (LOGFS_CHUNK_HDR != tag->chunk) {
+        if ((ver < f->ver) || (tag->chunk >= LOGFS_FILE_CHUNKS))
+            return;
+        // the gc moved its header past it, the header comes later
+        if ((ver > f->ver) || !f->live) {
+            if (ver == f->ver)
+                return;
+            logfs_drop_chunks(fs, f, 0);
+            memset(f->drop, 0, sizeof(f->drop));
+            f->ver = ver;
+            f->live = TRUE;
+            f->size = 0;
+            f->hdr = LOGFS_NO_PAGE;
+        }
+        f->map[tag->chunk] = page;
+        f->size = MAX(f->size, tag->chunk * fs->page_size + tag->len);
+        return;
+    }
+
+    if (ver < f->ver)
+        return;
+
+    if (LOGFS_DELETED == tag->len) {
+        f->live = FALSE;
+        f->size = 0;
+        logfs_drop_chunks(fs, f, 0);
+    } else {
+        if ((logfs_read_page(fs, page, fs->page, tag) < 0)
+            || (tag->dcrc != logfs_crc32(fs->page, fs->page_size)))
+            return;
+        if (ver > f->ver)
+            logfs_drop_chunks(fs, f, 0);
+        f->live = TRUE;
+        f->size = tag->len;
+        memcpy(f->name, fs->page, LOGFS_NAME_MAX);
+        f->name[LOGFS_NAME_MAX - 1] = '\0';
+
+        // what a truncate cut off, its own header may be erased by now
+        memcpy(f->drop, fs->page + LOGFS_NAME_MAX, sizeof(f->drop));
+        for (k = 0; k < LOGFS_FILE_CHUNKS; k++) {
+            if ((LOGFS_NO_PAGE != f->map[k])
+                && (logfs_page_seq(fs, f->map[k]) < f->drop[k]))
+                f->map[k] = LOGFS_NO_PAGE;
+        }
+        logfs_drop_chunks(fs, f,
+            (f->size + fs->page_size - 1) / fs->page_size);
+    }
+    f->ver = ver;
+    f->hdr = page;
+}
+
+/*
+ * Only the newest page can be torn, so its data alone is checked. The
+ * open block goes on after its last page if that one is good and the
+ * page after it is still erased.
+ */
+static void logfs_scan_newest(logfs_t *fs, uint32_t blk)
+{
+    uint32_t used, i, page = blk * fs->ppb;
+    logfs_tag_t tag;
+
+    for (used = 0; used < fs->ppb; used++) {
+        logfs_read_page(fs, page + used, NULL, &tag);
+        if (logfs_tag_erased(fs))
+            break;
+    }
+
+    if (used && ((logfs_read_page(fs, page + used - 1, fs->page, &tag) < 0)
+        || (tag.dcrc != logfs_crc32(fs->page, fs->page_size)))) {
+        logfs_kill_page(fs, page + used - 1);
+        return;
+    }
+
+    if ((used == fs->ppb)
+        || (logfs_read_page(fs, page + used, fs->page, &tag) < 0))
+        return;
+    for (i = 0; i < fs->page_size; i++) {
+        if (0xff != fs->page[i])
+            return;
+    }
+
+    fs->blocks[blk].state = LOGFS_BLK_OPEN;
+    fs->blocks[blk].erased = FALSE;
+    fs->head = page + used;
+}
+
+static status_t logfs_check(logfs_t *fs, nand_t *nand, uint32_t first,
+    uint32_t nr)
+{
+    if ((nr > LOGFS_BLOCK_MAX) || (first + nr > nand->nr_blocks)
+        || (nand->page_size > LOGFS_PAGE_MAX)
+        || (nand->page_size < LOGFS_NAME_MAX + sizeof(fs->files[0].drop))
+        || (nand->oob_size < sizeof(logfs_tag_t))
+        || (nand->oob_size > sizeof(fs->oob)))
+        return LOGFS_ERR_INVAL;
+    return LOGFS_OK;
+}
+
+status_t logfs_mount(logfs_t *fs, nand_t *nand, uint32_t first, uint32_t nr)
+{
+    uint32_t blk, n = 0, i, page;
+    uint32_t ec_sum = 0, ec_nr = 0;
+    logfs_block_t *b;
+    logfs_tag_t tag;
+
+    if (LOGFS_OK != logfs_check(fs, nand, first, nr))
+        return LOGFS_ERR_INVAL;
+
+    memset(fs, 0, sizeof(*fs));
+    INIT_SPINLOCK(&fs->lock);
+    INIT_LIST_HEAD(&fs->waiters);
+    INIT_LIST_HEAD(&fs->gc_node);
+    fs->nand = nand;
+    fs->first = first;
+    fs->nr_blocks = nr;
+    fs->ppb = nand->pages_per_block;
+    fs->page_size = nand->page_size;
+    fs->head = LOGFS_NO_PAGE;
+    for (i = 0; i < LOGFS_FILE_MAX; i++) {
+        fs->files[i].hdr = LOGFS_NO_PAGE;
+        memset(fs->files[i].map, 0xff, sizeof(fs->files[i].map));
+    }
+
+    // the first spare of each block gives its state, seq and wear
+    for (blk = 0; blk < nr; blk++) {
+        b = &fs->blocks[blk];
+        if (nand_is_bad(nand, first + blk)) {
+            b->state = LOGFS_BLK_BAD;
+            continue;
+        }
+
+        logfs_read_page(fs, blk * fs->ppb, NULL, &tag);
+        if (logfs_tag_erased(fs)) {
+            b->state = LOGFS_BLK_FREE;
+            b->ec = LOGFS_NO_PAGE;
+            ++fs->free_blocks;
+        } else if (logfs_tag_valid(&tag)) {
+            b->state = LOGFS_BLK_FULL;
+            b->seq = tag.seq;
+            b->ec = tag.ec;
+            ec_sum += tag.ec;
+            ++ec_nr;
+            fs->order[n++] = blk;
+        } else {
+            // half erased, whatever it held was moved before the erase
+            b->state = LOGFS_BLK_FULL;
+            b->ec = LOGFS_NO_PAGE;
+        }
+    }
+
+    // free blocks keep no erase count on flash, assume the average
+    for (blk = 0; blk < nr; blk++) {
+        if (LOGFS_NO_PAGE == fs->blocks[blk].ec)
+            fs->blocks[blk].ec = ec_nr ? ec_sum / ec_nr : 0;
+    }
+
+    logfs_sort(fs, n);
+    if (n)
+        logfs_scan_newest(fs, fs->order[n - 1]);
+
+    for (i = 0; i < n; i++) {
+        for (page = fs->order[i] * fs->ppb;
+            page < (fs->order[i] + 1) * fs->ppb; page++) {
+            if (logfs_read_page(fs, page, NULL, &tag) < 0)
+                continue;
+            if (logfs_tag_erased(fs))
+                break;
+            if (!logfs_tag_valid(&tag))
+                continue;
+            fs->seq = MAX(fs->seq, tag.seq + 1);
+            logfs_replay(fs, page, &tag);
+        }
+    }
+
+    // chunks whose header never made it belong to no file
+    for (i = 0; i < LOGFS_FILE_MAX; i++) {
+        if (fs->files[i].live && (LOGFS_NO_PAGE == fs->files[i].hdr)) {
+            fs->files[i].live = FALSE;
+            fs->files[i].size = 0;
+            logfs_drop_chunks(fs, &fs->files[i], 0);
+        }
+    }
+
+    // what the index points at is all that is valid
+    for (blk = 0; blk < nr; blk++)
+        fs->blocks[blk].valid = 0;
+    for (i = 0; i < LOGFS_FILE_MAX; i++) {
+        if (LOGFS_NO_PAGE != fs->files[i].hdr)
+            ++fs->blocks[fs->files[i].hdr / fs->ppb].valid;
+        for (page = 0; page < LOGFS_FILE_CHUNKS; page++) {
+            if (LOGFS_NO_PAGE != fs->files[i].map[page])
+                ++fs->blocks[fs->files[i].map[page] / fs->ppb].valid;
+        }
+    }
+
+    fs->mounted = TRUE;
+    if (fs->free_blocks < LOGFS_GC_LOW)
+        logfs_gc_kick(fs);
+    return LOGFS_OK;
+}
+
+status_t logfs_format(logfs_t *fs, nand_t *nand, uint32_t first,
+    uint32_t nr)
+{
+    if (LOGFS_OK != logfs_check(fs, nand, first, nr))
+        return LOGFS_ERR_INVAL;
+
+    for (uint32_t blk = first; blk < first + nr; blk++) {
+        if (!nand_is_bad(nand, blk) && (NAND_OK != nand_erase(nand, blk)))
+            nand_mark_bad(nand, blk);
+    }
+
+    return logfs_mount(fs, nand, first, nr);
+}
+
+void logfs_unmount(logfs_t *fs)
+{
+    logfs_lock(fs);
+    fs->mounted = FALSE;
+
+    task_lock();
+    spin_lock(&logfs_gc_lock);
+    if (fs->gc_queued) {
+        LIST_DEL(&fs->gc_node);
+        fs->gc_queued = FALSE;
+    }
+    spin_unlock(&logfs_gc_lock);
+    task_unlock();
+
+    logfs_unlock(fs);
+}
+
+/*--------------------------------------------------------------------------*/
+
+int32_t logfs_open(logfs_t *fs, const char *name, bool_t create)
+{
+    uint32_t len = strlen(name);
+    int32_t ino, slot = -1;
+    logfs_file_t *f;
+    status_t st;
+
+    if ((0 == len) || (len >= LOGFS_NAME_MAX))
+        return LOGFS_ERR_INVAL;
+
+    logfs_lock(fs);
+
+    for (ino = 0; ino < LOGFS_FILE_MAX; ino++) {
+        f = &fs->files[ino];
+        if (f->live && (0 == strcmp(f->name, name))) {
+            logfs_unlock(fs);
+            return ino;
+        }
+        if (!f->live && (slot < 0))
+            slot = ino;
+    }
+
+    if (!fs->mounted || !create || (slot < 0)) {
+        logfs_unlock(fs);
+        return (fs->mounted && create) ? LOGFS_ERR_NOSPC : LOGFS_ERR_NOENT;
+    }
+
+    // a new version, whatever the slot held before no longer replays
+    f = &fs->files[slot];
+    logfs_make_room(fs);
+    memcpy(f->name, name, len + 1);
+    f->live = TRUE;
+    f->size = 0;
+    ++f->ver;
+    memset(f->drop, 0, sizeof(f->drop));
+    st = logfs_write_header(fs, slot, LOGFS_FILE_CHUNKS);
+    if (LOGFS_OK != st) {
+        --f->ver;
+        f->live = FALSE;
+    }
+
+    logfs_unlock(fs);
+    return (LOGFS_OK == st) ? slot : st;
+}
+
+status_t logfs_remove(logfs_t *fs, const char *name)
+{
+    logfs_file_t *f;
+    status_t st;
+    int32_t ino;
+
+    ino = logfs_open(fs, name, FALSE);
+    if (ino < 0)
+        return ino;
+
+    logfs_lock(fs);
+    f = &fs->files[ino];
+    logfs_make_room(fs);
+    f->live = FALSE;
+    st = logfs_write_header(fs, ino, LOGFS_FILE_CHUNKS);
+    if (LOGFS_OK == st) {
+        f->size = 0;
+        logfs_drop_chunks(fs, f, 0);
+    } else {
+        f->live = TRUE;
+    }
+    logfs_unlock(fs);
+
+    return st;
+}
+
+static logfs_file_t *logfs_file(logfs_t *fs, int32_t ino)
+{
+    if (!fs->mounted || (ino < 0) || (ino >= LOGFS_FILE_MAX)
+        || !fs->files[ino].live)
+        return NULL;
+    return &fs->files[ino];
+}
+
+int32_t logfs_read(logfs_t *fs, int32_t ino, uint32_t pos, void *buf,
+    uint32_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    uint32_t k, off, n, done = 0;
+    status_t st = LOGFS_OK;
+    logfs_file_t *f;
+    logfs_tag_t tag;
+
+    logfs_lock(fs);
+
+    f = logfs_file(fs, ino);
+    if (NULL == f) {
+        logfs_unlock(fs);
+        return LOGFS_ERR_NOENT;
+    }
+
+    if (pos >= f->size)
+        len = 0;
+    len = MIN(len, f->size - pos);
+
+    while (done < len) {
+        k = (pos + done) / fs->page_size;
+        off = (pos + done) % fs->page_size;
+        n = MIN(fs->page_size - off, len - done);
+
+        if (LOGFS_NO_PAGE == f->map[k]) {
+            memset(p + done, 0, n);
+        } else if (n == fs->page_size) {
+            // whole pages straight into the caller's buffer
+            st = nand_read(fs->nand, logfs_nand_page(fs, f->map[k]),
+                p + done, NULL);
+        } else {
+            st = logfs_read_page(fs, f->map[k], fs->page, &tag);
+            memcpy(p + done, fs->page + off, n);
+        }
+
+        if (st < 0) {
+            st = LOGFS_ERR_IO;
+            break;
+        }
+        st = LOGFS_OK;
+        done += n;
+    }
+
+    logfs_unlock(fs);
+    return done ? (int32_t)done : st;
+}
+
+/* chunk 'k' again with only its first 'len' bytes, the rest zero */
+static status_t logfs_cut_chunk(logfs_t *fs, int32_t ino, uint32_t k,
+    uint32_t len)
+{
+    logfs_file_t *f = &fs->files[ino];
+    logfs_tag_t tag;
+    uint32_t page;
+    status_t st;
+
+    if ((0 == len) || (LOGFS_NO_PAGE == f->map[k]))
+        return LOGFS_OK;
+
+    logfs_make_room(fs);
+    if (logfs_read_page(fs, f->map[k], fs->page, &tag) < 0)
+        return LOGFS_ERR_IO;
+    if (tag.len <= len)
+        return LOGFS_OK;
+
+    memset(fs->page + len, 0, fs->page_size - len);
+    st = logfs_append(fs, TAG_ID(ino, f->ver), k, len, fs->page, FALSE,
+        &page);
+    if (LOGFS_OK == st) {
+        logfs_invalidate(fs, f->map[k]);
+        f->map[k] = page;
+    }
+    return st;
+}
+
+/*
+ * Every chunk touched is written anew. A partial one is read back first,
+ * past the end of the file it reads as zeros.
+ */
+int32_t logfs_write(logfs_t *fs, int32_t ino, uint32_t pos,
+    const void *buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t k, off, n, valid, page, done = 0;
+    uint32_t max = LOGFS_FILE_CHUNKS * fs->page_size;
+    status_t st = LOGFS_OK;
+    const void *data;
+    logfs_file_t *f;
+    logfs_tag_t tag;
+
+    logfs_lock(fs);
+
+    f = logfs_file(fs, ino);
+    if (NULL == f) {
+        logfs_unlock(fs);
+        return LOGFS_ERR_NOENT;
+    }
+    if (pos >= max) {
+        logfs_unlock(fs);
+        return LOGFS_ERR_NOSPC;
+    }
+    len = MIN(len, max - pos);
+
+    // a hole starts past the old end, whatever a cut left there goes
+    if ((pos > f->size) && (pos / fs->page_size != f->size / fs->page_size))
+        st = logfs_cut_chunk(fs, ino, f->size / fs->page_size,
+            f->size % fs->page_size);
+
+    while ((LOGFS_OK == st) && (done < len)) {
+        k = (pos + done) / fs->page_size;
+        off = (pos + done) % fs->page_size;
+        n = MIN(fs->page_size - off, len - done);
+        valid = (f->size > k * fs->page_size) ?
+            MIN(fs->page_size, f->size - k * fs->page_size) : 0;
+
+        logfs_make_room(fs);
+
+        if (n == fs->page_size) {
+            data = p + done;
+        } else {
+            if (LOGFS_NO_PAGE == f->map[k]) {
+                memset(fs->page, 0, fs->page_size);
+            } else if (logfs_read_page(fs, f->map[k], fs->page, &tag) < 0) {
+                st = LOGFS_ERR_IO;
+                break;
+            } else {
+                memset(fs->page + valid, 0, fs->page_size - valid);
+            }
+            memcpy(fs->page + off, p + done, n);
+            data = fs->page;
+        }
+
+        st = logfs_append(fs, TAG_ID(ino, f->ver), k, MAX(valid, off + n),
+            data, FALSE, &page);
+        if (LOGFS_OK != st)
+            break;
+
+        logfs_invalidate(fs, f->map[k]);
+        f->map[k] = page;
+        f->size = MAX(f->size, k * fs->page_size + MAX(valid, off + n));
+        done += n;
+    }
+
+    if (fs->free_blocks < LOGFS_GC_LOW)
+        logfs_gc_kick(fs);
+
+    logfs_unlock(fs);
+    return done ? (int32_t)done : st;
+}
+
+/*
+ * The chunk holding the smaller end is written again with a zero tail,
+ * so an extension reads zeros there. Growing does that before the
+ * header, shrinking after it, a cut between the two is harmless. The
+ * header of a shrink drops the chunks past the end for good, see
+ * logfs_file_t.
+ */
+status_t logfs_truncate(logfs_t *fs, int32_t ino, uint32_t size)
+{
+    uint32_t old, end, cut = LOGFS_FILE_CHUNKS;
+    status_t st = LOGFS_OK;
+    logfs_file_t *f;
+
+    logfs_lock(fs);
+
+    f = logfs_file(fs, ino);
+    if (NULL == f) {
+        logfs_unlock(fs);
+        return LOGFS_ERR_NOENT;
+    }
+    if (size > LOGFS_FILE_CHUNKS * fs->page_size) {
+        logfs_unlock(fs);
+        return LOGFS_ERR_INVAL;
+    }
+
+    old = f->size;
+    end = MIN(old, size);
+    if (size > old)
+        st = logfs_cut_chunk(fs, ino, end / fs->page_size,
+            end % fs->page_size);
+    else if (size < old)
+        cut = (size + fs->page_size - 1) / fs->page_size;
+
+    if (LOGFS_OK == st) {
+        logfs_make_room(fs);
+        f->size = size;
+        st = logfs_write_header(fs, ino, cut);
+        if (LOGFS_OK != st)
+            f->size = old;
+    }
+
+    if ((LOGFS_OK == st) && (size < old)) {
+        logfs_drop_chunks(fs, f, cut);
+        st = logfs_cut_chunk(fs, ino, end / fs->page_size,
+            end % fs->page_size);
+    }
+
+    logfs_unlock(fs);
+    return st;
+}
+
+int32_t logfs_size(logfs_t *fs, int32_t ino)
+{
+    logfs_file_t *f;
+    int32_t size;
+
+    logfs_lock(fs);
+    f = logfs_file(fs, ino);
+    size = f ? (int32_t)f->size : LOGFS_ERR_NOENT;
+    logfs_unlock(fs);
+
+    return size;
+}
+
+bool_t logfs_gc(logfs_t *fs)
+{
+    bool_t done;
+
+    logfs_lock(fs);
+    done = fs->mounted ? logfs_gc_step(fs, LOGFS_GC_GREEDY) : FALSE;
+    logfs_unlock(fs);
+
+    return done;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF logfs.c
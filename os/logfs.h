@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_LOGFS_H_
+#define _MINIOS_LOGFS_H_
+
+#include "os/nand.h"
+#include "os/task.h"
+
+/* the in-ram index is sized by these, see logfs_t */
+#ifndef LOGFS_PAGE_MAX
+#define LOGFS_PAGE_MAX          2048
+#endif
+#ifndef LOGFS_BLOCK_MAX
+#define LOGFS_BLOCK_MAX         256
+#endif
+#ifndef LOGFS_FILE_MAX
+#define LOGFS_FILE_MAX          16
+#endif
+#ifndef LOGFS_FILE_CHUNKS
+#define LOGFS_FILE_CHUNKS       64      /* pages a file may span */
+#endif
+#ifndef LOGFS_NAME_MAX
+#define LOGFS_NAME_MAX          24      /* with the terminating nul */
+#endif
+
+/* free blocks only the garbage collector may take */
+#ifndef LOGFS_RESERVE_BLOCKS
+#define LOGFS_RESERVE_BLOCKS    2
+#endif
+
+/* the gc task is woken below LOW and collects up to HIGH free blocks */
+#ifndef LOGFS_GC_LOW
+#define LOGFS_GC_LOW            (LOGFS_RESERVE_BLOCKS + 2)
+#endif
+#ifndef LOGFS_GC_HIGH
+#define LOGFS_GC_HIGH           (LOGFS_RESERVE_BLOCKS + 4)
+#endif
+
+/* erase count spread that makes the gc move cold data */
+#ifndef LOGFS_WEAR_DELTA
+#define LOGFS_WEAR_DELTA        16
+#endif
+
+#ifndef LOGFS_GC_PRIORITY
+#define LOGFS_GC_PRIORITY       (SCHED_BACKGROUND_PRIORITY - 1)
+#endif
+
+#define LOGFS_OK                0
+#define LOGFS_ERR_IO            -1
+#define LOGFS_ERR_NOSPC         -2
+#define LOGFS_ERR_NOENT         -3
+#define LOGFS_ERR_INVAL         -4
+
+/*
+ * Written to the spare area of every page with the page. 'seq' orders
+ * all pages ever written, the mount replays them in that order. The
+ * header of a file is chunk LOGFS_CHUNK_HDR, its 'len' is the file size
+ * and its data the name, followed at LOGFS_NAME_MAX by the drop table of
+ * logfs_file_t.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t id;                /* ino << 24 | version */
+    uint32_t chunk;
+    uint32_t len;               /* bytes of the chunk in use */
+    uint32_t ec;                /* erase count of the block */
+    uint32_t dcrc;              /* of the page data */
+    uint32_t tcrc;              /* of the fields above */
+} logfs_tag_t;
+
+typedef struct {
+    uint32_t ec;
+    uint32_t valid;             /* pages still referenced */
+    uint32_t seq;               /* of its first page */
+    uint8_t state;
+    bool_t erased;              /* known clean, erased since the mount */
+} logfs_block_t;
+
+typedef struct {
+    char name[LOGFS_NAME_MAX];
+    uint32_t ver;
+    uint32_t size;
+    uint32_t hdr;               /* page of the header, also for removed */
+    bool_t live;
+    uint32_t map[LOGFS_FILE_CHUNKS];
+    /*
+     * Pages of a chunk older than this were cut off by a truncate. Every
+     * header carries it, the one that did the cut may be erased after
+     * the gc moved it while the old chunks are still on the flash.
+     */
+    uint32_t drop[LOGFS_FILE_CHUNKS];
+} logfs_file_t;
+
+typedef struct logfs {
+    nand_t *nand;
+    uint32_t first;             /* first nand block of the partition */
+    uint32_t nr_blocks;
+    uint32_t ppb;
+    uint32_t page_size;
+    uint32_t seq;               /* of the next page written */
+    uint32_t head;              /* next page of the open block */
+    uint32_t free_blocks;
+    bool_t mounted;
+    spinlock_t lock;            /* 'locked' and the waiters */
+    bool_t locked;
+    bool_t gc_queued;
+    list_head_t waiters;
+    list_head_t gc_node;
+    uint32_t gc_runs;
+    uint32_t gc_moved;
+    uint32_t erases;
+    uint32_t lost;              /* chunks the gc could not read back */
+    logfs_block_t blocks[LOGFS_BLOCK_MAX];
+    logfs_file_t files[LOGFS_FILE_MAX];
+    uint32_t order[LOGFS_BLOCK_MAX];
+    uint8_t page[LOGFS_PAGE_MAX] __attribute__((aligned(32)));
+    uint8_t oob[LOGFS_PAGE_MAX / 32];
+} logfs_t;
+
+/*
+ * All in task context, 'nr' blocks from 'first' on make the partition.
+ * Everything written is appended to the open block, the mount rebuilds
+ * the index from the spare areas and drops a page torn by a power cut.
+ */
+status_t logfs_format(logfs_t *fs, nand_t *nand, uint32_t first,
+    uint32_t nr);
+status_t logfs_mount(logfs_t *fs, nand_t *nand, uint32_t first, uint32_t nr);
+void logfs_unmount(logfs_t *fs);
+
+/* the file number, or an error */
+int32_t logfs_open(logfs_t *fs, const char *name, bool_t create);
+status_t logfs_remove(logfs_t *fs, const char *name);
+
+/* bytes done, or an error */
+int32_t logfs_read(logfs_t *fs, int32_t ino, uint32_t pos, void *buf,
+    uint32_t len);
+int32_t logfs_write(logfs_t *fs, int32_t ino, uint32_t pos,
+    const void *buf, uint32_t len);
+
+status_t logfs_truncate(logfs_t *fs, int32_t ino, uint32_t size);
+int32_t logfs_size(logfs_t *fs, int32_t ino);
+
+/* one garbage collection pass by hand, FALSE if nothing was reclaimed */
+bool_t logfs_gc(logfs_t *fs);
+
+#endif // _MINIOS_LOGFS_H_
+// EOF logfs.h
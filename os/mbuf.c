@@ -0,0 +1,353 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/mbuf.h"
+#include "os/spinlock.h"
+#include "os/string.h"
+#include "port/port.h"
+
+static mbuf_t mbuf_pool[MBUF_NR];
+static mbuf_data_t mbuf_data_pool[MBUF_DATA_NR] NOINIT_SECTION;
+
+/*
+ * Free lists, plus the tail of each pool never handed out yet, so the
+ * pool needs no setting up and drivers may take buffers at any time.
+ * Refcounts change under the same lock.
+ */
+static spinlock_t mbuf_lock = SPINLOCK_INIT;
+static mbuf_t *mbuf_free_list;
+static mbuf_data_t *mbuf_data_free_list;
+static uint32_t mbuf_fresh;
+static uint32_t mbuf_data_fresh;
+static uint32_t mbuf_free_nr = MBUF_NR;
+static uint32_t mbuf_data_free_nr = MBUF_DATA_NR;
+static uint32_t mbuf_failures;
+
+/*--------------------------------------------------------------------------*/
+
+/* mbuf_lock held */
+static mbuf_t *mbuf_hdr_get(void)
+{
+    mbuf_t *m = mbuf_free_list;
+
+    if (NULL != m)
+        mbuf_free_list = m->next;
+    else if (mbuf_fresh < MBUF_NR)
+        m = &mbuf_pool[mbuf_fresh++];
+    else
+        return NULL;
+
+    --mbuf_free_nr;
+    return m;
+}
+
+static void mbuf_hdr_put(mbuf_t *m)
+{
+    m->next = mbuf_free_list;
+    mbuf_free_list = m;
+    ++mbuf_free_nr;
+}
+
+static mbuf_data_t *mbuf_data_get(void)
+{
+    mbuf_data_t *d = mbuf_data_free_list;
+
+    if (NULL != d)
+        mbuf_data_free_list = d->next_free;
+    else if (mbuf_data_fresh < MBUF_DATA_NR)
+        d = &mbuf_data_pool[mbuf_data_fresh++];
+    else
+        return NULL;
+
+    --mbuf_data_free_nr;
+    d->refs = 1;
+    return d;
+}
+
+static void mbuf_data_put(mbuf_data_t *d)
+{
+    d->next_free = mbuf_data_free_list;
+    mbuf_data_free_list = d;
+    ++mbuf_data_free_nr;
+}
+
+/*--------------------------------------------------------------------------*/
+
+mbuf_t *mbuf_alloc(uint32_t headroom)
+{
+    cpu_flags_t flags;
+    mbuf_data_t *d = NULL;
+    mbuf_t *m;
+
+    if (headroom > MBUF_DATA_SIZE)
+        return NULL;
+
+    flags = spin_lock_irqsave(&mbuf_lock);
+    m = mbuf_hdr_get();
+    if (NULL != m) {
+        d = mbuf_data_get();
+        if (NULL == d) {
+            mbuf_hdr_put(m);
+            m = NULL;
+        }
+    }
+    if (NULL == m)
+        ++mbuf_failures;
+    spin_unlock_irqrestore(&mbuf_lock, flags);
+
+    if (NULL == m)
+        return NULL;
+
+    m->next = NULL;
+    m->nextpkt = NULL;
+    m->area = d;
+    m->data = d->buf + headroom;
+    m->len = 0;
+    m->pkt_len = 0;
+    m->ifp = NULL;
+    return m;
+}
+
+mbuf_t *mbuf_clone(mbuf_t *m)
+{
+    mbuf_t *head = NULL, **link = &head, *c;
+    cpu_flags_t flags = spin_lock_irqsave(&mbuf_lock);
+
+    for (; NULL != m; m = m->next) {
+        c = mbuf_hdr_get();
+        if (NULL == c)
+            break;
+        *c = *m;
+        c->next = NULL;
+        c->nextpkt = NULL;
+        ++c->area->refs;
+        *link = c;
+        link = &c->next;
+    }
+
+    // short of headers, the original still holds every area
+    if (NULL != m) {
+        ++mbuf_failures;
+        while (NULL != head) {
+            c = head;
+            head = c->next;
+            --c->area->refs;
+            mbuf_hdr_put(c);
+        }
+    }
+
+    spin_unlock_irqrestore(&mbuf_lock, flags);
+
+    return head;
+}
+
+void mbuf_free(mbuf_t *m)
+{
+    cpu_flags_t flags;
+    mbuf_t *nxt;
+
+    flags = spin_lock_irqsave(&mbuf_lock);
+    for (; NULL != m; m = nxt) {
+        nxt = m->next;
+        if (0 == --m->area->refs)
+            mbuf_data_put(m->area);
+        mbuf_hdr_put(m);
+    }
+    spin_unlock_irqrestore(&mbuf_lock, flags);
+}
+
+/*--------------------------------------------------------------------------*/
+
+uint8_t *mbuf_push(mbuf_t *m, uint32_t len)
+{
+    // the headroom of a shared area may be another clone's header
+    if (!mbuf_writable(m) || (mbuf_headroom(m) < len))
+        return NULL;
+
+    m->data -= len;
+    m->len += len;
+    m->pkt_len += len;
+    return m->data;
+}
+
+uint8_t *mbuf_pull(mbuf_t *m, uint32_t len)
+{
+    if (m->len < len)
+        return NULL;
+
+    m->data += len;
+    m->len -= len;
+    m->pkt_len -= len;
+    return m->data;
+}
+
+uint8_t *mbuf_put(mbuf_t *m, uint32_t len)
+{
+    mbuf_t *last = m;
+    uint8_t *p;
+
+    while (NULL != last->next)
+        last = last->next;
+
+    if (!mbuf_writable(last) || (mbuf_tailroom(last) < len))
+        return NULL;
+
+    p = last->data + last->len;
+    last->len += len;
+    m->pkt_len += len;
+    return p;
+}
+
+mbuf_t *mbuf_prepend(mbuf_t *m, uint32_t len)
+{
+    mbuf_t *n;
+
+    if (NULL != mbuf_push(m, len))
+        return m;
+
+    n = (len <= MBUF_DATA_SIZE - MBUF_HEADROOM)
+        ? mbuf_alloc(MBUF_HEADROOM + len) : NULL;
+    if (NULL == n) {
+        mbuf_free(m);
+        return NULL;
+    }
+
+    n->next = m;
+    n->pkt_len = m->pkt_len;
+    n->ifp = m->ifp;
+    mbuf_push(n, len);
+    return n;
+}
+
+bool_t mbuf_pullup(mbuf_t *m, uint32_t len)
+{
+    uint32_t need, n;
+    mbuf_t *nxt;
+
+    if (m->len >= len)
+        return TRUE;
+    if ((len > m->pkt_len) || (len > MBUF_DATA_SIZE) || !mbuf_writable(m))
+        return FALSE;
+
+    need = len - m->len;
+    if (mbuf_tailroom(m) < need) {
+        memmove(m->area->buf, m->data, m->len);
+        m->data = m->area->buf;
+    }
+
+    while (need > 0) {
+        nxt = m->next;
+        n = MIN(need, nxt->len);
+        memcpy(m->data + m->len, nxt->data, n);
+        m->len += n;
+        nxt->data += n;
+        nxt->len -= n;
+        need -= n;
+
+        if (0 == nxt->len) {
+            m->next = nxt->next;
+            nxt->next = NULL;
+            mbuf_free(nxt);
+        }
+    }
+
+    return TRUE;
+}
+
+void mbuf_trim(mbuf_t *m, uint32_t len)
+{
+    uint32_t rest = len;
+    mbuf_t *n = m;
+
+    if (len >= m->pkt_len)
+        return;
+
+    while (rest > n->len) {
+        rest -= n->len;
+        n = n->next;
+    }
+    n->len = rest;
+    if (NULL != n->next) {
+        mbuf_free(n->next);
+        n->next = NULL;
+    }
+    m->pkt_len = len;
+}
+
+void mbuf_cat(mbuf_t *m, mbuf_t *n)
+{
+    mbuf_t *last = m;
+
+    while (NULL != last->next)
+        last = last->next;
+
+    last->next = n;
+    m->pkt_len += n->pkt_len;
+}
+
+/*--------------------------------------------------------------------------*/
+
+mbuf_t *mbuf_copy_in(uint32_t headroom, const void *buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    mbuf_t *m, *last, *n;
+    uint32_t room;
+
+    m = last = mbuf_alloc(headroom);
+    if (NULL == m)
+        return NULL;
+
+    while (1) {
+        room = MIN(mbuf_tailroom(last), len);
+        memcpy(last->data + last->len, p, room);
+        last->len += room;
+        m->pkt_len += room;
+        p += room;
+        len -= room;
+
+        if (0 == len)
+            return m;
+
+        n = mbuf_alloc(0);
+        if (NULL == n) {
+            mbuf_free(m);
+            return NULL;
+        }
+        last->next = n;
+        last = n;
+    }
+}
+
+uint32_t mbuf_copy_out(mbuf_t *m, uint32_t off, void *buf, uint32_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    uint32_t done = 0, n;
+
+    for (; (NULL != m) && (done < len); m = m->next) {
+        if (off >= m->len) {
+            off -= m->len;
+            continue;
+        }
+        n = MIN(m->len - off, len - done);
+        memcpy(p + done, m->data + off, n);
+        done += n;
+        off = 0;
+    }
+
+    return done;
+}
+
+void mbuf_get_stats(uint32_t *free_bufs, uint32_t *free_data,
+    uint32_t *failures)
+{
+    *free_bufs = mbuf_free_nr;
+    *free_data = mbuf_data_free_nr;
+    *failures = mbuf_failures;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF mbuf.c
@@ -0,0 +1,148 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_MBUF_H_
+#define _MINIOS_MBUF_H_
+
+#include "os/minios_type.h"
+
+/* buffer headers, and the data areas they point into */
+#ifndef MBUF_NR
+#define MBUF_NR                 64
+#endif
+#ifndef MBUF_DATA_NR
+#define MBUF_DATA_NR            32
+#endif
+
+/* a full ethernet frame behind the headroom, a multiple of 32 */
+#ifndef MBUF_DATA_SIZE
+#define MBUF_DATA_SIZE          1600
+#endif
+
+/* left in front of new data for the headers of the layers below */
+#ifndef MBUF_HEADROOM
+#define MBUF_HEADROOM           64
+#endif
+
+/*
+ * Packet data lives in refcounted areas, an mbuf is a window on one.
+ * Clones share the areas of a packet and copy nothing, so shared data is
+ * read only: mbuf_push() refuses it and mbuf_prepend() puts the headers
+ * in a buffer of their own. A packet is a chain of buffers through
+ * 'next', its length is kept in the first one.
+ */
+typedef struct mbuf_data {
+    struct mbuf_data *next_free;
+    volatile uint32_t refs;
+    uint8_t buf[MBUF_DATA_SIZE] __attribute__((aligned(32)));
+} mbuf_data_t;
+
+struct netif;
+
+typedef struct mbuf {
+    struct mbuf *next;          /* the rest of the packet */
+    struct mbuf *nextpkt;       /* the packet after it in a queue */
+    mbuf_data_t *area;
+    uint8_t *data;
+    uint32_t len;               /* of this buffer */
+    uint32_t pkt_len;           /* of the packet, in its first buffer */
+    struct netif *ifp;          /* received on */
+    uint32_t cb[4];             /* scratch of the layer holding the packet */
+} mbuf_t;
+
+/* a fifo of packets, for the owner's lock to protect */
+typedef struct {
+    mbuf_t *head;
+    mbuf_t *tail;
+    uint32_t len;
+} mbuf_queue_t;
+
+#define MBUF_QUEUE_INIT         {NULL, NULL, 0}
+
+static inline void mbuf_enqueue(mbuf_queue_t *q, mbuf_t *m)
+{
+    m->nextpkt = NULL;
+    if (NULL == q->tail)
+        q->head = m;
+    else
+        q->tail->nextpkt = m;
+    q->tail = m;
+    ++q->len;
+}
+
+static inline mbuf_t *mbuf_dequeue(mbuf_queue_t *q)
+{
+    mbuf_t *m = q->head;
+
+    if (NULL != m) {
+        q->head = m->nextpkt;
+        if (NULL == q->head)
+            q->tail = NULL;
+        m->nextpkt = NULL;
+        --q->len;
+    }
+    return m;
+}
+
+static inline bool_t mbuf_writable(mbuf_t *m)
+{
+    return (1 == m->area->refs) ? TRUE : FALSE;
+}
+
+static inline uint32_t mbuf_headroom(mbuf_t *m)
+{
+    return m->data - m->area->buf;
+}
+
+static inline uint32_t mbuf_tailroom(mbuf_t *m)
+{
+    return m->area->buf + MBUF_DATA_SIZE - (m->data + m->len);
+}
+
+/*
+ * Any context. An empty packet with 'headroom' bytes in front, or a
+ * clone of a whole packet; NULL once the pool runs dry.
+ */
+mbuf_t *mbuf_alloc(uint32_t headroom);
+mbuf_t *mbuf_clone(mbuf_t *m);
+
+/* the whole chain, a data area goes back with its last holder */
+void mbuf_free(mbuf_t *m);
+
+/*
+ * In place on 'm', the first buffer of a packet, NULL if it does not
+ * fit. push() opens up room for a header in front and pull() strips
+ * one, put() adds to the tail of the last buffer.
+ */
+uint8_t *mbuf_push(mbuf_t *m, uint32_t len);
+uint8_t *mbuf_pull(mbuf_t *m, uint32_t len);
+uint8_t *mbuf_put(mbuf_t *m, uint32_t len);
+
+/*
+ * Room for a 'len' byte header, in a new first buffer if need be. The
+ * packet to go on with, or NULL with the packet freed.
+ */
+mbuf_t *mbuf_prepend(mbuf_t *m, uint32_t len);
+
+/* the first 'len' bytes made contiguous, copying only those */
+bool_t mbuf_pullup(mbuf_t *m, uint32_t len);
+
+/* cut the packet down to 'len' bytes */
+void mbuf_trim(mbuf_t *m, uint32_t len);
+
+/* 'n' appended to 'm', the chain owns it */
+void mbuf_cat(mbuf_t *m, mbuf_t *n);
+
+/* a packet holding a copy of 'buf', and bytes of a packet copied out */
+mbuf_t *mbuf_copy_in(uint32_t headroom, const void *buf, uint32_t len);
+uint32_t mbuf_copy_out(mbuf_t *m, uint32_t off, void *buf, uint32_t len);
+
+void mbuf_get_stats(uint32_t *free_bufs, uint32_t *free_data,
+    uint32_t *failures);
+
+#endif // _MINIOS_MBUF_H_
+// EOF mbuf.h
@@ -53,6 +53,11 @@ typedef unsigned long address_t;
 #define USER_SECTION(__sect__) __attribute__ ((unused,section (__sect__)))
 #endif
 
+/* neither stored in the image nor cleared at boot, for stacks and buffers */
+#if !defined(NOINIT_SECTION)
+#define NOINIT_SECTION __attribute__ ((section (".noinit")))
+#endif
+
 #define ALIGN_DOWN(val, size) ((val) & (~((size)-1)))
 #define ALIGN_UP(val, size)   (((val)+(size)-1) & ~((size)-1))
 
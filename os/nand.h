@@ -0,0 +1,125 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_NAND_H_
+#define _MINIOS_NAND_H_
+
+#include "os/minios_type.h"
+
+/* results of the nand operations */
+#define NAND_OK             0
+#define NAND_CORRECTED      1   /* bit errors the ecc fixed, data is good */
+#define NAND_ERROR          -1  /* program or erase failed, block wears out */
+#define NAND_ECC_ERROR      -2  /* more bit errors than the ecc can fix */
+
+struct nand;
+
+/*
+ * Synchronous, task context. read() skips 'data' or 'oob' when it is
+ * NULL, program() writes 0xff there. Ecc and the bad block marker are
+ * the driver's business; 'oob' is only the spare bytes left to users.
+ */
+typedef struct nand_ops {
+    status_t (*read)(struct nand *, uint32_t page, void *data, void *oob);
+    status_t (*program)(struct nand *, uint32_t page, const void *data,
+        const void *oob);
+    status_t (*erase)(struct nand *, uint32_t block);
+    bool_t (*is_bad)(struct nand *, uint32_t block);
+    status_t (*mark_bad)(struct nand *, uint32_t block);
+
+    /*
+     * Optional, 'nr' pages from 'page' on with their data back to back,
+     * and the oob too unless it is NULL. A driver overlaps the transfer
+     * of one page with the chip fetching or programming the next.
+     */
+    status_t (*read_pages)(struct nand *, uint32_t page, uint32_t nr,
+        void *data, void *oob);
+    status_t (*program_pages)(struct nand *, uint32_t page, uint32_t nr,
+        const void *data, const void *oob);
+} nand_ops_t;
+
+typedef struct nand {
+    const char *name;
+    const nand_ops_t *ops;
+    void *priv;
+    uint32_t page_size;
+    uint32_t oob_size;          /* free spare bytes per page */
+    uint32_t pages_per_block;
+    uint32_t nr_blocks;
+} nand_t;
+
+static inline status_t nand_read(nand_t *nand, uint32_t page, void *data,
+    void *oob)
+{
+    return nand->ops->read(nand, page, data, oob);
+}
+
+static inline status_t nand_program(nand_t *nand, uint32_t page,
+    const void *data, const void *oob)
+{
+    return nand->ops->program(nand, page, data, oob);
+}
+
+/* the worst result of all pages, reads go on past an ecc error */
+static inline status_t nand_read_pages(nand_t *nand, uint32_t page,
+    uint32_t nr, void *data, void *oob)
+{
+    uint8_t *d = (uint8_t *)data, *o = (uint8_t *)oob;
+    status_t st, worst = NAND_OK;
+
+    if (nand->ops->read_pages)
+        return nand->ops->read_pages(nand, page, nr, data, oob);
+
+    for (; nr; nr--, page++) {
+        st = nand->ops->read(nand, page, d, o);
+        if (NAND_ERROR == st)
+            return st;
+        if ((NAND_ECC_ERROR == st) || (NAND_OK == worst))
+            worst = st;
+        d = d ? d + nand->page_size : NULL;
+        o = o ? o + nand->oob_size : NULL;
+    }
+    return worst;
+}
+
+/* stops at the first page that fails */
+static inline status_t nand_program_pages(nand_t *nand, uint32_t page,
+    uint32_t nr, const void *data, const void *oob)
+{
+    const uint8_t *d = (const uint8_t *)data, *o = (const uint8_t *)oob;
+    status_t st;
+
+    if (nand->ops->program_pages)
+        return nand->ops->program_pages(nand, page, nr, data, oob);
+
+    for (; nr; nr--, page++) {
+        st = nand->ops->program(nand, page, d, o);
+        if (NAND_OK != st)
+            return st;
+        d = d ? d + nand->page_size : NULL;
+        o = o ? o + nand->oob_size : NULL;
+    }
+    return NAND_OK;
+}
+
+static inline status_t nand_erase(nand_t *nand, uint32_t block)
+{
+    return nand->ops->erase(nand, block);
+}
+
+static inline bool_t nand_is_bad(nand_t *nand, uint32_t block)
+{
+    return nand->ops->is_bad(nand, block);
+}
+
+static inline status_t nand_mark_bad(nand_t *nand, uint32_t block)
+{
+    return nand->ops->mark_bad(nand, block);
+}
+
+#endif // _MINIOS_NAND_H_
+// EOF nand.h
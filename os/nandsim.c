@@ -0,0 +1,330 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/nandsim.h"
+#include "os/string.h"
+
+#define SIM(nand)       ((nandsim_t *)(nand)->priv)
+#define PAGE_BYTES(n)   ((n)->page_size + (n)->oob_size)
+
+static uint8_t *sim_page(nand_t *nand, uint32_t page)
+{
+    return SIM(nand)->mem + page * PAGE_BYTES(nand);
+}
+
+/* TRUE once a counter set to n reaches the nth operation */
+static bool_t sim_fault(uint32_t *count)
+{
+    if ((0 == *count) || (0 != --*count))
+        return FALSE;
+    return TRUE;
+}
+
+static void sim_and(uint8_t *dst, const uint8_t *src, uint32_t len)
+{
+    while (len--)
+        *dst++ &= *src++;
+}
+
+/*--------------------------------------------------------------------------*/
+
+static status_t sim_read(nand_t *nand, uint32_t page, void *data, void *oob)
+{
+    nandsim_t *sim = SIM(nand);
+    uint8_t *p = sim_page(nand, page);
+
+    if (sim->dead)
+        return NAND_ERROR;
+
+    ++sim->reads;
+    if (data)
+        memcpy(data, p, nand->page_size);
+    if (oob)
+        memcpy(oob, p + nand->page_size, nand->oob_size);
+
+    if (sim->ecc_error_page == page + 1)
+        return NAND_ECC_ERROR;
+    if (sim->flip_every && (0 == sim->reads % sim->flip_every))
+        return NAND_CORRECTED;
+    return NAND_OK;
+}
+
+static status_t sim_program(nand_t *nand, uint32_t page, const void *data,
+    const void *oob)
+{
+    nandsim_t *sim = SIM(nand);
+    uint8_t *p = sim_page(nand, page);
+    uint32_t len = nand->page_size;
+    bool_t cut, fail;
+
+    if (sim->dead)
+        return NAND_ERROR;
+
+    ++sim->programs;
+    cut = sim_fault(&sim->cut_after);
+    fail = sim_fault(&sim->fail_program);
+
+    // a torn page keeps a good looking oob over half of the data
+    if (cut || fail)
+        len /= 2;
+    if (data)
+        sim_and(p, data, len);
+    if (oob)
+        sim_and(p + nand->page_size, oob, nand->oob_size);
+
+    if (cut)
+        sim->dead = TRUE;
+    return (cut || fail) ? NAND_ERROR : NAND_OK;
+}
+
+static status_t sim_erase(nand_t *nand, uint32_t block)
+{
+    nandsim_t *sim = SIM(nand);
+    uint32_t pages = nand->pages_per_block;
+    bool_t cut, fail;
+
+    if (sim->dead)
+        return NAND_ERROR;
+
+    cut = sim_fault(&sim->cut_after);
+    fail = sim_fault(&sim->fail_erase);
+    if (cut)
+        pages /= 2;
+
+    ++sim->erases[block];
+    if (!fail) {
+        memset(sim_page(nand, block * nand->pages_per_block), 0xff,
+            pages * PAGE_BYTES(nand));
+    }
+
+    if (cut)
+        sim->dead = TRUE;
+    return (cut || fail) ? NAND_ERROR : NAND_OK;
+}
+
+static bool_t sim_is_bad(nand_t *nand, uint32_t block)
+{
+    return SIM(nand)->bad[block] ? TRUE : FALSE;
+}
+
+static status_t sim_mark_bad(nand_t *nand, uint32_t block)
+{
+    if (SIM(nand)->dead)
+        return NAND_ERROR;
+
+    SIM(nand)->bad[block] = 1;
+    return NAND_OK;
+}
+
+const nand_ops_t nandsim_ops = {
+    .read = sim_read,
+    .program = sim_program,
+    .erase = sim_erase,
+    .is_bad = sim_is_bad,
+    .mark_bad = sim_mark_bad,
+};
+
+/*--------------------------------------------------------------------------*/
+
+#define CHIP(nfc)           ((nandsim_t *)(nfc)->priv)
+
+#define CHIP_READY          0xc0    /* ready, not write protected */
+#define CHIP_FAIL           0x01
+
+static uint32_t chip_log2(uint32_t v)
+{
+    uint32_t n = 0;
+
+    while (v >>= 1)
+        ++n;
+    return n;
+}
+
+/* what nfc_attach() decodes, the array of the sim must be 8MB << n */
+static void chip_id(nandsim_t *sim, uint8_t *id)
+{
+    nand_t *nand = &sim->nand;
+    uint32_t block = nand->pages_per_block * nand->page_size;
+
+    id[0] = 0xec;
+    id[1] = 0xf1;
+    id[2] = 0x80;
+    id[3] = chip_log2(nand->page_size / 1024)
+        | ((nand->oob_size / (nand->page_size / 512) >= 16) ? 1 << 2 : 0)
+        | chip_log2(block / (64 * 1024)) << 4;
+    id[4] = chip_log2(nand->nr_blocks * block / (8 * 1024 * 1024)) << 4;
+}
+
+/* into the page register, with the factory marker of a bad block */
+static void chip_load(nandsim_t *sim, uint32_t page)
+{
+    nand_t *nand = &sim->nand;
+
+    ++sim->reads;
+    memcpy(sim->reg, sim_page(nand, page), PAGE_BYTES(nand));
+    if (sim->bad[page / nand->pages_per_block])
+        sim->reg[nand->page_size] = 0;
+    sim->col = 0;
+}
+
+static void chip_select(nfc_t *nfc, bool_t on)
+{
+}
+
+static void chip_cmd(nfc_t *nfc, uint8_t cmd)
+{
+    nandsim_t *sim = CHIP(nfc);
+    nand_t *nand = &sim->nand;
+    uint32_t col;
+    status_t st;
+
+    switch (cmd) {
+    case 0x00:
+    case 0x60:
+    case 0x80:
+    case 0x90:
+        sim->cmd = cmd;
+        sim->cycles = 0;
+        sim->col = 0;
+        sim->row = 0;
+        if (0x80 == cmd)
+            memset(sim->reg, 0xff, PAGE_BYTES(nand));
+        break;
+    case 0x30:
+        col = sim->col;
+        chip_load(sim, sim->row);
+        sim->next = sim->row;
+        sim->col = col;
+        break;
+    case 0x31:
+        chip_load(sim, sim->next++);
+        break;
+    case 0x3f:
+        chip_load(sim, sim->next);
+        break;
+    case 0x10:
+    case 0x15:
+        st = sim_program(nand, sim->row, sim->reg, sim->reg + nand->page_size);
+        sim->status = CHIP_READY | ((NAND_OK != st) ? CHIP_FAIL : 0);
+        break;
+    case 0xd0:
+        st = sim_erase(nand, sim->row / nand->pages_per_block);
+        sim->status = CHIP_READY | ((NAND_OK != st) ? CHIP_FAIL : 0);
+        break;
+    case 0x70:
+        sim->cmd = cmd;
+        break;
+    case 0xff:
+        sim->cmd = 0;
+        sim->status = CHIP_READY;
+        break;
+    }
+}
+
+/* column then row, an erase only takes the row */
+static void chip_addr(nfc_t *nfc, uint8_t addr)
+{
+    nandsim_t *sim = CHIP(nfc);
+    uint32_t n = sim->cycles++;
+
+    if (0x60 != sim->cmd) {
+        if (n < 2) {
+            sim->col |= addr << (8 * n);
+            return;
+        }
+        n -= 2;
+    }
+    sim->row |= addr << (8 * n);
+}
+
+static void chip_read_buf(nfc_t *nfc, void *buf, uint32_t len)
+{
+    nandsim_t *sim = CHIP(nfc);
+    uint8_t *p = (uint8_t *)buf, id[5];
+
+    if (0x70 == sim->cmd) {
+        memset(p, sim->status, len);
+    } else if (0x90 == sim->cmd) {
+        chip_id(sim, id);
+        for (; len--; sim->col++)
+            *p++ = (sim->col < sizeof(id)) ? id[sim->col] : 0;
+    } else {
+        for (; len--; sim->col++)
+            *p++ = (sim->col < PAGE_BYTES(&sim->nand)) ? sim->reg[sim->col]
+                : 0xff;
+    }
+}
+
+static void chip_write_buf(nfc_t *nfc, const void *buf, uint32_t len)
+{
+    nandsim_t *sim = CHIP(nfc);
+    const uint8_t *p = (const uint8_t *)buf;
+
+    for (; len--; sim->col++, p++) {
+        if (sim->col < PAGE_BYTES(&sim->nand))
+            sim->reg[sim->col] = *p;
+    }
+}
+
+static bool_t chip_wait_ready(nfc_t *nfc, uint32_t polls)
+{
+    return TRUE;
+}
+
+/* the generator sees the register bytes moved since it was started */
+static void chip_ecc_start(nfc_t *nfc)
+{
+    CHIP(nfc)->ecc_col = CHIP(nfc)->col;
+}
+
+static void chip_ecc_get(nfc_t *nfc, uint8_t *code)
+{
+    nfc_ecc_calc(CHIP(nfc)->reg + CHIP(nfc)->ecc_col, code);
+}
+
+const nfc_ops_t nandsim_nfc_ops = {
+    .select = chip_select,
+    .cmd = chip_cmd,
+    .addr = chip_addr,
+    .read_buf = chip_read_buf,
+    .write_buf = chip_write_buf,
+    .wait_ready = chip_wait_ready,
+    .ecc_start = chip_ecc_start,
+    .ecc_get = chip_ecc_get,
+};
+
+/*--------------------------------------------------------------------------*/
+
+void nandsim_init(nandsim_t *sim)
+{
+    nand_t *nand = &sim->nand;
+
+    memset(sim->mem, 0xff,
+        nand->nr_blocks * nand->pages_per_block * PAGE_BYTES(nand));
+    memset(sim->erases, 0, nand->nr_blocks * sizeof(uint32_t));
+    memset(sim->bad, 0, nand->nr_blocks);
+
+    sim->cut_after = 0;
+    sim->fail_program = 0;
+    sim->fail_erase = 0;
+    sim->flip_every = 0;
+    sim->ecc_error_page = 0;
+    sim->dead = FALSE;
+    sim->reads = 0;
+    sim->programs = 0;
+    sim->cmd = 0;
+    sim->status = CHIP_READY;
+}
+
+void nandsim_power_on(nandsim_t *sim)
+{
+    sim->cut_after = 0;
+    sim->dead = FALSE;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF nandsim.c
@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_NANDSIM_H_
+#define _MINIOS_NANDSIM_H_
+
+#include "os/nfc.h"
+
+/*
+ * A nand in memory for bringing up flash code on the host. Programming
+ * only clears bits like the real part does. The fault counters count
+ * operations down from when they are set, 0 leaves them off.
+ *
+ * nandsim_nfc_ops drive the same memory as a large page chip at command
+ * level, with a page register and an ecc generator like a controller
+ * has, for an nfc_t whose priv is the nandsim_t. The oob is the whole
+ * spare then, and a block in 'bad' carries a factory marker.
+ */
+typedef struct {
+    nand_t nand;
+    uint8_t *mem;               /* pages of page_size + oob_size bytes */
+    uint32_t *erases;           /* per block */
+    uint8_t *bad;               /* per block */
+    uint32_t cut_after;         /* program or erase torn by a power cut */
+    uint32_t fail_program;      /* program leaves half a page and fails */
+    uint32_t fail_erase;
+    uint32_t flip_every;        /* reads reporting a corrected bit error */
+    uint32_t ecc_error_page;    /* page + 1 that no longer reads back */
+    bool_t dead;                /* power lost, until nandsim_power_on() */
+    uint32_t reads;
+    uint32_t programs;
+    uint8_t *reg;               /* the chip's page register */
+    uint8_t cmd;
+    uint8_t status;
+    uint32_t cycles;            /* address bytes taken */
+    uint32_t col;
+    uint32_t row;
+    uint32_t next;              /* page a cache read hands out next */
+    uint32_t ecc_col;
+} nandsim_t;
+
+extern const nand_ops_t nandsim_ops;
+extern const nfc_ops_t nandsim_nfc_ops;
+
+#define DECLARE_NANDSIM(_name, _page, _oob, _ppb, _blocks)                  \
+static uint8_t _name##_mem[(_blocks) * (_ppb) * ((_page) + (_oob))];       \
+static uint32_t _name##_erases[_blocks];                                    \
+static uint8_t _name##_bad[_blocks];                                        \
+static uint8_t _name##_reg[(_page) + (_oob)];                               \
+nandsim_t _name = {                                                         \
+    .nand = {                                                               \
+        .name = #_name,                                                     \
+        .ops = &nandsim_ops,                                                \
+        .priv = &_name,                                                     \
+        .page_size = (_page),                                               \
+        .oob_size = (_oob),                                                 \
+        .pages_per_block = (_ppb),                                          \
+        .nr_blocks = (_blocks),                                             \
+    },                                                                      \
+    .mem = _name##_mem,                                                     \
+    .erases = _name##_erases,                                               \
+    .bad = _name##_bad,                                                     \
+    .reg = _name##_reg,                                                     \
+}
+
+/* all erased, no bad blocks, faults and counters cleared */
+void nandsim_init(nandsim_t *sim);
+
+/* after a cut, the contents stay as the cut left them */
+void nandsim_power_on(nandsim_t *sim);
+
+#endif // _MINIOS_NANDSIM_H_
+// EOF nandsim.h
@@ -0,0 +1,780 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/net.h"
+#include "os/hsr.h"
+#include "os/spinlock.h"
+#include "port/port.h"
+
+extern volatile uint32_t jiffies;
+
+#define IP_PROTO_ICMP       1
+#define IP_PROTO_UDP        17
+
+#define IP_VERSION          4
+#define IP_TTL              64
+#define IP_DF               0x4000
+#define IP_FRAG_MASK        0x3fff  /* more fragments and the offset */
+
+#define ICMP_ECHO_REPLY     0
+#define ICMP_ECHO_REQUEST   8
+
+#define UDP_PORT_FIRST      49152
+#define UDP_PORT_LAST       65535
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+} net_waiter_t;
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+    uint32_t id;                /* id and sequence number of the request */
+    bool_t done;
+} icmp_pinger_t;
+
+static void net_entry(void *para);
+
+DECLARE_TASK(net_task, NET_PRIORITY, 0, NET_STACK_SIZE, net_entry, NULL);
+
+/* packets from the drivers, taken with interrupts masked */
+static spinlock_t net_lock = SPINLOCK_INIT;
+static mbuf_queue_t net_rxq = MBUF_QUEUE_INIT;
+
+/* written at boot only, walked without a lock */
+static LIST_HEAD(net_ifs);
+
+/*
+ * Sockets and pingers, under task_lock and sock_lock. The net task and a
+ * reader may be on different cpus, a reader checks, publishes itself and
+ * suspends under sock_lock so that the net task cannot wake it between.
+ */
+static spinlock_t sock_lock = SPINLOCK_INIT;
+static LIST_HEAD(udp_socks);
+static LIST_HEAD(icmp_pingers);
+static uint32_t udp_next_port = UDP_PORT_FIRST;
+static uint32_t icmp_seq;
+
+static uint32_t ip_id;
+static net_stats_t net_stats;
+
+/*--------------------------------------------------------------------------*/
+
+/* headers byte by byte, in network order and at any alignment */
+static inline uint32_t net_get16(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t net_get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+        | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void net_put16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void net_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/*
+ * The internet checksum, summed in 32 bits and folded at the end. 'odd'
+ * carries a byte left over at the end of one buffer into the next.
+ */
+static uint32_t net_sum(uint32_t sum, const uint8_t *p, uint32_t len,
+    bool_t *odd)
+{
+    if (*odd && (len > 0)) {
+        sum += *p++;
+        --len;
+        *odd = FALSE;
+    }
+    while (len >= 2) {
+        sum += ((uint32_t)p[0] << 8) | p[1];
+        p += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        sum += (uint32_t)p[0] << 8;
+        *odd = TRUE;
+    }
+    return sum;
+}
+
+static uint32_t net_sum_mbuf(uint32_t sum, mbuf_t *m)
+{
+    bool_t odd = FALSE;
+
+    for (; NULL != m; m = m->next)
+        sum = net_sum(sum, m->data, m->len, &odd);
+    return sum;
+}
+
+static uint32_t net_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return sum;
+}
+
+static uint32_t udp_pseudo_sum(ip_addr_t src, ip_addr_t dst, uint32_t len)
+{
+    return (src >> 16) + (src & 0xffff) + (dst >> 16) + (dst & 0xffff)
+        + IP_PROTO_UDP + len;
+}
+
+/*
+ * task_lock and sock_lock held, both held again after; FALSE once the
+ * wait is over, 'timeout' as for udp_recv
+ */
+static bool_t net_sleep(int32_t timeout, uint32_t expires)
+{
+    int32_t left = 0;
+
+    if (timeout < 0)
+        return FALSE;
+    if (timeout > 0) {
+        left = (int32_t)(expires - jiffies);
+        if (left <= 0)
+            return FALSE;
+    }
+
+    task_suspend(current, left, NULL, NULL);
+    spin_unlock(&sock_lock);
+
+    task_unlock();
+    task_lock();
+
+    spin_lock(&sock_lock);
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------------*/
+
+static bool_t net_is_local(ip_addr_t addr)
+{
+    netif_t *ifp;
+
+    if (127 == (addr >> 24))
+        return TRUE;
+
+    LIST_FOR_EACH_ENTRY(ifp, &net_ifs, node) {
+        if ((ifp->flags & NETIF_UP) && (addr == ifp->addr))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* local addresses go by the loopback, the rest by subnet or the first */
+static netif_t *net_route(ip_addr_t dst)
+{
+    netif_t *ifp, *lo = NULL, *def = NULL;
+
+    LIST_FOR_EACH_ENTRY(ifp, &net_ifs, node) {
+        if (!(ifp->flags & NETIF_UP))
+            continue;
+        if (ifp->flags & NETIF_LOOPBACK) {
+            if (NULL == lo)
+                lo = ifp;
+            continue;
+        }
+        if ((dst & ifp->mask) == (ifp->addr & ifp->mask))
+            return ((dst == ifp->addr) && (NULL != lo)) ? lo : ifp;
+        if (NULL == def)
+            def = ifp;
+    }
+
+    if (net_is_local(dst))
+        return lo;
+    return def;
+}
+
+static ip_addr_t net_source(netif_t *ifp, ip_addr_t dst)
+{
+    // to an address of another interface, from that address
+    if ((ifp->flags & NETIF_LOOPBACK) && (127 != (dst >> 24)))
+        return dst;
+    return ifp->addr;
+}
+
+static bool_t net_accepts(netif_t *ifp, ip_addr_t dst)
+{
+    if (IP_ADDR_BROADCAST == dst)
+        return TRUE;
+    if (ifp->flags & NETIF_LOOPBACK)
+        return net_is_local(dst);
+    return (dst == ifp->addr) || (dst == (ifp->addr | ~ifp->mask));
+}
+
+void netif_add(netif_t *ifp, ip_addr_t addr, ip_addr_t mask)
+{
+    ifp->addr = addr;
+    ifp->mask = mask;
+
+    task_lock();
+    ifp->flags |= NETIF_UP;
+    LIST_ADD_TAIL(&net_ifs, &ifp->node);
+    task_unlock();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* the packet is consumed, sent or not */
+static status_t ip_output(netif_t *ifp, mbuf_t *m, ip_addr_t src,
+    ip_addr_t dst, uint32_t proto)
+{
+    bool_t odd = FALSE;
+    status_t st;
+    uint8_t *h;
+
+    if (m->pkt_len + IP_HDR_LEN > ifp->mtu) {
+        mbuf_free(m);
+        return NET_ERR_MSGSIZE;
+    }
+
+    m = mbuf_prepend(m, IP_HDR_LEN);
+    if (NULL == m)
+        return NET_ERR_NOBUFS;
+
+    h = m->data;
+    h[0] = (IP_VERSION << 4) | (IP_HDR_LEN / 4);
+    h[1] = 0;
+    net_put16(h + 2, m->pkt_len);
+    net_put16(h + 4, ip_id++);
+    net_put16(h + 6, IP_DF);
+    h[8] = IP_TTL;
+    h[9] = (uint8_t)proto;
+    net_put16(h + 10, 0);
+    net_put32(h + 12, src);
+    net_put32(h + 16, dst);
+    net_put16(h + 10, ~net_fold(net_sum(0, h, IP_HDR_LEN, &odd)));
+
+    ++net_stats.ip_out;
+    st = ifp->ops->xmit(ifp, m);
+    if (NET_OK == st)
+        ++ifp->tx_packets;
+    else
+        ++ifp->tx_errors;
+    return st;
+}
+
+static void icmp_input(mbuf_t *m, ip_addr_t src, ip_addr_t dst)
+{
+    icmp_pinger_t *p;
+    ip_addr_t me;
+    netif_t *ifp;
+    mbuf_t *n;
+    uint8_t *h;
+    uint32_t id;
+
+    ++net_stats.icmp_in;
+    if (!mbuf_pullup(m, ICMP_HDR_LEN)
+        || (0xffff != net_fold(net_sum_mbuf(0, m)))) {
+        ++net_stats.icmp_bad;
+        mbuf_free(m);
+        return;
+    }
+
+    h = m->data;
+    switch (h[0]) {
+    case ICMP_ECHO_REQUEST:
+        ++net_stats.icmp_echoes;
+        ifp = net_route(src);
+        if (NULL == ifp)
+            break;
+        me = net_is_local(dst) ? dst : m->ifp->addr;
+
+        // turned around in place, unless a clone shares the header
+        if (!mbuf_writable(m)) {
+            n = mbuf_alloc(MBUF_HEADROOM + IP_HDR_LEN);
+            if ((NULL == n) || (NULL == mbuf_put(n, m->pkt_len))) {
+                if (NULL != n)
+                    mbuf_free(n);
+                break;
+            }
+            mbuf_copy_out(m, 0, n->data, m->pkt_len);
+            mbuf_free(m);
+            m = n;
+            h = m->data;
+        }
+
+        h[0] = ICMP_ECHO_REPLY;
+        net_put16(h + 2, 0);
+        net_put16(h + 2, ~net_fold(net_sum_mbuf(0, m)));
+        ip_output(ifp, m, me, src, IP_PROTO_ICMP);
+        return;
+
+    case ICMP_ECHO_REPLY:
+        id = net_get32(h + 4);
+        task_lock();
+        spin_lock(&sock_lock);
+        LIST_FOR_EACH_ENTRY(p, &icmp_pingers, node) {
+            if (p->id == id) {
+                p->done = TRUE;
+                task_resume(p->task, 0);
+                break;
+            }
+        }
+        spin_unlock(&sock_lock);
+        task_unlock();
+        break;
+    }
+
+    mbuf_free(m);
+}
+
+/* task_lock and sock_lock held */
+static udp_sock_t *udp_lookup(ip_addr_t addr, uint32_t port)
+{
+    udp_sock_t *s;
+
+    LIST_FOR_EACH_ENTRY(s, &udp_socks, node) {
+        if ((s->port == port)
+            && ((IP_ADDR_ANY == s->addr) || (s->addr == addr)))
+            return s;
+    }
+    return NULL;
+}
+
+static void udp_input(mbuf_t *m, ip_addr_t src, ip_addr_t dst)
+{
+    uint32_t len, sport, dport;
+    net_waiter_t *w;
+    udp_sock_t *s;
+    uint8_t *h;
+    mbuf_t *n;
+
+    ++net_stats.udp_in;
+    if (!mbuf_pullup(m, UDP_HDR_LEN))
+        goto bad;
+
+    h = m->data;
+    sport = net_get16(h);
+    dport = net_get16(h + 2);
+    len = net_get16(h + 4);
+    if ((len < UDP_HDR_LEN) || (len > m->pkt_len))
+        goto bad;
+    mbuf_trim(m, len);
+
+    // a zero sum was not computed by the sender
+    if ((0 != net_get16(h + 6))
+        && (0xffff != net_fold(net_sum_mbuf(udp_pseudo_sum(src, dst, len),
+            m))))
+        goto bad;
+
+    m->cb[0] = src;
+    m->cb[1] = sport;
+    mbuf_pull(m, UDP_HDR_LEN);
+
+    // the reader starts right at the payload when the headers came alone
+    if ((0 == m->len) && (NULL != m->next)) {
+        n = m->next;
+        n->pkt_len = m->pkt_len;
+        n->ifp = m->ifp;
+        n->cb[0] = m->cb[0];
+        n->cb[1] = m->cb[1];
+        m->next = NULL;
+        mbuf_free(m);
+        m = n;
+    }
+
+    task_lock();
+    spin_lock(&sock_lock);
+    s = udp_lookup(dst, dport);
+    if ((NULL == s) || (s->rxq.len >= UDP_RX_QUEUE_MAX)) {
+        if (NULL == s) {
+            ++net_stats.udp_no_port;
+        } else {
+            ++net_stats.udp_overflows;
+            ++s->drops;
+        }
+        spin_unlock(&sock_lock);
+        task_unlock();
+        mbuf_free(m);
+        return;
+    }
+    mbuf_enqueue(&s->rxq, m);
+    w = LIST_EMPTY(&s->waiters)
+        ? NULL : LIST_ENTRY(LIST_FIRST(&s->waiters), net_waiter_t, node);
+    if (NULL != w) {
+        LIST_DEL(&w->node);
+        task_resume(w->task, 0);
+    }
+    spin_unlock(&sock_lock);
+    task_unlock();
+    return;
+
+bad:
+    ++net_stats.udp_bad;
+    mbuf_free(m);
+}
+
+static void ip_input(mbuf_t *m)
+{
+    uint32_t hlen, len, proto;
+    ip_addr_t src, dst;
+    bool_t odd = FALSE;
+    uint8_t *h;
+
+    ++net_stats.ip_in;
+    if (!mbuf_pullup(m, IP_HDR_LEN))
+        goto bad;
+
+    h = m->data;
+    hlen = (h[0] & 0xf) * 4;
+    if ((IP_VERSION != (h[0] >> 4)) || (hlen < IP_HDR_LEN)
+        || !mbuf_pullup(m, hlen))
+        goto bad;
+
+    // the pullup may have moved it
+    h = m->data;
+    len = net_get16(h + 2);
+    if ((len < hlen) || (len > m->pkt_len)
+        || (0xffff != net_fold(net_sum(0, h, hlen, &odd))))
+        goto bad;
+
+    if (net_get16(h + 6) & IP_FRAG_MASK) {
+        ++net_stats.ip_frags;
+        mbuf_free(m);
+        return;
+    }
+
+    src = net_get32(h + 12);
+    dst = net_get32(h + 16);
+    if (!net_accepts(m->ifp, dst)) {
+        ++net_stats.ip_not_ours;
+        mbuf_free(m);
+        return;
+    }
+
+    proto = h[9];
+    mbuf_trim(m, len);
+    mbuf_pull(m, hlen);
+
+    if (IP_PROTO_UDP == proto) {
+        udp_input(m, src, dst);
+    } else if (IP_PROTO_ICMP == proto) {
+        icmp_input(m, src, dst);
+    } else {
+        ++net_stats.ip_no_proto;
+        mbuf_free(m);
+    }
+    return;
+
+bad:
+    ++net_stats.ip_bad;
+    mbuf_free(m);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void net_wakeup(void *data)
+{
+    task_resume(&net_task, 0);
+}
+
+static DECLARE_HSR(net_hsr, 0, net_wakeup, "net_hsr");
+
+void netif_rx(netif_t *ifp, mbuf_t *m)
+{
+    cpu_flags_t flags;
+    bool_t queued = FALSE;
+
+    m->ifp = ifp;
+
+    flags = spin_lock_irqsave(&net_lock);
+    if (net_rxq.len < NET_RX_QUEUE_MAX) {
+        mbuf_enqueue(&net_rxq, m);
+        ++ifp->rx_packets;
+        queued = TRUE;
+    } else {
+        ++ifp->rx_drops;
+    }
+    spin_unlock_irqrestore(&net_lock, flags);
+
+    if (queued)
+        activiate_hsr(&net_hsr, NULL);
+    else
+        mbuf_free(m);
+}
+
+/* net_lock held */
+static mbuf_t *net_take(void)
+{
+    mbuf_t *list;
+
+    list = net_rxq.head;
+    net_rxq.head = net_rxq.tail = NULL;
+    net_rxq.len = 0;
+
+    return list;
+}
+
+/* the whole input path runs here, drivers only queue */
+static void net_entry(void *para)
+{
+    cpu_flags_t flags;
+    mbuf_t *list, *m;
+    uint32_t done;
+
+    while (1) {
+        // check and sleep under the lock netif_rx() queues with, its
+        // wakeup comes after it and so finds this task suspended
+        task_lock();
+        flags = spin_lock_irqsave(&net_lock);
+        list = net_take();
+        if (NULL == list)
+            task_suspend(current, 0, NULL, NULL);
+        spin_unlock_irqrestore(&net_lock, flags);
+        task_unlock();
+
+        done = 0;
+        while (NULL != list) {
+            m = list;
+            list = m->nextpkt;
+            m->nextpkt = NULL;
+            ip_input(m);
+
+            if ((++done >= NET_BATCH) && (NULL != list)) {
+                done = 0;
+                task_yield();
+            }
+        }
+    }
+}
+
+void net_get_stats(net_stats_t *stats)
+{
+    *stats = net_stats;
+}
+
+/*--------------------------------------------------------------------------*/
+
+status_t icmp_ping(ip_addr_t dst, uint32_t len, int32_t timeout)
+{
+    uint32_t expires = jiffies + timeout;
+    icmp_pinger_t p;
+    netif_t *ifp;
+    status_t st;
+    uint8_t *h;
+    mbuf_t *m;
+
+    ifp = net_route(dst);
+    if (NULL == ifp)
+        return NET_ERR_UNREACH;
+
+    m = mbuf_alloc(MBUF_HEADROOM);
+    if (NULL == m)
+        return NET_ERR_NOBUFS;
+    h = mbuf_put(m, ICMP_HDR_LEN + len);
+    if (NULL == h) {
+        mbuf_free(m);
+        return NET_ERR_MSGSIZE;
+    }
+
+    task_lock();
+    spin_lock(&sock_lock);
+    p.task = current;
+    p.id = ++icmp_seq;
+    p.done = FALSE;
+    LIST_ADD_TAIL(&icmp_pingers, &p.node);
+    spin_unlock(&sock_lock);
+    task_unlock();
+
+    h[0] = ICMP_ECHO_REQUEST;
+    h[1] = 0;
+    net_put16(h + 2, 0);
+    net_put32(h + 4, p.id);
+    for (uint32_t i = 0; i < len; i++)
+        h[ICMP_HDR_LEN + i] = (uint8_t)i;
+    net_put16(h + 2, ~net_fold(net_sum_mbuf(0, m)));
+
+    st = ip_output(ifp, m, net_source(ifp, dst), dst, IP_PROTO_ICMP);
+
+    task_lock();
+    spin_lock(&sock_lock);
+    while ((NET_OK == st) && !p.done) {
+        if (!net_sleep(timeout, expires))
+            st = NET_ERR_TIMEOUT;
+    }
+    LIST_DEL(&p.node);
+    spin_unlock(&sock_lock);
+    task_unlock();
+
+    return st;
+}
+
+/*--------------------------------------------------------------------------*/
+
+status_t udp_open(udp_sock_t *s, ip_addr_t addr, uint32_t port)
+{
+    uint32_t tries = UDP_PORT_LAST - UDP_PORT_FIRST + 1;
+
+    if (port > UDP_PORT_LAST)
+        return NET_ERR_INVAL;
+
+    task_lock();
+    spin_lock(&sock_lock);
+
+    if (0 == port) {
+        while ((tries-- > 0) && (NULL != udp_lookup(addr, udp_next_port))) {
+            if (++udp_next_port > UDP_PORT_LAST)
+                udp_next_port = UDP_PORT_FIRST;
+        }
+        port = udp_next_port;
+    }
+    if (NULL != udp_lookup(addr, port)) {
+        spin_unlock(&sock_lock);
+        task_unlock();
+        return NET_ERR_INUSE;
+    }
+
+    s->addr = addr;
+    s->port = port;
+    s->open = TRUE;
+    s->rxq.head = s->rxq.tail = NULL;
+    s->rxq.len = 0;
+    INIT_LIST_HEAD(&s->waiters);
+    s->drops = 0;
+    LIST_ADD_TAIL(&udp_socks, &s->node);
+
+    spin_unlock(&sock_lock);
+    task_unlock();
+    return NET_OK;
+}
+
+void udp_close(udp_sock_t *s)
+{
+    net_waiter_t *w, *nxt;
+    mbuf_queue_t q;
+    mbuf_t *m;
+
+    task_lock();
+    spin_lock(&sock_lock);
+    s->open = FALSE;
+    LIST_DEL(&s->node);
+    LIST_FOR_EACH_ENTRY_SAFE(w, nxt, &s->waiters, node) {
+        LIST_DEL(&w->node);
+        task_resume(w->task, 0);
+    }
+    q = s->rxq;
+    s->rxq.head = s->rxq.tail = NULL;
+    s->rxq.len = 0;
+    spin_unlock(&sock_lock);
+    task_unlock();
+
+    while (NULL != (m = mbuf_dequeue(&q)))
+        mbuf_free(m);
+}
+
+status_t udp_send(udp_sock_t *s, ip_addr_t dst, uint32_t port, mbuf_t *m)
+{
+    netif_t *ifp = net_route(dst);
+    uint32_t len, sum;
+    ip_addr_t src;
+    uint8_t *h;
+
+    if ((NULL == ifp) || (0 == port) || (port > UDP_PORT_LAST)) {
+        mbuf_free(m);
+        return (NULL == ifp) ? NET_ERR_UNREACH : NET_ERR_INVAL;
+    }
+
+    len = m->pkt_len + UDP_HDR_LEN;
+    if (len + IP_HDR_LEN > ifp->mtu) {
+        mbuf_free(m);
+        return NET_ERR_MSGSIZE;
+    }
+
+    m = mbuf_prepend(m, UDP_HDR_LEN);
+    if (NULL == m)
+        return NET_ERR_NOBUFS;
+
+    src = (IP_ADDR_ANY != s->addr) ? s->addr : net_source(ifp, dst);
+    h = m->data;
+    net_put16(h, s->port);
+    net_put16(h + 2, port);
+    net_put16(h + 4, len);
+    net_put16(h + 6, 0);
+
+    // the one pass over the payload, left out where nothing can corrupt it
+    if (!(ifp->flags & NETIF_NO_CSUM)) {
+        sum = ~net_fold(net_sum_mbuf(udp_pseudo_sum(src, dst, len), m));
+        net_put16(h + 6, (0 == (sum & 0xffff)) ? 0xffff : sum);
+    }
+
+    ++net_stats.udp_out;
+    return ip_output(ifp, m, src, dst, IP_PROTO_UDP);
+}
+
+mbuf_t *udp_recv(udp_sock_t *s, ip_addr_t *from, uint32_t *port,
+    int32_t timeout)
+{
+    uint32_t expires = jiffies + timeout;
+    net_waiter_t w;
+    bool_t slept;
+    mbuf_t *m;
+
+    task_lock();
+    spin_lock(&sock_lock);
+    while ((NULL == (m = mbuf_dequeue(&s->rxq))) && s->open) {
+        w.task = current;
+        LIST_ADD_TAIL(&s->waiters, &w.node);
+        slept = net_sleep(timeout, expires);
+        LIST_DEL(&w.node);
+        if (!slept)
+            break;
+    }
+    spin_unlock(&sock_lock);
+    task_unlock();
+
+    if ((NULL != m) && (NULL != from))
+        *from = m->cb[0];
+    if ((NULL != m) && (NULL != port))
+        *port = m->cb[1];
+    return m;
+}
+
+int32_t udp_sendto(udp_sock_t *s, ip_addr_t dst, uint32_t port,
+    const void *buf, uint32_t len)
+{
+    status_t st;
+    mbuf_t *m;
+
+    m = mbuf_copy_in(MBUF_HEADROOM, buf, len);
+    if (NULL == m)
+        return NET_ERR_NOBUFS;
+
+    st = udp_send(s, dst, port, m);
+    return (NET_OK == st) ? (int32_t)len : st;
+}
+
+/* the rest of a longer datagram is dropped */
+int32_t udp_recvfrom(udp_sock_t *s, void *buf, uint32_t len,
+    ip_addr_t *from, uint32_t *port, int32_t timeout)
+{
+    mbuf_t *m = udp_recv(s, from, port, timeout);
+
+    if (NULL == m)
+        return s->open ? NET_ERR_TIMEOUT : NET_ERR_CLOSED;
+
+    len = mbuf_copy_out(m, 0, buf, len);
+    mbuf_free(m);
+    return (int32_t)len;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF net.c
@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_NET_H_
+#define _MINIOS_NET_H_
+
+#include "os/mbuf.h"
+#include "os/task.h"
+
+/* the stack task, above the application tasks */
+#ifndef NET_PRIORITY
+#define NET_PRIORITY            6
+#endif
+#ifndef NET_STACK_SIZE
+#define NET_STACK_SIZE          TASK_DEFAULT_STACK_SIZE
+#endif
+
+/* received packets waiting for the stack task, more are dropped */
+#ifndef NET_RX_QUEUE_MAX
+#define NET_RX_QUEUE_MAX        32
+#endif
+
+/* packets the stack task handles before it yields to its peers */
+#ifndef NET_BATCH
+#define NET_BATCH               16
+#endif
+
+/* datagrams a socket holds for its reader */
+#ifndef UDP_RX_QUEUE_MAX
+#define UDP_RX_QUEUE_MAX        16
+#endif
+
+#define NET_OK                  0
+#define NET_ERR_NOBUFS          -1
+#define NET_ERR_INVAL           -2
+#define NET_ERR_INUSE           -3
+#define NET_ERR_UNREACH         -4
+#define NET_ERR_TIMEOUT         -5
+#define NET_ERR_MSGSIZE         -6
+#define NET_ERR_CLOSED          -7
+
+/* ipv4 addresses and ports in host order, the stack swaps them */
+typedef uint32_t ip_addr_t;
+
+#define IP_ADDR(a, b, c, d) \
+    (((ip_addr_t)(a) << 24) | ((b) << 16) | ((c) << 8) | (d))
+
+#define IP_ADDR_ANY             0
+#define IP_ADDR_BROADCAST       0xffffffff
+
+#define IP_HDR_LEN              20
+#define UDP_HDR_LEN             8
+#define ICMP_HDR_LEN            8
+
+#define NETIF_UP                (1 << 0)
+#define NETIF_LOOPBACK          (1 << 1)
+#define NETIF_NO_CSUM           (1 << 2)    /* no udp sums, nothing corrupts */
+
+struct netif;
+
+/*
+ * A driver moves whole ip packets, link headers are its own business
+ * and go in the headroom. xmit() runs in the sender's task and owns the
+ * packet whatever it returns.
+ */
+typedef struct netif_ops {
+    status_t (*xmit)(struct netif *, mbuf_t *m);
+} netif_ops_t;
+
+typedef struct netif {
+    list_head_t node;
+    const char *name;
+    const netif_ops_t *ops;
+    void *priv;
+    uint32_t flags;
+    uint32_t mtu;
+    ip_addr_t addr;
+    ip_addr_t mask;
+    uint32_t rx_packets;
+    uint32_t rx_drops;          /* the stack task fell behind */
+    uint32_t tx_packets;
+    uint32_t tx_errors;
+} netif_t;
+
+/* task context, interfaces come up at boot and stay */
+void netif_add(netif_t *ifp, ip_addr_t addr, ip_addr_t mask);
+
+/* any context, the packet belongs to the stack task from here on */
+void netif_rx(netif_t *ifp, mbuf_t *m);
+
+typedef struct {
+    uint32_t ip_in;
+    uint32_t ip_out;
+    uint32_t ip_bad;            /* header or checksum */
+    uint32_t ip_frags;          /* not reassembled, dropped */
+    uint32_t ip_not_ours;
+    uint32_t ip_no_proto;
+    uint32_t icmp_in;
+    uint32_t icmp_bad;
+    uint32_t icmp_echoes;
+    uint32_t udp_in;
+    uint32_t udp_out;
+    uint32_t udp_bad;
+    uint32_t udp_no_port;
+    uint32_t udp_overflows;     /* the socket queue was full */
+} net_stats_t;
+
+void net_get_stats(net_stats_t *stats);
+
+/*
+ * Task context. An echo request with 'len' bytes of payload, at most
+ * what one buffer holds, and the wait for its reply. 'timeout' is in
+ * ticks, 0 waits for ever.
+ */
+status_t icmp_ping(ip_addr_t dst, uint32_t len, int32_t timeout);
+
+typedef struct udp_sock {
+    list_head_t node;
+    ip_addr_t addr;             /* local, or IP_ADDR_ANY */
+    uint32_t port;
+    bool_t open;
+    mbuf_queue_t rxq;
+    list_head_t waiters;
+    uint32_t drops;
+} udp_sock_t;
+
+/* task context, port 0 picks a free one above 49151 */
+status_t udp_open(udp_sock_t *s, ip_addr_t addr, uint32_t port);
+void udp_close(udp_sock_t *s);
+
+/*
+ * Task context. udp_send() puts the headers in front of the payload in
+ * 'm' and consumes it, udp_recv() hands out a datagram as the driver
+ * delivered it, the payload first. The copying variants are on top.
+ * Timeouts are in ticks, 0 waits for ever and a negative one not at all.
+ */
+status_t udp_send(udp_sock_t *s, ip_addr_t dst, uint32_t port, mbuf_t *m);
+mbuf_t *udp_recv(udp_sock_t *s, ip_addr_t *from, uint32_t *port,
+    int32_t timeout);
+
+/* bytes sent or received, or an error */
+int32_t udp_sendto(udp_sock_t *s, ip_addr_t dst, uint32_t port,
+    const void *buf, uint32_t len);
+int32_t udp_recvfrom(udp_sock_t *s, void *buf, uint32_t len,
+    ip_addr_t *from, uint32_t *port, int32_t timeout);
+
+#endif // _MINIOS_NET_H_
+// EOF net.h
@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/netloop.h"
+#include "os/init.h"
+
+static status_t netloop_xmit(netif_t *ifp, mbuf_t *m)
+{
+    netif_rx(ifp, m);
+    return NET_OK;
+}
+
+static const netif_ops_t netloop_ops = {
+    .xmit = netloop_xmit,
+};
+
+netif_t netloop = {
+    .name = "lo",
+    .ops = &netloop_ops,
+    .flags = NETIF_LOOPBACK | NETIF_NO_CSUM,
+    .mtu = NETLOOP_MTU,
+};
+
+static bool_t netloop_init(void)
+{
+    netif_add(&netloop, IP_ADDR(127, 0, 0, 1), IP_ADDR(255, 0, 0, 0));
+    return TRUE;
+}
+
+DECLARE_INITCALL(netloop_init, 6);
+
+/*--------------------------------------------------------------------------*/
+// EOF netloop.c
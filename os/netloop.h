@@ -0,0 +1,25 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_NETLOOP_H_
+#define _MINIOS_NETLOOP_H_
+
+#include "os/net.h"
+
+/* no link to size packets for, a datagram may span several buffers */
+#ifndef NETLOOP_MTU
+#define NETLOOP_MTU             8192
+#endif
+
+/*
+ * 127.0.0.1, and the way to the addresses of the other interfaces. A
+ * packet sent goes back up as it is, headers and payload untouched.
+ */
+extern netif_t netloop;
+
+#endif // _MINIOS_NETLOOP_H_
+// EOF netloop.h
@@ -0,0 +1,660 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/nfc.h"
+#include "os/string.h"
+#include "port/port.h"
+
+#define NFC(nand)               ((nfc_t *)(nand)->priv)
+
+/* large page command set */
+#define CMD_READ                0x00
+#define CMD_READ_START          0x30
+#define CMD_READ_CACHE          0x31    /* hand out this page, fetch the next */
+#define CMD_READ_CACHE_END      0x3f
+#define CMD_PROGRAM             0x80
+#define CMD_PROGRAM_START       0x10
+#define CMD_PROGRAM_CACHE       0x15    /* take the next page while busy */
+#define CMD_ERASE               0x60
+#define CMD_ERASE_START         0xd0
+#define CMD_STATUS              0x70
+#define CMD_READ_ID             0x90
+#define CMD_RESET               0xff
+
+#define STATUS_FAIL             0x01
+#define STATUS_FAIL_PREV        0x02    /* the page before, cache program */
+
+#define NFC_STEPS(nfc)          ((nfc)->nand.page_size / NFC_ECC_STEP)
+
+/* zero bits an erased step may show, as many as the ecc corrects */
+#define NFC_ERASED_FLIPS        1
+#define NFC_ECC_OFF(nfc)        \
+    ((nfc)->spare_size - NFC_STEPS(nfc) * NFC_ECC_BYTES)
+
+#define BBT_MAGIC               "MBBT"
+#define BBT_TEST(nfc, blk)      ((nfc)->bbt[(blk) >> 3] & (1 << ((blk) & 7)))
+#define BBT_SET(nfc, blk)       ((nfc)->bbt[(blk) >> 3] |= (1 << ((blk) & 7)))
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+} nfc_waiter_t;
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t nfc_parity8(uint32_t v)
+{
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    return v & 1;
+}
+
+/* the bits of the line parity with address bit 'b' set, then clear */
+#define ECC_PAIR(hi, lo, b) \
+    ((((hi) >> (b)) & 1) << 1 | (((lo) >> (b)) & 1))
+
+/*
+ * The smartmedia layout, also what the s3c24xx generators give:
+ * line parities P8 - P1024 in the first two bytes, the column parities
+ * and P2048 in the third. Inverted, an erased step codes as all 0xff.
+ */
+void nfc_ecc_calc(const uint8_t *data, uint8_t *code)
+{
+    uint32_t i, col = 0, hi = 0, lo, odd = 0, chi, clo;
+
+    // the xor of the offsets of the odd bytes has the line parities
+    for (i = 0; i < NFC_ECC_STEP; i++) {
+        col ^= data[i];
+        if (nfc_parity8(data[i])) {
+            odd ^= 1;
+            hi ^= i;
+        }
+    }
+    lo = (odd ? 0x1ff : 0) ^ hi;
+
+    chi = nfc_parity8(col & 0xaa) | nfc_parity8(col & 0xcc) << 1
+        | nfc_parity8(col & 0xf0) << 2;
+    clo = nfc_parity8(col & 0x55) | nfc_parity8(col & 0x33) << 1
+        | nfc_parity8(col & 0x0f) << 2;
+
+    code[0] = ~(ECC_PAIR(hi, lo, 3) << 6 | ECC_PAIR(hi, lo, 2) << 4
+        | ECC_PAIR(hi, lo, 1) << 2 | ECC_PAIR(hi, lo, 0));
+    code[1] = ~(ECC_PAIR(hi, lo, 7) << 6 | ECC_PAIR(hi, lo, 6) << 4
+        | ECC_PAIR(hi, lo, 5) << 2 | ECC_PAIR(hi, lo, 4));
+    code[2] = ~(ECC_PAIR(chi, clo, 2) << 6 | ECC_PAIR(chi, clo, 1) << 4
+        | ECC_PAIR(chi, clo, 0) << 2 | ECC_PAIR(hi, lo, 8));
+}
+
+status_t nfc_ecc_correct(uint8_t *data, const uint8_t *stored,
+    const uint8_t *calc)
+{
+    uint32_t d, byte = 0, bit = 0, i;
+
+    d = (stored[0] ^ calc[0]) | (stored[1] ^ calc[1]) << 8
+        | (stored[2] ^ calc[2]) << 16;
+    if (0 == d)
+        return NAND_OK;
+
+    // one bit of every pair flipped, the upper ones spell where
+    if (0x555555 == ((d ^ (d >> 1)) & 0x555555)) {
+        for (i = 0; i < 9; i++)
+            byte |= ((d >> (2 * i + 1)) & 1) << i;
+        for (i = 0; i < 3; i++)
+            bit |= ((d >> (2 * i + 19)) & 1) << i;
+        data[byte] ^= 1 << bit;
+        return NAND_CORRECTED;
+    }
+
+    // a single flip in the code itself leaves the data alone
+    if (0 == (d & (d - 1)))
+        return NAND_CORRECTED;
+    return NAND_ECC_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Tasks on other cpus take the chip too: a waiter checks 'locked', queues
+ * itself and suspends under nfc->lock, which nfc_unlock() resumes under.
+ */
+static void nfc_lock(nfc_t *nfc)
+{
+    nfc_waiter_t w;
+
+    task_lock();
+    spin_lock(&nfc->lock);
+    while (nfc->locked) {
+        w.task = current;
+        LIST_ADD_TAIL(&nfc->waiters, &w.node);
+        task_suspend(current, 0, NULL, NULL);
+        spin_unlock(&nfc->lock);
+
+        task_unlock();
+        task_lock();
+
+        spin_lock(&nfc->lock);
+        LIST_DEL(&w.node);
+    }
+    nfc->locked = TRUE;
+    spin_unlock(&nfc->lock);
+    task_unlock();
+
+    nfc->ops->select(nfc, TRUE);
+}
+
+static void nfc_unlock(nfc_t *nfc)
+{
+    list_head_t *node;
+
+    nfc->ops->select(nfc, FALSE);
+
+    task_lock();
+    spin_lock(&nfc->lock);
+    nfc->locked = FALSE;
+    node = LIST_FIRST(&nfc->waiters);
+    if (NULL != node) {
+        LIST_DEL(node);
+        task_resume(LIST_ENTRY(node, nfc_waiter_t, node)->task, 0);
+    }
+    spin_unlock(&nfc->lock);
+    task_unlock();
+}
+
+static void nfc_address(nfc_t *nfc, uint32_t col, uint32_t row)
+{
+    nfc->ops->addr(nfc, col & 0xff);
+    nfc->ops->addr(nfc, col >> 8);
+    for (uint32_t i = 0; i < nfc->row_cycles; i++)
+        nfc->ops->addr(nfc, (row >> (8 * i)) & 0xff);
+}
+
+static bool_t nfc_wait(nfc_t *nfc)
+{
+    if (nfc->ops->wait_ready(nfc, NFC_READY_TIMEOUT))
+        return TRUE;
+
+    // whatever it was doing, it is of no use now
+    nfc->ops->cmd(nfc, CMD_RESET);
+    nfc->ops->wait_ready(nfc, NFC_READY_TIMEOUT);
+    return FALSE;
+}
+
+static status_t nfc_status(nfc_t *nfc)
+{
+    uint8_t st;
+
+    if (!nfc_wait(nfc))
+        return NAND_ERROR;
+
+    nfc->ops->cmd(nfc, CMD_STATUS);
+    nfc->ops->read_buf(nfc, &st, 1);
+    return (st & (STATUS_FAIL | STATUS_FAIL_PREV)) ? NAND_ERROR : NAND_OK;
+}
+
+/* the page into the chip's register, read out from 'col' on */
+static bool_t nfc_read_start(nfc_t *nfc, uint32_t page, uint32_t col)
+{
+    nfc->ops->cmd(nfc, CMD_READ);
+    nfc_address(nfc, col, page);
+    nfc->ops->cmd(nfc, CMD_READ_START);
+    return nfc_wait(nfc);
+}
+
+static status_t nfc_worst(status_t worst, status_t st)
+{
+    if ((NAND_ERROR == worst) || (NAND_ERROR == st))
+        return NAND_ERROR;
+    if ((NAND_ECC_ERROR == st) || (NAND_OK == worst))
+        return st;
+    return worst;
+}
+
+/* zero bits of a step, the count stops past 'max' */
+static uint32_t nfc_zero_bits(const uint8_t *step, uint32_t max)
+{
+    uint32_t i, n = 0;
+    uint8_t v;
+
+    for (i = 0; (i < NFC_ECC_STEP) && (n <= max); i++) {
+        for (v = ~step[i]; v; v &= v - 1)
+            ++n;
+    }
+    return n;
+}
+
+/*
+ * The page and spare out of the register, each step through the ecc on
+ * its way. A step was never written only if its stored code and its
+ * data are both blank, a flip or so apart; a written one whose code
+ * reads blank goes through the ecc like any other.
+ */
+static status_t nfc_read_out(nfc_t *nfc, uint8_t *data, uint8_t *oob)
+{
+    const nfc_ops_t *ops = nfc->ops;
+    uint8_t *stored = nfc->spare + NFC_ECC_OFF(nfc);
+    uint8_t *code = nfc->code;
+    status_t st = NAND_OK, r;
+    uint32_t i, flips;
+
+    for (i = 0; i < NFC_STEPS(nfc); i++) {
+        if (ops->ecc_start)
+            ops->ecc_start(nfc);
+        ops->read_buf(nfc, data + i * NFC_ECC_STEP, NFC_ECC_STEP);
+        if (ops->ecc_get)
+            ops->ecc_get(nfc, code + i * NFC_ECC_BYTES);
+    }
+    ops->read_buf(nfc, nfc->spare, nfc->spare_size);
+
+    for (i = 0; i < NFC_STEPS(nfc); i++, stored += NFC_ECC_BYTES) {
+        if ((0xff == stored[0]) && (0xff == stored[1]) && (0xff == stored[2])) {
+            flips = nfc_zero_bits(data + i * NFC_ECC_STEP, NFC_ERASED_FLIPS);
+            if (flips <= NFC_ERASED_FLIPS) {
+                if (flips) {
+                    memset(data + i * NFC_ECC_STEP, 0xff, NFC_ECC_STEP);
+                    ++nfc->corrected;
+                    st = nfc_worst(st, NAND_CORRECTED);
+                }
+                continue;
+            }
+        }
+
+        if (!ops->ecc_get)
+            nfc_ecc_calc(data + i * NFC_ECC_STEP, code + i * NFC_ECC_BYTES);
+        r = nfc_ecc_correct(data + i * NFC_ECC_STEP, stored,
+            code + i * NFC_ECC_BYTES);
+        if (NAND_CORRECTED == r)
+            ++nfc->corrected;
+        else if (NAND_ECC_ERROR == r)
+            ++nfc->ecc_errors;
+        st = nfc_worst(st, r);
+    }
+
+    if (oob)
+        memcpy(oob, nfc->spare + NFC_MARKER_BYTES, nfc->nand.oob_size);
+    return st;
+}
+
+/*
+ * nfc->spare holds the spare to write. With 'data' the codes go into
+ * it on the way, without it only the spare is programmed.
+ */
+static status_t nfc_program_one(nfc_t *nfc, uint32_t page,
+    const uint8_t *data, uint8_t start)
+{
+    const nfc_ops_t *ops = nfc->ops;
+    uint8_t *code = nfc->spare + NFC_ECC_OFF(nfc);
+    uint32_t i;
+
+    ops->cmd(nfc, CMD_PROGRAM);
+    nfc_address(nfc, data ? 0 : nfc->nand.page_size, page);
+
+    if (data) {
+        for (i = 0; i < NFC_STEPS(nfc); i++, code += NFC_ECC_BYTES) {
+            if (ops->ecc_start)
+                ops->ecc_start(nfc);
+            ops->write_buf(nfc, data + i * NFC_ECC_STEP, NFC_ECC_STEP);
+            if (ops->ecc_get)
+                ops->ecc_get(nfc, code);
+            else
+                nfc_ecc_calc(data + i * NFC_ECC_STEP, code);
+        }
+    }
+    ops->write_buf(nfc, nfc->spare, nfc->spare_size);
+
+    ops->cmd(nfc, start);
+    return nfc_status(nfc);
+}
+
+static void nfc_fill_spare(nfc_t *nfc, const void *oob)
+{
+    memset(nfc->spare, 0xff, nfc->spare_size);
+    if (oob)
+        memcpy(nfc->spare + NFC_MARKER_BYTES, oob, nfc->nand.oob_size);
+}
+
+static status_t nfc_erase_one(nfc_t *nfc, uint32_t block)
+{
+    uint32_t row = block * nfc->nand.pages_per_block;
+
+    nfc->ops->cmd(nfc, CMD_ERASE);
+    for (uint32_t i = 0; i < nfc->row_cycles; i++)
+        nfc->ops->addr(nfc, (row >> (8 * i)) & 0xff);
+    nfc->ops->cmd(nfc, CMD_ERASE_START);
+    return nfc_status(nfc);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The table goes to the next of its blocks that takes it, the one it
+ * was in keeps the old version until then. Blocks failing here are bad
+ * in the table written.
+ */
+static status_t nfc_bbt_write(nfc_t *nfc)
+{
+    uint32_t first = nfc->chip_blocks - NFC_BBT_BLOCKS, blk, i, j, ver;
+
+    blk = (NFC_NO_BBT == nfc->bbt_block) ? first : nfc->bbt_block;
+    ver = nfc->bbt_version + 1;
+
+    for (i = 0; i < NFC_BBT_BLOCKS; i++) {
+        blk = (blk + 1 - first) % NFC_BBT_BLOCKS + first;
+        if (BBT_TEST(nfc, blk))
+            continue;
+
+        if (NAND_OK == nfc_erase_one(nfc, blk)) {
+            memset(nfc->page, 0xff, nfc->nand.page_size);
+            memcpy(nfc->page, nfc->bbt, (nfc->chip_blocks + 7) / 8);
+            nfc_fill_spare(nfc, NULL);
+            memcpy(nfc->spare + NFC_MARKER_BYTES, BBT_MAGIC, 4);
+            for (j = 0; j < 4; j++)
+                nfc->spare[NFC_MARKER_BYTES + 4 + j] = ver >> (8 * j);
+
+            if (NAND_OK == nfc_program_one(nfc,
+                blk * nfc->nand.pages_per_block, nfc->page,
+                CMD_PROGRAM_START)) {
+                nfc->bbt_block = blk;
+                nfc->bbt_version = ver;
+                return NAND_OK;
+            }
+        }
+        BBT_SET(nfc, blk);
+    }
+
+    return NAND_ERROR;
+}
+
+/* the newest table that reads back, checking the spares first */
+static bool_t nfc_bbt_load(nfc_t *nfc)
+{
+    uint32_t blk, page, ver, i;
+    uint8_t *m = nfc->spare + NFC_MARKER_BYTES;
+
+    for (blk = nfc->chip_blocks - NFC_BBT_BLOCKS; blk < nfc->chip_blocks;
+        blk++) {
+        page = blk * nfc->nand.pages_per_block;
+        if (!nfc_read_start(nfc, page, nfc->nand.page_size))
+            continue;
+        nfc->ops->read_buf(nfc, nfc->spare, nfc->spare_size);
+        if (0 != memcmp(m, BBT_MAGIC, 4))
+            continue;
+        for (ver = 0, i = 0; i < 4; i++)
+            ver |= m[4 + i] << (8 * i);
+        if ((NFC_NO_BBT != nfc->bbt_block) && (ver <= nfc->bbt_version))
+            continue;
+
+        if (!nfc_read_start(nfc, page, 0)
+            || (nfc_read_out(nfc, nfc->page, NULL) < 0))
+            continue;
+        memcpy(nfc->bbt, nfc->page, (nfc->chip_blocks + 7) / 8);
+        nfc->bbt_block = blk;
+        nfc->bbt_version = ver;
+    }
+
+    return (NFC_NO_BBT != nfc->bbt_block) ? TRUE : FALSE;
+}
+
+/* the factory marks a bad block in the spare of its first or second page */
+static void nfc_bbt_scan(nfc_t *nfc)
+{
+    uint32_t blk, page;
+    uint8_t mark;
+
+    memset(nfc->bbt, 0, sizeof(nfc->bbt));
+    for (blk = 0; blk < nfc->chip_blocks; blk++) {
+        for (page = 0; page < 2; page++) {
+            if (!nfc_read_start(nfc, blk * nfc->nand.pages_per_block + page,
+                nfc->nand.page_size))
+                break;
+            nfc->ops->read_buf(nfc, &mark, 1);
+            if (0xff != mark)
+                break;
+        }
+        if (page < 2)
+            BBT_SET(nfc, blk);
+    }
+}
+
+/*
+ * Samsung style id: the fourth byte has the page, spare and block size,
+ * the fifth the plane size and count, the third the cache commands.
+ */
+static bool_t nfc_geometry(nfc_t *nfc)
+{
+    uint32_t page, spare, block, pages;
+    uint8_t *id = nfc->id;
+
+    if (id[3] & 0x40)
+        return FALSE;           // 16 bit bus
+
+    page = 1024 << (id[3] & 3);
+    spare = (8 << ((id[3] >> 2) & 1)) * (page / 512);
+    block = (64 * 1024) << ((id[3] >> 4) & 3);
+    pages = (((8 * 1024 * 1024) << ((id[4] >> 4) & 7))
+        << ((id[4] >> 2) & 3)) / page;
+
+    if ((page > NFC_PAGE_MAX) || (spare > NFC_SPARE_MAX))
+        return FALSE;
+    if (spare <= NFC_MARKER_BYTES + page / NFC_ECC_STEP * NFC_ECC_BYTES)
+        return FALSE;
+
+    nfc->spare_size = spare;
+    nfc->row_cycles = (pages > 65536) ? 3 : 2;
+    nfc->cache_ops = (id[2] & 0x80) ? TRUE : FALSE;
+    nfc->chip_blocks = pages / (block / page);
+    if ((nfc->chip_blocks > NFC_BLOCK_MAX)
+        || (nfc->chip_blocks <= NFC_BBT_BLOCKS))
+        return FALSE;
+
+    nfc->nand.page_size = page;
+    nfc->nand.oob_size = spare - NFC_MARKER_BYTES
+        - page / NFC_ECC_STEP * NFC_ECC_BYTES;
+    nfc->nand.pages_per_block = block / page;
+    nfc->nand.nr_blocks = nfc->chip_blocks - NFC_BBT_BLOCKS;
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------------*/
+
+static status_t nfc_read(nand_t *nand, uint32_t page, void *data,
+    void *oob)
+{
+    nfc_t *nfc = NFC(nand);
+    status_t st = NAND_OK;
+
+    nfc_lock(nfc);
+
+    if (data) {
+        st = nfc_read_start(nfc, page, 0) ?
+            nfc_read_out(nfc, data, oob) : NAND_ERROR;
+    } else if (oob) {
+        // the spare alone, unchecked like the ecc leaves it
+        if (nfc_read_start(nfc, page, nand->page_size)) {
+            nfc->ops->read_buf(nfc, nfc->spare, nfc->spare_size);
+            memcpy(oob, nfc->spare + NFC_MARKER_BYTES, nand->oob_size);
+        } else {
+            st = NAND_ERROR;
+        }
+    }
+
+    nfc_unlock(nfc);
+    return st;
+}
+
+static status_t nfc_program(nand_t *nand, uint32_t page, const void *data,
+    const void *oob)
+{
+    nfc_t *nfc = NFC(nand);
+    status_t st = NAND_ERROR;
+
+    nfc_lock(nfc);
+    if (!BBT_TEST(nfc, page / nand->pages_per_block)) {
+        nfc_fill_spare(nfc, oob);
+        st = nfc_program_one(nfc, page, data, CMD_PROGRAM_START);
+    }
+    nfc_unlock(nfc);
+
+    return st;
+}
+
+/* a bad block is never erased, that would take its marker */
+static status_t nfc_erase(nand_t *nand, uint32_t block)
+{
+    nfc_t *nfc = NFC(nand);
+    status_t st = NAND_ERROR;
+
+    nfc_lock(nfc);
+    if (!BBT_TEST(nfc, block))
+        st = nfc_erase_one(nfc, block);
+    nfc_unlock(nfc);
+
+    return st;
+}
+
+static bool_t nfc_is_bad(nand_t *nand, uint32_t block)
+{
+    return BBT_TEST(NFC(nand), block) ? TRUE : FALSE;
+}
+
+/* the marker is for other software, the table is what counts here */
+static status_t nfc_mark_bad(nand_t *nand, uint32_t block)
+{
+    nfc_t *nfc = NFC(nand);
+    status_t st;
+
+    nfc_lock(nfc);
+
+    BBT_SET(nfc, block);
+    nfc_fill_spare(nfc, NULL);
+    memset(nfc->spare, 0, NFC_MARKER_BYTES);
+    nfc_program_one(nfc, block * nand->pages_per_block, NULL,
+        CMD_PROGRAM_START);
+    st = nfc_bbt_write(nfc);
+
+    nfc_unlock(nfc);
+    return st;
+}
+
+/*
+ * One read command, then the cache read hands out each page while the
+ * chip already fetches the next one from the array.
+ */
+static status_t nfc_read_pages(nand_t *nand, uint32_t page, uint32_t nr,
+    void *data, void *oob)
+{
+    nfc_t *nfc = NFC(nand);
+    uint8_t *d = (uint8_t *)data, *o = (uint8_t *)oob;
+    status_t st = NAND_OK;
+
+    if ((NULL == data) || !nfc->cache_ops || (nr < 2)) {
+        for (; nr && (NAND_ERROR != st); nr--, page++) {
+            st = nfc_worst(st, nfc_read(nand, page, d, o));
+            d = d ? d + nand->page_size : NULL;
+            o = o ? o + nand->oob_size : NULL;
+        }
+        return st;
+    }
+
+    nfc_lock(nfc);
+
+    if (!nfc_read_start(nfc, page, 0))
+        st = NAND_ERROR;
+    for (; nr && (NAND_ERROR != st); nr--) {
+        nfc->ops->cmd(nfc, (nr > 1) ? CMD_READ_CACHE : CMD_READ_CACHE_END);
+        if (!nfc_wait(nfc)) {
+            st = NAND_ERROR;
+            break;
+        }
+        ++nfc->cache_reads;
+
+        st = nfc_worst(st, nfc_read_out(nfc, d, o));
+        d += nand->page_size;
+        o = o ? o + nand->oob_size : NULL;
+    }
+
+    nfc_unlock(nfc);
+    return st;
+}
+
+/* the chip programs one page while the next one is moved in */
+static status_t nfc_program_pages(nand_t *nand, uint32_t page, uint32_t nr,
+    const void *data, const void *oob)
+{
+    nfc_t *nfc = NFC(nand);
+    const uint8_t *d = (const uint8_t *)data, *o = (const uint8_t *)oob;
+    status_t st = NAND_OK;
+    uint8_t start;
+
+    nfc_lock(nfc);
+
+    for (; nr && (NAND_OK == st); nr--, page++) {
+        if (BBT_TEST(nfc, page / nand->pages_per_block)) {
+            st = NAND_ERROR;
+            break;
+        }
+
+        start = (nfc->cache_ops && (nr > 1)) ?
+            CMD_PROGRAM_CACHE : CMD_PROGRAM_START;
+        nfc_fill_spare(nfc, o);
+        st = nfc_program_one(nfc, page, d, start);
+
+        d = d ? d + nand->page_size : NULL;
+        o = o ? o + nand->oob_size : NULL;
+    }
+
+    nfc_unlock(nfc);
+    return st;
+}
+
+const nand_ops_t nfc_nand_ops = {
+    .read = nfc_read,
+    .program = nfc_program,
+    .erase = nfc_erase,
+    .is_bad = nfc_is_bad,
+    .mark_bad = nfc_mark_bad,
+    .read_pages = nfc_read_pages,
+    .program_pages = nfc_program_pages,
+};
+
+/*--------------------------------------------------------------------------*/
+
+status_t nfc_attach(nfc_t *nfc)
+{
+    status_t st = NAND_OK;
+
+    INIT_SPINLOCK(&nfc->lock);
+    INIT_LIST_HEAD(&nfc->waiters);
+    nfc->locked = FALSE;
+    nfc->bbt_block = NFC_NO_BBT;
+    nfc->bbt_version = 0;
+
+    nfc_lock(nfc);
+
+    nfc->ops->cmd(nfc, CMD_RESET);
+    if (!nfc->ops->wait_ready(nfc, NFC_READY_TIMEOUT)) {
+        nfc_unlock(nfc);
+        return NAND_ERROR;
+    }
+    nfc->ops->cmd(nfc, CMD_READ_ID);
+    nfc->ops->addr(nfc, 0);
+    nfc->ops->read_buf(nfc, nfc->id, sizeof(nfc->id));
+
+    if (!nfc_geometry(nfc)) {
+        st = NAND_ERROR;
+    } else if (!nfc_bbt_load(nfc)) {
+        // the first boot only, or every boot if no table block takes it
+        nfc_bbt_scan(nfc);
+        nfc_bbt_write(nfc);
+    }
+
+    nfc_unlock(nfc);
+    return st;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF nfc.c
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_NFC_H_
+#define _MINIOS_NFC_H_
+
+#include "os/nand.h"
+#include "os/task.h"
+
+/* the largest chip the buffers are sized for */
+#ifndef NFC_PAGE_MAX
+#define NFC_PAGE_MAX            2048
+#endif
+#ifndef NFC_SPARE_MAX
+#define NFC_SPARE_MAX           64
+#endif
+#ifndef NFC_BLOCK_MAX
+#define NFC_BLOCK_MAX           4096
+#endif
+
+/* the last blocks of the chip take turns holding the bad block table */
+#ifndef NFC_BBT_BLOCKS
+#define NFC_BBT_BLOCKS          2
+#endif
+
+/* polls of the ready line before an operation counts as failed */
+#ifndef NFC_READY_TIMEOUT
+#define NFC_READY_TIMEOUT       1000000
+#endif
+
+/* a 3 byte hamming code per step, 1 bit corrected and 2 detected */
+#define NFC_ECC_STEP            512
+#define NFC_ECC_BYTES           3
+
+/* spare: the bad block marker, the bytes left to users, the ecc last */
+#define NFC_MARKER_BYTES        2
+
+struct nfc;
+
+/*
+ * The controller at register level, all the driver needs of it. The
+ * chip is selected around every operation. ecc_start() and ecc_get()
+ * are for a hardware ecc generator over the bytes the buffers move in
+ * between, NULL has the driver compute the codes itself.
+ */
+typedef struct nfc_ops {
+    void (*select)(struct nfc *, bool_t on);
+    void (*cmd)(struct nfc *, uint8_t cmd);
+    void (*addr)(struct nfc *, uint8_t addr);
+    void (*read_buf)(struct nfc *, void *buf, uint32_t len);
+    void (*write_buf)(struct nfc *, const void *buf, uint32_t len);
+    bool_t (*wait_ready)(struct nfc *, uint32_t polls);
+    void (*ecc_start)(struct nfc *);
+    void (*ecc_get)(struct nfc *, uint8_t *code);
+} nfc_ops_t;
+
+/*
+ * A large page nand chip behind a controller, seen as the nand_t in it.
+ * The nand_t leaves out the blocks of the bad block table.
+ */
+typedef struct nfc {
+    nand_t nand;
+    const nfc_ops_t *ops;
+    void *priv;
+    uint8_t id[5];
+    bool_t cache_ops;           /* the chip has cache read and program */
+    uint32_t chip_blocks;
+    uint32_t spare_size;
+    uint32_t row_cycles;
+    uint32_t bbt_block;         /* holding the table now, or NFC_NO_BBT */
+    uint32_t bbt_version;
+    spinlock_t lock;            /* 'locked' and the waiters */
+    bool_t locked;
+    list_head_t waiters;
+    uint32_t cache_reads;       /* pages that came out of a pipelined read */
+    uint32_t corrected;
+    uint32_t ecc_errors;
+    uint8_t bbt[NFC_BLOCK_MAX / 8];     /* a bit set per bad block */
+    uint8_t spare[NFC_SPARE_MAX];
+    uint8_t code[NFC_PAGE_MAX / NFC_ECC_STEP * NFC_ECC_BYTES];
+    uint8_t page[NFC_PAGE_MAX] __attribute__((aligned(32)));
+} nfc_t;
+
+#define NFC_NO_BBT              0xffffffff
+
+extern const nand_ops_t nfc_nand_ops;
+
+#define DECLARE_NFC(_name, _ops, _priv)                                     \
+nfc_t _name = {                                                             \
+    .nand = {                                                               \
+        .name = #_name,                                                     \
+        .ops = &nfc_nand_ops,                                               \
+        .priv = &_name,                                                     \
+    },                                                                      \
+    .ops = (_ops),                                                          \
+    .priv = (_priv),                                                        \
+}
+
+/*
+ * Task context. Resets and identifies the chip, then loads the newest
+ * bad block table, or scans the factory markers and writes one. The
+ * nand_t is usable once it returned NAND_OK.
+ */
+status_t nfc_attach(nfc_t *nfc);
+
+/* the code of one step, and the step checked against it */
+void nfc_ecc_calc(const uint8_t *data, uint8_t *code);
+status_t nfc_ecc_correct(uint8_t *data, const uint8_t *stored,
+    const uint8_t *calc);
+
+#endif // _MINIOS_NFC_H_
+// EOF nfc.h
@@ -0,0 +1,35 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/ramdisk.h"
+#include "os/string.h"
+
+static void ramdisk_start(device_t *dev, dev_request_t *req)
+{
+    ramdisk_t *rd = (ramdisk_t *)dev->priv;
+    uint8_t *p = rd->mem + req->pos * BLOCK_SIZE;
+
+    if ((req->pos >= rd->nr_blocks)
+        || (req->len > (rd->nr_blocks - req->pos) * BLOCK_SIZE)) {
+        dev_complete(req, DEV_ERROR);
+        return;
+    }
+
+    if (DEV_READ == req->op)
+        memcpy(req->buf, p, req->len);
+    else if (DEV_WRITE == req->op)
+        memcpy(p, req->buf, req->len);
+
+    dev_complete(req, DEV_OK);
+}
+
+const dev_ops_t ramdisk_ops = {
+    .start = ramdisk_start,
+};
+
+/*--------------------------------------------------------------------------*/
+// EOF ramdisk.c
@@ -0,0 +1,30 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_RAMDISK_H_
+#define _MINIOS_RAMDISK_H_
+
+#include "os/block.h"
+
+typedef struct {
+    uint8_t *mem;
+    uint32_t nr_blocks;
+} ramdisk_t;
+
+extern const dev_ops_t ramdisk_ops;
+
+/*
+ * A block device in 'nr' blocks of memory, found as #_name. Requests
+ * complete at once, in the context that starts them.
+ */
+#define DECLARE_RAMDISK(_name, _nr)                                         \
+static uint8_t _name##_mem[(_nr) * BLOCK_SIZE];                             \
+static ramdisk_t _name##_disk = {_name##_mem, (_nr)};                       \
+DECLARE_DEVICE(_name, &ramdisk_ops, &_name##_disk, 4)
+
+#endif // _MINIOS_RAMDISK_H_
+// EOF ramdisk.h
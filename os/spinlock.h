@@ -0,0 +1,78 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_SPINLOCK_H_
+#define _MINIOS_SPINLOCK_H_
+
+#include "os/minios_type.h"
+#include "port/port.h"
+
+/* number of cpus, set with -DCPU_NR=n for smp builds */
+#ifndef CPU_NR
+#define CPU_NR 1
+#endif
+
+#if ((CPU_NR <= 0) || (CPU_NR > 32))
+#error CPU_NR is out of range(1 ~ 32)
+#endif
+
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT {0}
+#define INIT_SPINLOCK(lock) do { (lock)->locked = 0; } while (0)
+
+/*
+ * On one cpu task_lock() and masking interrupts already exclude every
+ * other path, so the locks compile away and the uniprocessor kernel
+ * stays as it was. With more cpus task_lock() only holds off the cpu
+ * it runs on, data shared across cpus needs a spinlock as well.
+ */
+#if (CPU_NR > 1)
+
+static inline void spin_lock(spinlock_t *lock)
+{
+    while (HAL_ATOMIC_SWAP(&lock->locked, 1))
+        HAL_CPU_RELAX();
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    HAL_ATOMIC_SWAP(&lock->locked, 0);
+}
+
+#else
+
+#define spin_lock(lock)   ((void)(lock))
+#define spin_unlock(lock) ((void)(lock))
+
+#endif
+
+/*
+ * A lock an isr takes too is taken with irq masked everywhere, or the
+ * isr would spin for ever on the cpu holding it. Hsrs never run on a
+ * cpu inside task_lock(), so against them a task takes task_lock() and
+ * then spin_lock(); hsrs themselves use the irqsave variant.
+ */
+static inline cpu_flags_t spin_lock_irqsave(spinlock_t *lock)
+{
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock,
+    cpu_flags_t flags)
+{
+    spin_unlock(lock);
+    HAL_IRQ_RESTORE(flags);
+}
+
+#endif // _MINIOS_SPINLOCK_H_
+// EOF spinlock.h
@@ -0,0 +1,186 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/string.h"
+#include "port/port.h"
+
+/* word accesses to memory of any type */
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+#define WORD_SIZE       sizeof(word_t)
+#define WORD_MASK       (WORD_SIZE - 1)
+#define ALIGNED(p)      (0 == ((address_t)(p) & WORD_MASK))
+
+/*--------------------------------------------------------------------------*/
+
+#ifndef HAL_ARCH_MEMCPY
+/* by words, 4 at a time, when both sides can be aligned together */
+void *memcpy(void *dst, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    word_t *dw;
+    const word_t *sw;
+
+    if ((n >= WORD_SIZE) && ALIGNED((address_t)d ^ (address_t)s)) {
+        while (!ALIGNED(d)) {
+            *d++ = *s++;
+            --n;
+        }
+
+        dw = (word_t *)d;
+        sw = (const word_t *)s;
+        for (; n >= 4 * WORD_SIZE; n -= 4 * WORD_SIZE) {
+            dw[0] = sw[0];
+            dw[1] = sw[1];
+            dw[2] = sw[2];
+            dw[3] = sw[3];
+            dw += 4;
+            sw += 4;
+        }
+        for (; n >= WORD_SIZE; n -= WORD_SIZE)
+            *dw++ = *sw++;
+
+        d = (uint8_t *)dw;
+        s = (const uint8_t *)sw;
+    }
+
+    while (n--)
+        *d++ = *s++;
+
+    return dst;
+}
+#endif
+
+#ifndef HAL_ARCH_MEMSET
+void *memset(void *dst, int c, size_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t v = (uint8_t)c;
+    word_t *dw;
+
+    if (n >= WORD_SIZE) {
+        v |= v << 8;
+        v |= v << 16;
+
+        while (!ALIGNED(d)) {
+            *d++ = (uint8_t)v;
+            --n;
+        }
+
+        dw = (word_t *)d;
+        for (; n >= 4 * WORD_SIZE; n -= 4 * WORD_SIZE) {
+            dw[0] = v;
+            dw[1] = v;
+            dw[2] = v;
+            dw[3] = v;
+            dw += 4;
+        }
+        for (; n >= WORD_SIZE; n -= WORD_SIZE)
+            *dw++ = v;
+
+        d = (uint8_t *)dw;
+    }
+
+    while (n--)
+        *d++ = (uint8_t)v;
+
+    return dst;
+}
+#endif
+
+/* forwards unless dst overlaps the end of src */
+void *memmove(void *dst, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    word_t *dw;
+    const word_t *sw;
+
+    if ((d <= s) || (d >= s + n))
+        return memcpy(dst, src, n);
+
+    d += n;
+    s += n;
+
+    if ((n >= WORD_SIZE) && ALIGNED((address_t)d ^ (address_t)s)) {
+        while (!ALIGNED(d)) {
+            *--d = *--s;
+            --n;
+        }
+
+        dw = (word_t *)d;
+        sw = (const word_t *)s;
+        for (; n >= WORD_SIZE; n -= WORD_SIZE)
+            *--dw = *--sw;
+
+        d = (uint8_t *)dw;
+        s = (const uint8_t *)sw;
+    }
+
+    while (n--)
+        *--d = *--s;
+
+    return dst;
+}
+
+/* skip equal words, the first different one is compared by bytes */
+int memcmp(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *a = (const uint8_t *)s1;
+    const uint8_t *b = (const uint8_t *)s2;
+
+    if (ALIGNED(a) && ALIGNED(b)) {
+        while ((n >= WORD_SIZE) && (*(const word_t *)a == *(const word_t *)b)) {
+            a += WORD_SIZE;
+            b += WORD_SIZE;
+            n -= WORD_SIZE;
+        }
+    }
+
+    for (; n; --n, ++a, ++b) {
+        if (*a != *b)
+            return *a - *b;
+    }
+
+    return 0;
+}
+
+/* a word has a zero byte if one of its bytes borrows on subtraction */
+#define HAS_ZERO_BYTE(w) (((w) - 0x01010101) & ~(w) & 0x80808080)
+
+size_t strlen(const char *s)
+{
+    const char *p = s;
+    const word_t *w;
+
+    while (!ALIGNED(p)) {
+        if ('\0' == *p)
+            return p - s;
+        ++p;
+    }
+
+    // aligned word reads never cross into an unmapped page
+    for (w = (const word_t *)p; !HAS_ZERO_BYTE(*w); w++);
+
+    for (p = (const char *)w; *p; p++);
+
+    return p - s;
+}
+
+int strcmp(const char *s1, const char *s2)
+{
+    while (*s1 && (*s1 == *s2)) {
+        ++s1;
+        ++s2;
+    }
+
+    return (uint8_t)*s1 - (uint8_t)*s2;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF string.c
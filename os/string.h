@@ -0,0 +1,26 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_STRING_H_
+#define _MINIOS_STRING_H_
+
+#include "os/minios_type.h"
+
+/*
+ * The usual names, so what gcc emits for struct copies links too. The
+ * port may provide memcpy and memset in assembly (HAL_ARCH_MEMCPY,
+ * HAL_ARCH_MEMSET), os/string.c has c versions of the rest.
+ */
+void *memcpy(void *dst, const void *src, size_t n);
+void *memmove(void *dst, const void *src, size_t n);
+void *memset(void *dst, int c, size_t n);
+int memcmp(const void *s1, const void *s2, size_t n);
+size_t strlen(const char *s);
+int strcmp(const char *s1, const char *s2);
+
+#endif // _MINIOS_STRING_H_
+// EOF string.h
@@ -7,6 +7,7 @@
 
 #include "os/task.h"
 #include "os/hsr.h"
+#include "os/boottime.h"
 #include "port/port.h"
 
 /*--------------------------------------------------------------------------*/
@@ -21,11 +22,21 @@ typedef struct {
 } sched_bitmap_t;
 
 typedef struct {
+    spinlock_t lock;
     uint32_t highest_priority;
+    uint32_t nr_ready;
     sched_bitmap_t queue_map;
     list_head_t queue_array[SCHED_PRIORITY_MAX_NR];
+    /* edf tasks, min-heap on abs_deadline */
+    uint32_t edf_nr;
+    task_t *edf_heap[SCHED_EDF_MAX_NR];
+    /* statistics */
+    uint32_t switches;
+    uint32_t steals;
 } run_queue_t;
 
+extern volatile uint32_t jiffies;
+
 /*--------------------------------------------------------------------------*/
 
 static inline void rq_bitmap_set(sched_bitmap_t *map, int32_t nr)
@@ -48,17 +59,105 @@ static inline void rq_bitmap_clear(sched_bitmap_t *map, int32_t nr)
     map->bitmap[group_nr] = value;
 }
 
+static inline bool_t edf_before(task_t *a, task_t *b)
+{
+    return time_before(a->abs_deadline, b->abs_deadline);
+}
+
+static inline void edf_heap_set(run_queue_t *rq, uint32_t i, task_t *task)
+{
+    rq->edf_heap[i] = task;
+    task->edf_index = i;
+}
+
+static void edf_sift_up(run_queue_t *rq, uint32_t i)
+{
+    task_t *task = rq->edf_heap[i];
+    uint32_t parent;
+
+    while (i > 0) {
+        parent = (i - 1) >> 1;
+        if (!edf_before(task, rq->edf_heap[parent]))
+            break;
+        edf_heap_set(rq, i, rq->edf_heap[parent]);
+        i = parent;
+    }
+    edf_heap_set(rq, i, task);
+}
+
+static void edf_sift_down(run_queue_t *rq, uint32_t i)
+{
+    task_t *task = rq->edf_heap[i];
+    uint32_t child;
+
+    while ((child = (i << 1) + 1) < rq->edf_nr) {
+        if ((child + 1 < rq->edf_nr) &&
+            edf_before(rq->edf_heap[child + 1], rq->edf_heap[child]))
+            ++child;
+        if (!edf_before(rq->edf_heap[child], task))
+            break;
+        edf_heap_set(rq, i, rq->edf_heap[child]);
+        i = child;
+    }
+    edf_heap_set(rq, i, task);
+}
+
+static void edf_heap_add(run_queue_t *rq, task_t *task)
+{
+    BUG_ON(rq->edf_nr >= SCHED_EDF_MAX_NR);
+    edf_heap_set(rq, rq->edf_nr++, task);
+    edf_sift_up(rq, task->edf_index);
+}
+
+static void edf_heap_delete(run_queue_t *rq, task_t *task)
+{
+    uint32_t i = task->edf_index;
+    task_t *last;
+
+    BUG_ON(rq->edf_heap[i] != task);
+
+    last = rq->edf_heap[--rq->edf_nr];
+    if (last != task) {
+        edf_heap_set(rq, i, last);
+        edf_sift_up(rq, i);
+        edf_sift_down(rq, last->edf_index);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+static task_t *rq_pick(run_queue_t *rq);
+
+/* hard-throttled tasks are runnable but kept off run_queue */
+static inline bool_t task_parked(task_t *task)
+{
+    return ((task->flags & TASK_THROTTLED) &&
+            (task->reserve->flags & RESERVE_HARD)) ? TRUE : FALSE;
+}
+
+static inline bool_t task_in_edf_heap(task_t *task)
+{
+    return ((task->flags & TASK_SCHED_EDF) &&
+            !(task->flags & TASK_THROTTLED)) ? TRUE : FALSE;
+}
+
 static void rq_task_add(run_queue_t *rq, task_t *task, int first)
 {
     uint8_t priority = task->priority;
     list_head_t *list = rq->queue_array + priority;
 
-    if (first)
+    if (task_parked(task))
+        return;
+
+    if (task_in_edf_heap(task))
+        edf_heap_add(rq, task);
+    else if (first)
         LIST_ADD(list, &task->ready_node);
     else
         LIST_ADD_TAIL(list, &task->ready_node);
 
     rq_bitmap_set(&rq->queue_map, priority);
+    ++rq->nr_ready;
 
     if (rq->highest_priority > priority)
         rq->highest_priority = priority;
@@ -67,6 +166,11 @@ static void rq_task_add(run_queue_t *rq, task_t *task, int first)
 static inline void rq_task_move_tail(run_queue_t *rq, task_t *task)
 {
     list_head_t *list = rq->queue_array + task->priority;
+
+    // edf tasks stay ordered by deadline
+    if (task_parked(task) || task_in_edf_heap(task))
+        return;
+
     LIST_DEL(&task->ready_node);
     LIST_ADD_TAIL(list, &task->ready_node);
 }
@@ -76,9 +180,18 @@ static void rq_task_delete(run_queue_t *rq, task_t *task)
     uint8_t priority = task->priority;
     list_head_t *list = rq->queue_array + priority;
 
-    LIST_DEL(&task->ready_node);
+    if (task_parked(task))
+        return;
+
+    if (task_in_edf_heap(task))
+        edf_heap_delete(rq, task);
+    else
+        LIST_DEL(&task->ready_node);
+
+    --rq->nr_ready;
 
-    if (LIST_EMPTY(list)) {
+    if (LIST_EMPTY(list) &&
+        ((priority != SCHED_EDF_PRIORITY) || (0 == rq->edf_nr))) {
         rq_bitmap_clear(&rq->queue_map, priority);
 
         if (rq->highest_priority == priority) {
@@ -91,22 +204,123 @@ static void rq_task_delete(run_queue_t *rq, task_t *task)
 
 /*--------------------------------------------------------------------------*/
 
-static run_queue_t run_queue;
-uint32_t task_switches;
-int32_t sched_lock = 1;
-task_t *current;
+static run_queue_t run_queues[CPU_NR] HAL_FAST_DATA;
+uint32_t task_switches HAL_FAST_DATA;
+
+#if (CPU_NR > 1)
+task_t *cpu_current[CPU_NR];
+int32_t cpu_sched_lock[CPU_NR] = {[0 ... CPU_NR - 1] = 1};
+static task_t *cpu_prev[CPU_NR];
+
+int cpu_id(void)
+{
+    return HAL_CPU_ID();
+}
+#else
+int32_t sched_lock HAL_FAST_DATA = 1;
+task_t *current HAL_FAST_DATA;
+#endif
+
+#define cpu_rq(cpu)    (run_queues + (cpu))
+#define this_rq()      cpu_rq(cpu_id())
+#define task_rq(task)  cpu_rq((task)->cpu)
+
+/* lock the run_queue of a task, it may move while we wait for it */
+static run_queue_t *task_rq_lock(task_t *task)
+{
+    run_queue_t *rq;
+
+    while (1) {
+        rq = task_rq(task);
+        spin_lock(&rq->lock);
+        if (rq == task_rq(task))
+            return rq;
+        spin_unlock(&rq->lock);
+    }
+}
+
+static inline void rq_unlock(run_queue_t *rq)
+{
+    spin_unlock(&rq->lock);
+}
+
+static sched_band_t sched_bands[SCHED_PRIORITY_MAX_NR];
+static LIST_HEAD(demoted_tasks);
+static spinlock_t demote_lock = SPINLOCK_INIT;
+static int32_t sched_boost_period = SCHED_BOOST_PERIOD;
+static uint32_t sched_next_boost;
+
+static inline int32_t sched_quantum(uint8_t priority)
+{
+    return sched_bands[priority].quantum;
+}
+
+/* move a task not on run_queue to a new priority, tracking demotion */
+static void task_set_priority(task_t *task, uint8_t priority)
+{
+    task->priority = priority;
+    task->time_slice = sched_quantum(priority);
+
+    spin_lock(&demote_lock);
+    if (priority == task->default_priority) {
+        if (LIST_INLIST(&task->demote_node))
+            LIST_DEL(&task->demote_node);
+    } else if (!LIST_INLIST(&task->demote_node)) {
+        LIST_ADD_TAIL(&demoted_tasks, &task->demote_node);
+    }
+    spin_unlock(&demote_lock);
+}
+
+/*
+ * On smp a task that is switched out stays 'on_cpu' until the next one
+ * runs, so no other cpu steals it while its context is still being saved.
+ */
+static inline void task_switch_prepare(task_t *from, task_t *to)
+{
+#if (CPU_NR > 1)
+    to->on_cpu = 1;
+    cpu_prev[cpu_id()] = from;
+#endif
+}
+
+static inline void task_switch_finish(void)
+{
+#if (CPU_NR > 1)
+    task_t *prev = cpu_prev[cpu_id()];
+    if (NULL != prev)
+        prev->on_cpu = 0;
+#endif
+}
+
+/* reschedule request to the cpu a task was woken up on */
+static inline void task_kick_cpu(run_queue_t *rq, task_t *task)
+{
+#if (CPU_NR > 1)
+    if ((task->cpu != cpu_id()) && (rq_pick(rq) == task))
+        HAL_CPU_KICK(task->cpu);
+#endif
+}
 
 /*--------------------------------------------------------------------------*/
 
-task_t *rq_pick_task(void)
+static task_t *rq_pick(run_queue_t *rq)
 {
-    run_queue_t *rq = &run_queue;
     list_head_t *list = rq->queue_array + rq->highest_priority;
-    list_head_t *node = LIST_FIRST(list);
+    list_head_t *node;
+
+    if ((SCHED_EDF_PRIORITY == rq->highest_priority) && (rq->edf_nr > 0))
+        return rq->edf_heap[0];
+
+    node = LIST_FIRST(list);
     BUG_ON(NULL == node);
     return LIST_ENTRY(node, task_t, ready_node);
 }
 
+task_t *rq_pick_task(void)
+{
+    return rq_pick(this_rq());
+}
+
 bool_t need_sched(void)
 {
     if (sched_lock > 0)
@@ -117,6 +331,7 @@ bool_t need_sched(void)
 
 static void schedule(void)
 {
+    run_queue_t *rq;
     task_t *from;
     task_t *to;
 
@@ -124,20 +339,35 @@ static void schedule(void)
 
     sched_lock = 0;
 
+    rq = this_rq();
+    spin_lock(&rq->lock);
+
     from = current;
-    to = rq_pick_task();
+    to = rq_pick(rq);
 
     if (from != to) {
         // count task switch
         task_switches++;
-
-        // save time slice
-        if (TASK_SUSPEND == from->state)
-            from->time_slice = TICK_SCHED_QUANTUM;
+        rq->switches++;
+
+        // blocked before its slice ran out, credit one level back; a
+        // throttled task stays where its reservation put it
+        if ((TASK_SUSPEND == from->state) && !(from->flags & TASK_THROTTLED)) {
+            if ((from->flags & TICK_SCHED_ENABLED) && (from->time_slice > 0) &&
+                (from->priority > from->default_priority))
+                task_set_priority(from, from->priority - 1);
+            else
+                from->time_slice = sched_quantum(from->priority);
+        }
 
         // switch context
         current = to;
+        task_switch_prepare(from, to);
+        rq_unlock(rq);
         HAL_TASK_SWITCH_CONTEXT(&to->stack, &from->stack);
+        task_switch_finish();
+    } else {
+        rq_unlock(rq);
     }
 
     HAL_ENABLE_INTERRUPTS();
@@ -153,6 +383,8 @@ void task_unlock(void)
     extern void handle_pending_hsrs(void);
     int32_t lock = sched_lock - 1;
     if (lock <= 0) {
+        // hsrs only run unlocked, drop it before draining them
+        sched_lock = 0;
         handle_pending_hsrs();
         schedule();
     } else {
@@ -162,8 +394,9 @@ void task_unlock(void)
 
 /*--------------------------------------------------------------------------*/
 
-void task_create(task_t *task, char *name, uint8_t priority, uint8_t options,
-    address_t stack_base, uint32_t stack_size, task_entry_t entry, void *para)
+static void task_init(task_t *task, char *name, uint8_t priority,
+    uint8_t options, address_t stack_base, uint32_t stack_size,
+    task_entry_t entry, void *para)
 {
     BUG_ON(priority >= SCHED_PRIORITY_MAX_NR);
 
@@ -178,28 +411,48 @@ void task_create(task_t *task, char *name, uint8_t priority, uint8_t options,
     task->time_slice = 0;
     INIT_TIMER(&task->timer);
     INIT_LIST_HEAD(&task->ready_node);
+    INIT_LIST_HEAD(&task->demote_node);
+    INIT_LIST_HEAD(&task->reserve_node);
+    task->reserve = NULL;
+    task->cpu = cpu_id();
+    task->on_cpu = 0;
     task->name = name;
 
     if (options & TICK_SCHED_ENABLED) {
         task->flags |= TICK_SCHED_ENABLED;
-        task->time_slice = TICK_SCHED_QUANTUM;
+        task->time_slice = sched_quantum(priority);
     }
 
-    HAL_TASK_BUILD_STACK(&task->stack);
+    HAL_TASK_BUILD_STACK(&task->stack, stack_base);
+}
 
+void task_create(task_t *task, char *name, uint8_t priority, uint8_t options,
+    address_t stack_base, uint32_t stack_size, task_entry_t entry, void *para)
+{
+    task_init(task, name, priority, options, stack_base, stack_size,
+        entry, para);
     task_resume(task, 0);
 }
 
 static void task_timeout(void *para)
 {
     task_t *task = (task_t *)para;
+    run_queue_t *rq;
+
     if (TASK_SUSPEND != task->state)
         return;
 
-    BUG_ON(!(task->flags & TASK_TIMER_ACTIVE));
     BUG_ON(TIMER_ACTIVE(&task->timer));
 
+    // lost the race with a task_resume() on another cpu
+    rq = task_rq_lock(task);
+    if ((TASK_SUSPEND != task->state) ||
+        !(task->flags & TASK_TIMER_ACTIVE)) {
+        rq_unlock(rq);
+        return;
+    }
     task->flags &= ~TASK_TIMER_ACTIVE;
+    rq_unlock(rq);
 
     if (NULL != task->cleanup)
         task->cleanup(task->cleanup_info);
@@ -207,36 +460,63 @@ static void task_timeout(void *para)
     task_resume(task, 0);
 }
 
-void task_suspend(task_t *task, int32_t timeout, cleanup_t cleanup, void *info)
+static void task_suspend_until(task_t *task, bool_t timed, uint32_t expires,
+    cleanup_t cleanup, void *info)
 {
-    if (task->state != TASK_RUNNING)
-        return;
+    run_queue_t *rq;
 
     task_lock();
 
-    if (timeout > 0) {
-        task->flags |= TASK_TIMER_ACTIVE;
-        BUG_ON(TIMER_ACTIVE(&task->timer));
-        timer_start(&task->timer, timeout, task_timeout, task);
+    rq = task_rq_lock(task);
+    if (TASK_RUNNING != task->state) {
+        rq_unlock(rq);
+        task_unlock();
+        return;
     }
-
     task->cleanup = cleanup;
     task->cleanup_info = info;
     task->state = TASK_SUSPEND;
-    rq_task_delete(&run_queue, task);
+    rq_task_delete(rq, task);
+
+    // armed before the rq lock goes, a task_resume() on another cpu then
+    // always finds the flag and the timer together
+    if (timed) {
+        BUG_ON(TIMER_ACTIVE(&task->timer));
+        timer_start_at(&task->timer, expires, task_timeout, task);
+        task->flags |= TASK_TIMER_ACTIVE;
+    }
+    rq_unlock(rq);
 
     task_unlock();
 }
 
+void task_suspend(task_t *task, int32_t timeout, cleanup_t cleanup, void *info)
+{
+    if (task->state != TASK_RUNNING)
+        return;
+
+    task_suspend_until(task, (timeout > 0) ? TRUE : FALSE, jiffies + timeout,
+        cleanup, info);
+}
+
 void task_resume(task_t *task, int first)
 {
+    run_queue_t *rq;
+
     if (task->state != TASK_SUSPEND)
         return;
 
     task_lock();
 
+    rq = task_rq_lock(task);
+    if (TASK_SUSPEND != task->state) {
+        rq_unlock(rq);
+        task_unlock();
+        return;
+    }
+
+    // the timer may be expiring on another cpu right now
     if (task->flags & TASK_TIMER_ACTIVE) {
-        BUG_ON(!TIMER_ACTIVE(&task->timer));
         timer_stop(&task->timer);
         task->flags &= ~TASK_TIMER_ACTIVE;
     }
@@ -244,60 +524,340 @@ void task_resume(task_t *task, int first)
     task->cleanup = NULL;
     task->cleanup_info = NULL;
     task->state = TASK_RUNNING;
-    rq_task_add(&run_queue, task, first);
+
+    // each wakeup releases a new edf job, periodic jobs at their release
+    if (task->flags & TASK_SCHED_EDF) {
+        task->abs_deadline = (task->period ? task->release : jiffies) +
+            task->deadline;
+    }
+
+    rq_task_add(rq, task, first);
+    task_kick_cpu(rq, task);
+    rq_unlock(rq);
+
+    task_unlock();
+}
+
+void task_set_deadline(task_t *task, int32_t deadline)
+{
+    run_queue_t *rq;
+    bool_t queued;
+
+    BUG_ON(deadline <= 0);
+
+    task_lock();
+
+    rq = task_rq_lock(task);
+    queued = (TASK_RUNNING == task->state) ? TRUE : FALSE;
+    if (queued)
+        rq_task_delete(rq, task);
+
+    task->flags &= ~TICK_SCHED_ENABLED;
+    task->flags |= TASK_SCHED_EDF;
+    task->deadline = deadline;
+    task->abs_deadline = jiffies + deadline;
+    task->priority = SCHED_EDF_PRIORITY;
+    task->default_priority = SCHED_EDF_PRIORITY;
+
+    if (queued)
+        rq_task_add(rq, task, 0);
+    rq_unlock(rq);
 
     task_unlock();
 }
 
+void task_set_period(task_t *task, int32_t period)
+{
+    BUG_ON(period <= 0);
+
+    task_lock();
+    task->period = period;
+    task->release = jiffies;
+    task->overruns = 0;
+    task->deadline_misses = 0;
+    task->jitter_last = 0;
+    task->jitter_max = 0;
+    task_unlock();
+}
+
+/*
+ * Sleep until the next absolute release time, so execution time and
+ * preemption in the job never shift the following releases. A job that
+ * finished past its deadline (or its period if it has none) counts as a
+ * deadline miss; releases that already passed are skipped and counted
+ * as overruns, which are also returned.
+ */
+int32_t task_wait_next_period(void)
+{
+    task_t *task = current;
+    uint32_t now;
+    uint32_t deadline;
+    int32_t missed = 0;
+
+    BUG_ON(0 == task->period);
+
+    task_lock();
+
+    now = jiffies;
+    deadline = task->release + (task->deadline ? task->deadline : task->period);
+    if (time_after(now, deadline))
+        ++task->deadline_misses;
+
+    task->release += task->period;
+    while (time_after(now, task->release)) {
+        task->release += task->period;
+        ++missed;
+    }
+    task->overruns += missed;
+
+    if (time_before(now, task->release)) {
+        task_suspend_until(task, TRUE, task->release, NULL, NULL);
+    } else if (task->flags & TASK_SCHED_EDF) {
+        // released at once, requeue on the new deadline
+        run_queue_t *rq = task_rq_lock(task);
+        rq_task_delete(rq, task);
+        task->abs_deadline = task->release + task->deadline;
+        rq_task_add(rq, task, 0);
+        rq_unlock(rq);
+    }
+
+    task_unlock();
+
+    task->jitter_last = jiffies - task->release;
+    if (task->jitter_last > task->jitter_max)
+        task->jitter_max = task->jitter_last;
+
+    return missed;
+}
+
 /*--------------------------------------------------------------------------*/
 
+void sched_set_band(uint8_t priority, int32_t quantum, uint8_t demote_limit)
+{
+    BUG_ON(priority >= SCHED_PRIORITY_MAX_NR);
+    BUG_ON(demote_limit >= SCHED_PRIORITY_MAX_NR);
+    BUG_ON(quantum <= 0);
+
+    task_lock();
+    sched_bands[priority].quantum = quantum;
+    sched_bands[priority].demote_limit = demote_limit;
+    task_unlock();
+}
+
+void sched_set_boost(int32_t period)
+{
+    task_lock();
+    sched_boost_period = period;
+    sched_next_boost = jiffies + period;
+    task_unlock();
+}
+
 void task_time_slice_hsr(void *data)
 {
     task_t *task = (task_t *)data;
+    run_queue_t *rq;
+    uint8_t limit;
 
     BUG_ON(task != current);
 
-    if ((task->flags & TICK_SCHED_ENABLED) && (task->time_slice <= 0)) {
+    if (!(task->flags & TICK_SCHED_ENABLED) || (task->time_slice > 0))
+        return;
+
+    limit = sched_bands[task->default_priority].demote_limit;
 
-        if (task->default_priority == SCHED_PRIORITY_MAX_NR - 1) {
-            task->time_slice = TICK_SCHED_QUANTUM;
-            rq_task_move_tail(&run_queue, task);
-            return;
-        }
+    rq = task_rq_lock(task);
+    if ((task->priority >= MAX(limit, task->default_priority)) ||
+        (task->flags & TASK_THROTTLED)) {
+        task->time_slice = sched_quantum(task->priority);
+        rq_task_move_tail(rq, task);
+    } else {
+        rq_task_delete(rq, task);
+        task_set_priority(task, task->priority + 1);
+        rq_task_add(rq, task, 0);
+    }
+    rq_unlock(rq);
+}
 
-        rq_task_delete(&run_queue, task);
-        ++task->priority;
-        if (task->priority >= (SCHED_PRIORITY_MAX_NR - 1)) {
-            task->priority = task->default_priority;
-            task->time_slice = TICK_SCHED_QUANTUM;
+/* aging, lift every demoted task back to its default priority */
+void task_boost_hsr(void *data)
+{
+    task_t *task, *nxt;
+    run_queue_t *rq;
+    LIST_HEAD(boosted);
+
+    sched_next_boost = jiffies + sched_boost_period;
+
+    spin_lock(&demote_lock);
+    LIST_FOR_EACH_ENTRY_SAFE(task, nxt, &demoted_tasks, demote_node) {
+        // stays in the background until its reservation is refilled
+        if (task->flags & TASK_THROTTLED)
+            continue;
+        LIST_DEL(&task->demote_node);
+        LIST_ADD_TAIL(&boosted, &task->demote_node);
+    }
+    spin_unlock(&demote_lock);
+
+    LIST_FOR_EACH_ENTRY_SAFE(task, nxt, &boosted, demote_node) {
+        rq = task_rq_lock(task);
+        if (TASK_RUNNING == task->state) {
+            rq_task_delete(rq, task);
+            task_set_priority(task, task->default_priority);
+            rq_task_add(rq, task, 0);
         } else {
-            task->time_slice = TICK_SCHED_QUANTUM +
-            (task->priority - task->default_priority) * TICK_SCHED_QUANTUM / 2;
+            task_set_priority(task, task->default_priority);
         }
-        rq_task_add(&run_queue, task, 0);
+        rq_unlock(rq);
     }
 }
 
 static DECLARE_HSR(time_slice_hsr, 0, task_time_slice_hsr, "time_slice_hsr");
+static DECLARE_HSR(boost_hsr, 0, task_boost_hsr, "boost_hsr");
 
 void task_time_slice(void)
 {
+    reserve_t *res = current->reserve;
+
     if (current->flags & TICK_SCHED_ENABLED) {
         if (--current->time_slice <= 0)
             activiate_hsr(&time_slice_hsr, current);
     }
+
+    if ((NULL != res) && !(current->flags & TASK_THROTTLED)) {
+        if (--res->remaining <= 0)
+            activiate_hsr(&res->throttle_hsr, res);
+    }
+
+    if ((sched_boost_period > 0) && time_after_eq(jiffies, sched_next_boost))
+        activiate_hsr(&boost_hsr, NULL);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void task_throttle(task_t *task, bool_t throttle)
+{
+    reserve_t *res = task->reserve;
+    run_queue_t *rq = task_rq_lock(task);
+    bool_t queued = (TASK_RUNNING == task->state) ? TRUE : FALSE;
+
+    if (queued)
+        rq_task_delete(rq, task);
+
+    // through task_set_priority(), so demotion and aging keep track of it
+    if (throttle) {
+        task->flags |= TASK_THROTTLED;
+        if (!(res->flags & RESERVE_HARD))
+            task_set_priority(task, SCHED_BACKGROUND_PRIORITY);
+    } else {
+        task->flags &= ~TASK_THROTTLED;
+        task_set_priority(task, task->default_priority);
+    }
+
+    if (queued)
+        rq_task_add(rq, task, 0);
+    rq_unlock(rq);
+}
+
+void reserve_throttle_hsr(void *data)
+{
+    reserve_t *res = (reserve_t *)data;
+    task_t *task;
+
+    spin_lock(&res->lock);
+    if ((res->remaining <= 0) && !(res->flags & RESERVE_THROTTLED)) {
+        res->flags |= RESERVE_THROTTLED;
+        ++res->throttles;
+
+        LIST_FOR_EACH_ENTRY(task, &res->tasks, reserve_node)
+            task_throttle(task, TRUE);
+    }
+    spin_unlock(&res->lock);
+}
+
+static void reserve_replenish(void *data)
+{
+    reserve_t *res = (reserve_t *)data;
+    task_t *task;
+
+    spin_lock(&res->lock);
+    res->remaining = res->budget;
+
+    if (res->flags & RESERVE_THROTTLED) {
+        res->flags &= ~RESERVE_THROTTLED;
+        LIST_FOR_EACH_ENTRY(task, &res->tasks, reserve_node)
+            task_throttle(task, FALSE);
+    }
+    spin_unlock(&res->lock);
+
+    res->expires += res->period;
+    timer_start_at(&res->timer, res->expires, reserve_replenish, res);
+}
+
+void reserve_init(reserve_t *res, int32_t budget, int32_t period,
+    uint8_t flags)
+{
+    BUG_ON((budget <= 0) || (budget > period));
+
+    INIT_SPINLOCK(&res->lock);
+    INIT_LIST_HEAD(&res->tasks);
+    res->budget = budget;
+    res->period = period;
+    res->remaining = budget;
+    res->flags = flags & RESERVE_HARD;
+    res->throttles = 0;
+    INIT_TIMER(&res->timer);
+    INIT_HSR(&res->throttle_hsr, 0, reserve_throttle_hsr, "reserve_hsr");
+
+    task_lock();
+    res->expires = jiffies + period;
+    timer_start_at(&res->timer, res->expires, reserve_replenish, res);
+    task_unlock();
+}
+
+void reserve_attach(reserve_t *res, task_t *task)
+{
+    BUG_ON(NULL != task->reserve);
+
+    task_lock();
+    spin_lock(&res->lock);
+    task->reserve = res;
+    LIST_ADD_TAIL(&res->tasks, &task->reserve_node);
+    if (res->flags & RESERVE_THROTTLED)
+        task_throttle(task, TRUE);
+    spin_unlock(&res->lock);
+    task_unlock();
+}
+
+void reserve_detach(task_t *task)
+{
+    reserve_t *res = task->reserve;
+
+    if (NULL == res)
+        return;
+
+    task_lock();
+    spin_lock(&res->lock);
+    if (task->flags & TASK_THROTTLED)
+        task_throttle(task, FALSE);
+    LIST_DEL(&task->reserve_node);
+    task->reserve = NULL;
+    spin_unlock(&res->lock);
+    task_unlock();
 }
 
 /*--------------------------------------------------------------------------*/
 
 void task_yield(void)
 {
+    run_queue_t *rq;
+
     task_lock();
 
     if (current->flags & TICK_SCHED_ENABLED)
-        current->time_slice = TICK_SCHED_QUANTUM;
+        current->time_slice = sched_quantum(current->priority);
 
-    rq_task_move_tail(&run_queue, current);
+    rq = task_rq_lock(current);
+    rq_task_move_tail(rq, current);
+    rq_unlock(rq);
 
     task_unlock();
 }
@@ -311,14 +871,25 @@ void task_sleep(int32_t ticks)
 
 void task_exit(void)
 {
+    run_queue_t *rq;
+    task_t *from = current;
+
     HAL_DISABLE_INTERRUPTS();
-    rq_task_delete(&run_queue, current);
-    current->state = TASK_ZOMBIE;
-    BUG_ON(TIMER_ACTIVE(&current->timer));
-    BUG_ON(current->flags & TASK_TIMER_ACTIVE);
-    BUG_ON(current->cleanup != NULL);
+    rq = task_rq_lock(from);
+    rq_task_delete(rq, from);
+    from->state = TASK_ZOMBIE;
+    spin_lock(&demote_lock);
+    if (LIST_INLIST(&from->demote_node))
+        LIST_DEL(&from->demote_node);
+    spin_unlock(&demote_lock);
+    BUG_ON(TIMER_ACTIVE(&from->timer));
+    BUG_ON(from->flags & TASK_TIMER_ACTIVE);
+    BUG_ON(from->cleanup != NULL);
     ++task_switches;
-    current = rq_pick_task();
+    ++rq->switches;
+    current = rq_pick(rq);
+    task_switch_prepare(from, current);
+    rq_unlock(rq);
     HAL_LOAD_TASK_CONTEXT(&current->stack);
     HAL_ENABLE_INTERRUPTS();
 
@@ -336,65 +907,211 @@ void task_restart(task_t *task)
     task->state = TASK_SUSPEND;
 
     if (task->flags & TICK_SCHED_ENABLED)
-        task->time_slice = TICK_SCHED_QUANTUM;
+        task->time_slice = sched_quantum(task->priority);
 
-    HAL_TASK_BUILD_STACK(&task->stack);
+    HAL_TASK_BUILD_STACK(&task->stack, task->stack_base);
 
     task_resume(task, 0);
 }
 
 /*--------------------------------------------------------------------------*/
 
-static TASK_STRUCT(idle_task, IDLE_TASK_STACK_SIZE);
+#if (CPU_NR > 1)
+
+/* ready tasks another cpu may take: not running, not pinned, not edf */
+static task_t *rq_find_stealable(run_queue_t *rq)
+{
+    task_t *task;
+
+    for (int i = rq->highest_priority; i < SCHED_PRIORITY_MAX_NR; i++) {
+        LIST_FOR_EACH_ENTRY(task, rq->queue_array + i, ready_node) {
+            if (!task->on_cpu && !(task->flags & TASK_CPU_BOUND))
+                return task;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Pull the most urgent waiting task from the busiest cpu. Both queues
+ * are locked in cpu order so two idle cpus stealing from each other
+ * cannot deadlock.
+ */
+static bool_t sched_steal_task(void)
+{
+    run_queue_t *rq = this_rq();
+    run_queue_t *src = NULL;
+    run_queue_t *first, *second;
+    uint32_t busiest = 1;
+    task_t *task;
+
+    for (int cpu = 0; cpu < CPU_NR; cpu++) {
+        if ((cpu_rq(cpu) != rq) && (cpu_rq(cpu)->nr_ready > busiest)) {
+            busiest = cpu_rq(cpu)->nr_ready;
+            src = cpu_rq(cpu);
+        }
+    }
+
+    if (NULL == src)
+        return FALSE;
+
+    first = (src < rq) ? src : rq;
+    second = (src < rq) ? rq : src;
+    spin_lock(&first->lock);
+    spin_lock(&second->lock);
+
+    task = rq_find_stealable(src);
+    if (NULL != task) {
+        rq_task_delete(src, task);
+        task->cpu = cpu_id();
+        rq_task_add(rq, task, 0);
+        ++rq->steals;
+    }
+
+    spin_unlock(&second->lock);
+    spin_unlock(&first->lock);
+
+    return (NULL != task) ? TRUE : FALSE;
+}
+
+#endif
+
+static task_t idle_tasks[CPU_NR];
+static uint32_t idle_stacks[CPU_NR][IDLE_TASK_STACK_SIZE / sizeof(uint32_t)]
+    NOINIT_SECTION;
 
 static void idle_task_entry(void *para)
 {
-    while (1);
+    while (1) {
+#if (CPU_NR > 1)
+        task_lock();
+        if (!sched_steal_task())
+            HAL_CPU_IDLE();
+        task_unlock();
+#elif defined(HAL_CPU_IDLE)
+        task_lock();
+        HAL_CPU_IDLE();
+        task_unlock();
+#endif
+    }
 }
 
 static inline void init_idle_task(void)
 {
-    task_struct_create(&idle_task, "idle_task", SCHED_PRIORITY_MAX_NR - 1, 0,
-        idle_task_entry, NULL);
+    task_t *task;
+
+    for (int cpu = 0; cpu < CPU_NR; cpu++) {
+        task = idle_tasks + cpu;
+        task_init(task, "idle_task", SCHED_PRIORITY_MAX_NR - 1, 0,
+            (address_t)idle_stacks[cpu], IDLE_TASK_STACK_SIZE,
+            idle_task_entry, NULL);
+        task->cpu = cpu;
+        task->flags |= TASK_CPU_BOUND;
+        task_resume(task, 0);
+    }
+}
+
+void sched_get_stats(int cpu, uint32_t *switches, uint32_t *steals)
+{
+    *switches = cpu_rq(cpu)->switches;
+    *steals = cpu_rq(cpu)->steals;
 }
 
 /*--------------------------------------------------------------------------*/
 
+/* weak, a hosted build has no table until some task is declared */
+extern task_t __task_tbl_start[] __attribute__((weak));
+extern task_t __task_tbl_end[] __attribute__((weak));
+
+static void init_task_tbl(void)
+{
+    run_queue_t *rq = this_rq();
+    task_t *task;
+
+    spin_lock(&rq->lock);
+
+    for (task = __task_tbl_start; task < __task_tbl_end; task++) {
+        BUG_ON(task->priority >= SCHED_PRIORITY_MAX_NR);
+        BUG_ON(TASK_SUSPEND != task->state);
+
+        if (task->flags & TICK_SCHED_ENABLED)
+            task->time_slice = sched_quantum(task->priority);
+
+        HAL_TASK_BUILD_STACK(&task->stack, task->stack_base);
+
+        task->state = TASK_RUNNING;
+        rq_task_add(rq, task, 0);
+    }
+
+    spin_unlock(&rq->lock);
+}
+
 void init_sched(void)
 {
-    for (int i = 0; i < SCHED_PRIORITY_MAX_NR; i++)
-        INIT_LIST_HEAD(run_queue.queue_array + i);
-    run_queue.highest_priority = SCHED_PRIORITY_MAX_NR - 1;
+    run_queue_t *rq;
+
+    for (int i = 0; i < SCHED_PRIORITY_MAX_NR; i++) {
+        // demotion stops above idle unless a band says otherwise
+        sched_bands[i].quantum = TICK_SCHED_QUANTUM;
+        sched_bands[i].demote_limit = SCHED_PRIORITY_MAX_NR - 2;
+    }
+
+    for (int cpu = 0; cpu < CPU_NR; cpu++) {
+        rq = cpu_rq(cpu);
+        INIT_SPINLOCK(&rq->lock);
+        for (int i = 0; i < SCHED_PRIORITY_MAX_NR; i++)
+            INIT_LIST_HEAD(rq->queue_array + i);
+        rq->highest_priority = SCHED_PRIORITY_MAX_NR - 1;
+    }
+
+    sched_next_boost = jiffies + sched_boost_period;
     init_idle_task();
+    init_task_tbl();
 }
 
+/* every cpu enters here once, cpu 0 after os_start() set everything up */
 void start_sched(void)
 {
+#if (CPU_NR > 1)
+    if (0 == cpu_id())
+        HAL_CPU_START_SECONDARY();
+#endif
     sched_lock = 0;
     current = rq_pick_task();
     BUG_ON(NULL == current);
+    if (0 == cpu_id())
+        boot_time_mark("start_sched");
+    task_switch_prepare(NULL, current);
     HAL_LOAD_TASK_CONTEXT(&current->stack);
     BUG_ON(1); /* never go here */
 }
 
 void task_entry_wrapper(void)
 {
+    task_switch_finish();
     current->entry(current->para);
     task_exit();
 }
 
 /*--------------------------------------------------------------------------*/
 
+/*
+ * Only what the first tasks need is set up here: hsr_pending starts out
+ * cleared with .bss, the system workqueue and the declared tasks are
+ * initialised at compile time, and device bring-up runs as initcalls in
+ * the init task once scheduling has started.
+ */
 void os_start(void)
 {
-    extern void init_hsr(void);
     extern void app_start(void);
+    boot_time_mark("head");
     init_sched();
-    init_hsr();
+    boot_time_mark("init_sched");
     //init_mem();
-    //init_dev();
     //init_fs();
     app_start();
+    boot_time_mark("app_start");
     start_sched();
 }
 
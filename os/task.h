@@ -9,12 +9,31 @@
 #define _MINIOS_TASK_H_
 
 #include "os/timer.h"
+#include "os/hsr.h"
+#include "os/spinlock.h"
 
 #define SCHED_PRIORITY_MAX_NR 32
 #define TICK_SCHED_QUANTUM    10
 
+/* ticks between two priority boosts of demoted tasks, 0 disables aging */
+#ifndef SCHED_BOOST_PERIOD
+#define SCHED_BOOST_PERIOD    100
+#endif
+
+/* run_queue band that edf tasks are queued at, ahead of fixed ones */
+#ifndef SCHED_EDF_PRIORITY
+#define SCHED_EDF_PRIORITY    0
+#endif
+#define SCHED_EDF_MAX_NR      32
+
+/* where soft-throttled tasks wait for their budget, just above idle */
+#define SCHED_BACKGROUND_PRIORITY (SCHED_PRIORITY_MAX_NR - 2)
+
 #define TICK_SCHED_ENABLED  (1 << 0)
 #define TASK_TIMER_ACTIVE   (1 << 1)
+#define TASK_SCHED_EDF      (1 << 2)
+#define TASK_THROTTLED      (1 << 3)
+#define TASK_CPU_BOUND      (1 << 4)
 
 #define TASK_RUNNING  1
 #define TASK_SUSPEND  2
@@ -35,7 +54,29 @@ typedef struct {
 
     list_head_t ready_node;
 
+    /* cpu whose run_queue the task is on, set while it is running */
+    uint32_t cpu;
+    volatile uint32_t on_cpu;
+
     int32_t time_slice;
+    list_head_t demote_node;
+
+    /* edf: relative deadline, absolute deadline of the current job */
+    uint32_t deadline;
+    uint32_t abs_deadline;
+    uint32_t edf_index;
+
+    /* periodic: period, release time of the current job and statistics */
+    uint32_t period;
+    uint32_t release;
+    uint32_t overruns;
+    uint32_t deadline_misses;
+    uint32_t jitter_last;
+    uint32_t jitter_max;
+
+    /* cpu budget reservation the task is charged to */
+    struct reserve *reserve;
+    list_head_t reserve_node;
 
     timer_t timer;
 
@@ -50,42 +91,142 @@ typedef struct {
 
 /*--------------------------------------------------------------------------*/
 
+#define RESERVE_HARD      (1 << 0)
+#define RESERVE_THROTTLED (1 << 1)
+
+/*
+ * A cpu budget shared by its tasks and refilled every period. Once the
+ * budget is used up the tasks are moved to SCHED_BACKGROUND_PRIORITY,
+ * so they still soak up idle time, or with RESERVE_HARD are taken off
+ * run_queue altogether until the next refill.
+ */
+typedef struct reserve {
+    spinlock_t lock;
+    list_head_t tasks;
+    int32_t budget;
+    int32_t period;
+    volatile int32_t remaining;
+    uint8_t flags;
+    uint32_t throttles;
+    uint32_t expires;
+    timer_t timer;
+    hsr_t throttle_hsr;
+} reserve_t;
+
+void reserve_init(reserve_t *res, int32_t budget, int32_t period,
+    uint8_t flags);
+void reserve_attach(reserve_t *res, task_t *task);
+void reserve_detach(task_t *task);
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Round-robin policy of a priority band for TICK_SCHED_ENABLED tasks:
+ * the slice a task gets at that priority, and how far a task whose
+ * default priority is this band may be demoted when it uses up slices.
+ */
+typedef struct {
+    int32_t quantum;
+    uint8_t demote_limit;
+} sched_band_t;
+
+void sched_set_band(uint8_t priority, int32_t quantum, uint8_t demote_limit);
+void sched_set_boost(int32_t period);
+
+/*--------------------------------------------------------------------------*/
+
+#if (CPU_NR > 1)
+extern task_t *cpu_current[CPU_NR];
+extern int32_t cpu_sched_lock[CPU_NR];
+int cpu_id(void);
+#define current    (cpu_current[cpu_id()])
+#define sched_lock (cpu_sched_lock[cpu_id()])
+#else
+extern task_t *current;
+extern int32_t sched_lock;
+#define cpu_id()   0
+#endif
+
+/*
+ * Holds off preemption and hsrs on this cpu, not on the others: with
+ * CPU_NR > 1 it excludes nothing the other cpus do. A task going to
+ * sleep until an hsr wakes it checks its condition, publishes itself
+ * and calls task_suspend() all under the spinlock that hsr takes; the
+ * switch away happens at task_unlock().
+ */
 void task_lock(void);
 void task_unlock(void);
 void task_create(task_t *task, char *name, uint8_t priority, uint8_t options,
     address_t stack_base, uint32_t stack_size, task_entry_t entry, void *para);
 void task_suspend(task_t *task, int32_t timeout, cleanup_t cleanup, void *info);
 void task_resume(task_t *task, int first);
+void task_set_deadline(task_t *task, int32_t deadline);
+void task_set_period(task_t *task, int32_t period);
+int32_t task_wait_next_period(void);
 
 /*--------------------------------------------------------------------------*/
 
+#ifndef TASK_DEFAULT_STACK_SIZE
 #define TASK_DEFAULT_STACK_SIZE 8192
+#endif
+#ifndef IDLE_TASK_STACK_SIZE
 #define IDLE_TASK_STACK_SIZE 4096
+#endif
 
 typedef struct {
     task_t task;
     uint32_t magic;
-    uint8_t stack[0];
 } task_struct_t;
 
 #define TASK_STRUCT_MAIGC 0xbeefbeef
 
-#define TASK_STRUCT(name, _stack_size)    \
-struct {                                  \
-    task_struct_t _task;                  \
-    uint8_t _stack[_stack_size];          \
-} name =                                  \
-{                                         \
-    {.task = {.stack_size = _stack_size}, \
-     .magic = TASK_STRUCT_MAIGC,},        \
-};
+/* both the task and its stack are static, the stack is in .noinit */
+#define TASK_STRUCT(name, _stack_size)                                    \
+static uint32_t name##_stack[(_stack_size) / sizeof(uint32_t)]            \
+    NOINIT_SECTION;                                                       \
+static task_struct_t name = {                                             \
+    .task = {.stack_base = (address_t)name##_stack,                       \
+             .stack_size = (_stack_size)},                                \
+    .magic = TASK_STRUCT_MAIGC,                                           \
+}
+
+/*
+ * Statically declared tasks: the control block is fully initialised at
+ * compile time and placed in the task table section, the stack goes to
+ * .noinit. init_sched() links the whole table into run_queue in one pass,
+ * they are ready before start_sched() without calling task_create().
+ */
+#ifndef TASK_TBL_SECTION
+#define TASK_TBL_SECTION ".task_tbl"
+#endif
+
+#define DECLARE_TASK(_name, _priority, _options, _stack_size, _entry, _para) \
+static uint32_t _name##_stack[(_stack_size) / sizeof(uint32_t)]            \
+    NOINIT_SECTION;                                                         \
+task_t _name __attribute__((used, section(TASK_TBL_SECTION),               \
+    aligned(__alignof__(task_t)))) = {                                      \
+    .stack = (address_t)_name##_stack + (_stack_size),                      \
+    .stack_base = (address_t)_name##_stack,                                 \
+    .stack_size = (_stack_size),                                            \
+    .state = TASK_SUSPEND,                                                  \
+    .flags = (_options) & TICK_SCHED_ENABLED,                               \
+    .priority = (_priority),                                                \
+    .default_priority = (_priority),                                        \
+    .ready_node = LIST_HEAD_INIT(_name.ready_node),                         \
+    .demote_node = LIST_HEAD_INIT(_name.demote_node),                       \
+    .reserve_node = LIST_HEAD_INIT(_name.reserve_node),                     \
+    .timer = TIMER_INIT(_name.timer),                                       \
+    .entry = (_entry),                                                      \
+    .para = (_para),                                                        \
+    .name = #_name,                                                         \
+}
 
 static inline void task_struct_create(void *t, char *name,
     uint8_t priority, uint8_t options, task_entry_t entry, void *para)
 {
     task_struct_t *task = (task_struct_t *)t;
     BUG_ON(TASK_STRUCT_MAIGC != task->magic);
-    task_create(&task->task, name, priority, options, (address_t)task->stack,
+    task_create(&task->task, name, priority, options, task->task.stack_base,
         task->task.stack_size, entry, para);
 }
 
@@ -104,6 +245,20 @@ static inline void task_struct_resume(void *t, int first)
     task_resume(&task->task, first);
 }
 
+static inline void task_struct_set_deadline(void *t, int32_t deadline)
+{
+    task_struct_t *task = (task_struct_t *)t;
+    BUG_ON(TASK_STRUCT_MAIGC != task->magic);
+    task_set_deadline(&task->task, deadline);
+}
+
+static inline void task_struct_set_period(void *t, int32_t period)
+{
+    task_struct_t *task = (task_struct_t *)t;
+    BUG_ON(TASK_STRUCT_MAIGC != task->magic);
+    task_set_period(&task->task, period);
+}
+
 /*--------------------------------------------------------------------------*/
 
 void task_yield(void);
@@ -111,6 +266,9 @@ void task_sleep(int32_t ticks);
 void task_exit(void);
 void task_restart(task_t *task);
 
+/* context switches and tasks pulled by the idle task of one cpu */
+void sched_get_stats(int cpu, uint32_t *switches, uint32_t *steals);
+
 /*--------------------------------------------------------------------------*/
 
 #endif // _MINIOS_TASK_H_
@@ -7,6 +7,7 @@
 
 #include "os/timer.h"
 #include "os/hsr.h"
+#include "os/spinlock.h"
 
 extern void task_lock(void);
 extern void task_unlock(void);
@@ -14,19 +15,40 @@ extern void task_unlock(void);
 volatile uint32_t jiffies = 0xffffd000;
 list_head_t timer_list = LIST_HEAD_INIT(timer_list);
 bool_t timer_enabled = FALSE;
+/* taken by the tick isr as well, always with irq masked */
+static spinlock_t timer_lock = SPINLOCK_INIT;
+
+/* unlink the first expired timer, its proc runs without timer_lock */
+static timer_t *timer_pop_expired(void)
+{
+    list_head_t *node;
+    timer_t *t = NULL;
+    cpu_flags_t flags;
+
+    flags = spin_lock_irqsave(&timer_lock);
+
+    node = LIST_FIRST(&timer_list);
+    if (node) {
+        t = LIST_ENTRY(node, timer_t, node);
+        if (time_before(jiffies, t->expires))
+            t = NULL;
+        else
+            LIST_DEL(&t->node);
+    }
+
+    spin_unlock_irqrestore(&timer_lock, flags);
+
+    return t;
+}
 
 void timer_hsr_function(void *para)
 {
-    timer_t *t, *nxt;
+    timer_t *t;
 
     timer_enabled = FALSE;
 
-    LIST_FOR_EACH_ENTRY_SAFE(t, nxt, &timer_list, node) {
-        if (time_before(jiffies, t->expires))
-            break;
-        LIST_DEL(&t->node);
+    while (NULL != (t = timer_pop_expired()))
         t->proc(t->data);
-    }
 
     if (!LIST_EMPTY(&timer_list))
         timer_enabled = TRUE;
@@ -36,15 +58,23 @@ static DECLARE_HSR(timer_hsr, 0, timer_hsr_function, "timer_hsr");
 
 void timer_start(timer_t *timer, int32_t ticks, timeout_t proc, void *data)
 {
+    timer_start_at(timer, jiffies + ticks, proc, data);
+}
+
+void timer_start_at(timer_t *timer, uint32_t expires, timeout_t proc,
+    void *data)
+{
+    cpu_flags_t flags;
     timer_t *t;
 
     BUG_ON(TIMER_ACTIVE(timer));
 
     timer->proc = proc;
     timer->data = data;
-    timer->expires = jiffies + ticks;
+    timer->expires = expires;
 
     task_lock();
+    flags = spin_lock_irqsave(&timer_lock);
 
     timer_enabled = FALSE;
 
@@ -56,12 +86,16 @@ void timer_start(timer_t *timer, int32_t ticks, timeout_t proc, void *data)
 
     timer_enabled = TRUE;
 
+    spin_unlock_irqrestore(&timer_lock, flags);
     task_unlock();
 }
 
 void timer_stop(timer_t *timer)
 {
+    cpu_flags_t flags;
+
     task_lock();
+    flags = spin_lock_irqsave(&timer_lock);
 
     timer_enabled = FALSE;
 
@@ -71,6 +105,7 @@ void timer_stop(timer_t *timer)
     if (!LIST_EMPTY(&timer_list))
         timer_enabled = TRUE;
 
+    spin_unlock_irqrestore(&timer_lock, flags);
     task_unlock();
 }
 
@@ -81,14 +116,18 @@ void tick_increase(void)
     ++jiffies;
 
     if (TRUE == timer_enabled) {
-        list_head_t *node = LIST_FIRST(&timer_list);
+        list_head_t *node;
+        cpu_flags_t flags;
         timer_t *timer;
 
+        flags = spin_lock_irqsave(&timer_lock);
+        node = LIST_FIRST(&timer_list);
         if (node) {
             timer = LIST_ENTRY(node, timer_t, node);
             if (time_after_eq(jiffies, timer->expires))
                 activiate_hsr(&timer_hsr, NULL);
         }
+        spin_unlock_irqrestore(&timer_lock, flags);
     }
 
     task_time_slice();
@@ -30,6 +30,8 @@ typedef struct {
 #define TIMER_ACTIVE(timer) LIST_INLIST(&(timer)->node)
 
 void timer_start(timer_t *timer, int32_t ticks, timeout_t proc, void *data);
+void timer_start_at(timer_t *timer, uint32_t expires, timeout_t proc,
+    void *data);
 void timer_stop(timer_t *timer);
 void tick_increase(void);
 
@@ -0,0 +1,172 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "os/workqueue.h"
+#include "port/port.h"
+
+static void workqueue_wakeup(void *data)
+{
+    workqueue_t *wq = (workqueue_t *)data;
+    task_resume(wq->worker, 0);
+}
+
+static void __queue_work(workqueue_t *wq, work_t *work)
+{
+    cpu_flags_t flags = spin_lock_irqsave(&wq->lock);
+
+    work->next = wq->pending;
+    wq->pending = work;
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    activiate_hsr(&wq->wakeup, wq);
+}
+
+/* wq->lock held */
+static work_t *workqueue_take(workqueue_t *wq)
+{
+    work_t *list, *fifo = NULL, *nxt;
+
+    list = wq->pending;
+    wq->pending = NULL;
+
+    // pushed lifo, run in queueing order
+    while (list) {
+        nxt = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = nxt;
+    }
+
+    return fifo;
+}
+
+static void worker_entry(void *para)
+{
+    workqueue_t *wq = (workqueue_t *)para;
+    cpu_flags_t flags;
+    work_t *list, *work;
+    uint32_t done;
+
+    while (1) {
+        // check and sleep under the lock work is queued with, the wakeup
+        // hsr comes after it and so finds the worker suspended
+        task_lock();
+        flags = spin_lock_irqsave(&wq->lock);
+        list = workqueue_take(wq);
+        if (NULL == list)
+            task_suspend(wq->worker, 0, NULL, NULL);
+        spin_unlock_irqrestore(&wq->lock, flags);
+        task_unlock();
+
+        done = 0;
+        while (list) {
+            work = list;
+            list = work->next;
+
+            // once 'pending' is cleared the item may be queued again
+            work->pending = 0;
+            work->func(work->data);
+
+            if ((++done >= wq->batch) && (NULL != list)) {
+                done = 0;
+                task_yield();
+            }
+        }
+    }
+}
+
+/* set up at compile time, nothing to do for it at boot */
+static workqueue_t system_wq;
+
+DECLARE_TASK(system_wq_task, WORKQUEUE_SYSTEM_PRIORITY, 0,
+    TASK_DEFAULT_STACK_SIZE, worker_entry, &system_wq);
+
+static workqueue_t system_wq = {
+    .lock = SPINLOCK_INIT,
+    .pending = NULL,
+    .worker = &system_wq_task,
+    .wakeup = HSR_INIT(0, workqueue_wakeup, "workqueue_hsr"),
+    .batch = WORKQUEUE_DEFAULT_BATCH,
+    .name = "system_wq",
+};
+
+void workqueue_create(workqueue_t *wq, char *name, uint8_t priority,
+    uint32_t batch, void *task)
+{
+    BUG_ON(0 == batch);
+
+    INIT_SPINLOCK(&wq->lock);
+    wq->pending = NULL;
+    wq->worker = &((task_struct_t *)task)->task;
+    INIT_HSR(&wq->wakeup, 0, workqueue_wakeup, "workqueue_hsr");
+    wq->batch = batch;
+    wq->name = name;
+
+    task_struct_create(task, name, priority, 0, worker_entry, wq);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* isr, hsr or task context, FALSE if the item is still pending */
+bool_t queue_work(workqueue_t *wq, work_t *work)
+{
+    if (0 != HAL_ATOMIC_SWAP(&work->pending, 1))
+        return FALSE;
+
+    __queue_work(wq, work);
+    return TRUE;
+}
+
+static void delayed_work_timeout(void *data)
+{
+    delayed_work_t *dwork = (delayed_work_t *)data;
+    __queue_work(dwork->wq, &dwork->work);
+}
+
+/* hsr or task context, the delay counts from the first queueing */
+bool_t queue_delayed_work(workqueue_t *wq, delayed_work_t *dwork,
+    int32_t ticks)
+{
+    if (ticks <= 0)
+        return queue_work(wq, &dwork->work);
+
+    if (0 != HAL_ATOMIC_SWAP(&dwork->work.pending, 1))
+        return FALSE;
+
+    dwork->wq = wq;
+    timer_start(&dwork->timer, ticks, delayed_work_timeout, dwork);
+    return TRUE;
+}
+
+/* TRUE if the item was still waiting for its timer and never runs now */
+bool_t cancel_delayed_work(delayed_work_t *dwork)
+{
+    bool_t cancelled = FALSE;
+
+    task_lock();
+    if (TIMER_ACTIVE(&dwork->timer)) {
+        timer_stop(&dwork->timer);
+        dwork->work.pending = 0;
+        cancelled = TRUE;
+    }
+    task_unlock();
+
+    return cancelled;
+}
+
+bool_t schedule_work(work_t *work)
+{
+    return queue_work(&system_wq, work);
+}
+
+bool_t schedule_delayed_work(delayed_work_t *dwork, int32_t ticks)
+{
+    return queue_delayed_work(&system_wq, dwork, ticks);
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF workqueue.c
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_WORKQUEUE_H_
+#define _MINIOS_WORKQUEUE_H_
+
+#include "os/task.h"
+
+/* priority and batch size of the system workqueue used by schedule_work() */
+#ifndef WORKQUEUE_SYSTEM_PRIORITY
+#define WORKQUEUE_SYSTEM_PRIORITY 16
+#endif
+#ifndef WORKQUEUE_DEFAULT_BATCH
+#define WORKQUEUE_DEFAULT_BATCH   8
+#endif
+
+typedef void (*work_func_t)(void *);
+
+/*
+ * A work item runs in task context on a worker, so it may block. It is
+ * 'pending' from queue_work() until the worker picks it up; queueing it
+ * again meanwhile is a no-op and it runs once.
+ */
+typedef struct work {
+    struct work *next;
+    work_func_t func;
+    void *data;
+    volatile uint32_t pending;
+} work_t;
+
+#define WORK_INIT(func, data) {NULL, func, data, 0}
+#define DECLARE_WORK(name, func, data) work_t name = WORK_INIT(func, data)
+
+#define INIT_WORK(work, _func, _data) do { \
+    (work)->next = NULL;                   \
+    (work)->func = (_func);                \
+    (work)->data = (_data);                \
+    (work)->pending = 0;                   \
+} while (0)
+
+/* work queued once its timer fires, pending for the whole delay */
+typedef struct {
+    work_t work;
+    timer_t timer;
+    struct workqueue *wq;
+} delayed_work_t;
+
+#define DECLARE_DELAYED_WORK(name, func, data) \
+    delayed_work_t name = {WORK_INIT(func, data), TIMER_INIT(name.timer), NULL}
+
+#define INIT_DELAYED_WORK(dwork, _func, _data) do { \
+    INIT_WORK(&(dwork)->work, _func, _data);         \
+    INIT_TIMER(&(dwork)->timer);                     \
+    (dwork)->wq = NULL;                              \
+} while (0)
+
+/*
+ * One worker task per queue. Items are pushed with interrupts masked so
+ * isrs may queue too; the worker takes the whole list at once and runs
+ * up to 'batch' items before it yields to tasks of its priority.
+ */
+typedef struct workqueue {
+    spinlock_t lock;
+    work_t *pending;
+    task_t *worker;
+    hsr_t wakeup;
+    uint32_t batch;
+    char *name;
+} workqueue_t;
+
+void workqueue_create(workqueue_t *wq, char *name, uint8_t priority,
+    uint32_t batch, void *task);
+
+bool_t queue_work(workqueue_t *wq, work_t *work);
+bool_t queue_delayed_work(workqueue_t *wq, delayed_work_t *dwork,
+    int32_t ticks);
+bool_t cancel_delayed_work(delayed_work_t *dwork);
+
+/* on the system workqueue */
+bool_t schedule_work(work_t *work);
+bool_t schedule_delayed_work(delayed_work_t *dwork, int32_t ticks);
+
+#endif // _MINIOS_WORKQUEUE_H_
+// EOF workqueue.h
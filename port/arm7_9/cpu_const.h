@@ -10,6 +10,7 @@
 
 #define ARM_MODE_SVC    0x13
 #define ARM_MODE_IRQ    0x12
+#define ARM_MODE_FIQ    0x11
 #define ARM_IRQ_BIT     (1 << 7)
 #define ARM_FIQ_BIT     (1 << 6)
 
@@ -17,7 +18,20 @@
 #define S_PSR           60
 #define S_PC            56
 
-#define ARM_IRQ_STACK_SIZE  8192
+/* irq handlers run on the svc stack, the irq stack only holds a frame
+   per nesting level */
+#define ARM_IRQ_STACK_SIZE  1024
+#define ARM_FIQ_STACK_SIZE  512
+#define ARM_BOOT_STACK_SIZE 2048
+
+/*
+ * The 4K on-chip sram (steppingstone) is at 0 booting from nand and at
+ * 0x40000000 booting from nor. compile.sh sets it from the boot mode
+ * for the c and asm files and for the linker script alike.
+ */
+#ifndef SRAM_BASE
+#define SRAM_BASE       0x00000000
+#endif
 
 #endif // _MINIOS_ARM7_9_CONST_H_
 // EOF cpu_const.h
@@ -0,0 +1,36 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#include "port/arm7_9/mmu.h"
+
+/* runs before .bss is cleared, it must not touch globals */
+void mmu_build_table(uint32_t *table, const mmu_region_t *regions,
+    uint32_t nr)
+{
+    uint32_t i, n, idx;
+    const mmu_region_t *r;
+
+    for (i = 0; i < MMU_TABLE_ENTRIES; i++)
+        table[i] = MMU_DESC_FAULT;
+
+    for (r = regions; r < regions + nr; r++) {
+        BUG_ON((r->va | r->pa | r->size) & (MMU_SECTION_SIZE - 1));
+
+        idx = r->va >> MMU_SECTION_SHIFT;
+        n = r->size >> MMU_SECTION_SHIFT;
+        BUG_ON(idx + n > MMU_TABLE_ENTRIES);
+
+        // later regions override earlier ones
+        for (i = 0; i < n; i++) {
+            table[idx + i] = mmu_section_desc(
+                r->pa + (i << MMU_SECTION_SHIFT), r->attr);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF mmu.c
@@ -0,0 +1,62 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _ARM7_9_MMU_H_
+#define _ARM7_9_MMU_H_
+
+#include "os/minios_type.h"
+
+/*
+ * First level translation table of 1MB sections (armv4/v5). The builder
+ * is plain c with no coprocessor access, the cp15 side is in cache.S.
+ */
+
+#define MMU_SECTION_SHIFT   20
+#define MMU_SECTION_SIZE    (1UL << MMU_SECTION_SHIFT)
+#define MMU_TABLE_ENTRIES   4096
+#define MMU_TABLE_SIZE      (MMU_TABLE_ENTRIES * 4)
+
+/* section descriptor bits, bit 4 must be set on arm9 */
+#define MMU_DESC_SECTION    0x12
+#define MMU_DESC_B          (1 << 2)
+#define MMU_DESC_C          (1 << 3)
+#define MMU_DESC_DOMAIN(d)  ((d) << 5)
+#define MMU_DESC_AP_RW      (3 << 10)
+#define MMU_DESC_FAULT      0
+
+/* region attributes, all in domain 0 with full access */
+#define MMU_MEM_WRITE_BACK  (MMU_DESC_C | MMU_DESC_B)
+#define MMU_MEM_WRITE_THRU  MMU_DESC_C
+#define MMU_MEM_DEVICE      0   /* uncached, unbuffered: register order kept */
+
+typedef struct {
+    address_t va;
+    address_t pa;
+    uint32_t size;
+    uint32_t attr;
+} mmu_region_t;
+
+static inline uint32_t mmu_section_desc(address_t pa, uint32_t attr)
+{
+    return (pa & ~(MMU_SECTION_SIZE - 1)) | MMU_DESC_AP_RW |
+           MMU_DESC_DOMAIN(0) | attr | MMU_DESC_SECTION;
+}
+
+/* unlisted addresses fault, regions must be section aligned */
+void mmu_build_table(uint32_t *table, const mmu_region_t *regions,
+    uint32_t nr);
+
+/* cache.S, the table must be 16KB aligned */
+void arm920_mmu_enable(uint32_t *table);
+void arm920_dcache_clean_range(address_t start, uint32_t len);
+void arm920_dcache_invalidate_range(address_t start, uint32_t len);
+void arm920_dcache_flush_range(address_t start, uint32_t len);
+void arm920_dcache_clean_all(void);
+void arm920_icache_invalidate_all(void);
+
+#endif // _ARM7_9_MMU_H_
+// EOF mmu.h
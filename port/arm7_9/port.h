@@ -9,6 +9,11 @@
 
 #include "os/minios_type.h"
 #include "port/arm7_9/cpu_const.h"
+#include "port/arm7_9/mmu.h"
+
+#if defined(CPU_NR) && (CPU_NR > 1)
+#error arm7_9 is uniprocessor, build with CPU_NR 1
+#endif
 
 /* find first set, return 0 - 32 */
 static inline int __ffs(uint32_t bits)
@@ -69,13 +74,87 @@ static inline void arm7_9_enable_irq(void)
 #define HAL_DISABLE_INTERRUPTS arm7_9_disable_irq
 #define HAL_ENABLE_INTERRUPTS arm7_9_enable_irq
 
+static inline cpu_flags_t arm7_9_irq_save(void)
+{
+    register cpu_flags_t flags;
+    register cpu_flags_t tmp;
+    asm volatile (
+        "mrs %0, cpsr\n\t"
+        "orr %1, %0, #0x80\n\t"
+        "msr cpsr_c, %1\n\t"
+        :"=r"(flags), "=r"(tmp)
+        :
+        :"memory", "cc");
+    return flags;
+}
+
+static inline void arm7_9_irq_restore(cpu_flags_t flags)
+{
+    asm volatile (
+        "msr cpsr_c, %0\n\t"
+        :
+        :"r"(flags)
+        :"memory", "cc");
+}
+
+/* nestable, usable where irq may already be disabled (isr, hsr) */
+#define HAL_IRQ_SAVE    arm7_9_irq_save
+#define HAL_IRQ_RESTORE arm7_9_irq_restore
+
+/* atomically store val to *addr, return the old value (armv4 swp) */
+static inline uint32_t arm7_9_swap(volatile uint32_t *addr, uint32_t val)
+{
+    register uint32_t old;
+    asm volatile (
+        "swp %0, %2, [%1]\n\t"
+        :"=&r"(old)
+        :"r"(addr), "r"(val)
+        :"memory");
+    return old;
+}
+
+#define HAL_ATOMIC_SWAP(addr, val) \
+    arm7_9_swap((volatile uint32_t *)(addr), (uint32_t)(val))
+
+/* pointers are 32 bits here, the same swp does */
+#define HAL_ATOMIC_SWAP_PTR(addr, val) \
+    ((void *)arm7_9_swap((volatile uint32_t *)(addr), (uint32_t)(val)))
+
+/* armv4 has no atomic add, one cpu with irq masked makes it one */
+static inline uint32_t arm7_9_atomic_add(volatile uint32_t *addr, uint32_t val)
+{
+    cpu_flags_t flags = arm7_9_irq_save();
+    uint32_t sum = *addr + val;
+
+    *addr = sum;
+    arm7_9_irq_restore(flags);
+    return sum;
+}
+
+/* add val to *addr, return the new value */
+#define HAL_ATOMIC_ADD(addr, val) \
+    arm7_9_atomic_add((volatile uint32_t *)(addr), (uint32_t)(val))
+
+/* ldm/stm versions in string.S instead of the c ones in os/string.c */
+#define HAL_ARCH_MEMCPY
+#define HAL_ARCH_MEMSET
+
+/* and the framebuffer kernels of os/fb.c, in blit.S */
+#define HAL_ARCH_FB_FILL
+#define HAL_ARCH_FB_COPY
+#define HAL_ARCH_FB_BLEND
+
+/* uniprocessor, spinlocks are compiled out and never spin */
+#define HAL_CPU_RELAX()
+
 void task_entry_wrapper(void);
 
-static inline void arm7_9_buid_stack(address_t *stack_addr)
+static inline void arm7_9_buid_stack(address_t *stack_addr,
+    address_t stack_base)
 {
     uint32_t *stack = *(uint32_t **)stack_addr;
 
-    *--stack = (uint32_t)(ARM_MODE_SVC | ARM_FIQ_BIT); /* CPSR */
+    *--stack = (uint32_t)ARM_MODE_SVC;                 /* CPSR */
     *--stack = (uint32_t)task_entry_wrapper;           /* PC */
     *--stack = (uint32_t)0;    /* LR */
     *--stack = (uint32_t)0;    /* R12 = IP(intra-procedure scratch register) */
@@ -97,8 +176,30 @@ static inline void arm7_9_buid_stack(address_t *stack_addr)
 
 #define HAL_TASK_BUILD_STACK arm7_9_buid_stack
 
-void arm7_9_switch_context(address_t *to, address_t *from);
-void arm7_9_load_context(address_t *to);
+/*
+ * Hot data and the irq/context switch code are linked into the on-chip
+ * sram (see arm7_9.lds), out of bl range of sdram, so calls into it are
+ * long calls.
+ */
+#define HAL_FAST_DATA __attribute__((section(".sram.data")))
+
+#ifdef __arm__
+#define ARM_LONG_CALL __attribute__((long_call))
+#else
+#define ARM_LONG_CALL
+#endif
+
+void arm7_9_switch_context(address_t *to, address_t *from) ARM_LONG_CALL;
+void arm7_9_load_context(address_t *to) ARM_LONG_CALL;
+
+/* write back before a device reads memory, drop before the cpu reads
+   what a device wrote */
+#define HAL_DCACHE_CLEAN(addr, len) \
+    arm920_dcache_clean_range((address_t)(addr), (len))
+#define HAL_DCACHE_INVALIDATE(addr, len) \
+    arm920_dcache_invalidate_range((address_t)(addr), (len))
+#define HAL_DCACHE_FLUSH(addr, len) \
+    arm920_dcache_flush_range((address_t)(addr), (len))
 
 #define HAL_TASK_SWITCH_CONTEXT arm7_9_switch_context
 #define HAL_LOAD_TASK_CONTEXT arm7_9_load_context
@@ -0,0 +1,239 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Host side of the hosted port, built against the c library and without
+ * the kernel headers (their basic types clash with the host ones).
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <ucontext.h>
+
+#ifndef CPU_NR
+#define CPU_NR 1
+#endif
+
+/* tick rate cpu 0 replays wall-clock time at */
+#ifndef HOSTED_HZ
+#define HOSTED_HZ 100
+#endif
+
+#ifndef HOSTED_LOG_FILE
+#define HOSTED_LOG_FILE "minios_hosted.log"
+#endif
+
+#define HOSTED_TICK_NS       (1000000000L / HOSTED_HZ)
+#define HOSTED_POLL_NS       1000000L
+
+void os_start(void);
+void start_sched(void);
+void task_entry_wrapper(void);
+void tick_increase(void);
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int kicked;
+} hosted_cpu_t;
+
+static hosted_cpu_t cpus[CPU_NR];
+static pthread_t cpu_threads[CPU_NR];
+static __thread int cpu_self;
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int started;
+
+static struct timespec next_tick;
+static uint32_t boot_start_us;
+
+/*--------------------------------------------------------------------------*/
+
+/* the ucontext lives at the top of the task stack, the task below it */
+void hosted_build_stack(unsigned long *stack_addr, unsigned long stack_base)
+{
+    unsigned long top = *stack_addr;
+    ucontext_t *uc = (ucontext_t *)((top - sizeof(ucontext_t)) & ~63UL);
+
+    getcontext(uc);
+    uc->uc_stack.ss_sp = (void *)stack_base;
+    uc->uc_stack.ss_size = (unsigned long)uc - stack_base;
+    uc->uc_link = NULL;
+    makecontext(uc, task_entry_wrapper, 0);
+
+    *stack_addr = (unsigned long)uc;
+}
+
+void hosted_switch_context(unsigned long *to, unsigned long *from)
+{
+    swapcontext((ucontext_t *)*from, (ucontext_t *)*to);
+}
+
+void hosted_load_context(unsigned long *to)
+{
+    setcontext((ucontext_t *)*to);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* never inlined into the kernel, tasks migrate between threads */
+int hosted_cpu_id(void)
+{
+    return cpu_self;
+}
+
+void hosted_cpu_kick(int cpu)
+{
+    hosted_cpu_t *c = cpus + cpu;
+
+    pthread_mutex_lock(&c->lock);
+    c->kicked = 1;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static inline void timespec_add_ns(struct timespec *ts, long ns)
+{
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+static inline int timespec_before(struct timespec *a, struct timespec *b)
+{
+    return (a->tv_sec < b->tv_sec) ||
+           ((a->tv_sec == b->tv_sec) && (a->tv_nsec < b->tv_nsec));
+}
+
+/*
+ * Sleep until kicked. Cpu 0 also wakes up on the next tick and replays
+ * the ticks that passed, the others poll now and then to steal work.
+ */
+void hosted_cpu_idle(void)
+{
+    hosted_cpu_t *c = cpus + cpu_self;
+    struct timespec now, until;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (0 == cpu_self) {
+        until = next_tick;
+    } else {
+        until = now;
+        timespec_add_ns(&until, HOSTED_POLL_NS);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->kicked && timespec_before(&now, &until)) {
+        pthread_cond_timedwait(&c->cond, &c->lock, &until);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    c->kicked = 0;
+    pthread_mutex_unlock(&c->lock);
+
+    if (0 != cpu_self)
+        return;
+
+    while (!timespec_before(&now, &next_tick)) {
+        timespec_add_ns(&next_tick, HOSTED_TICK_NS);
+        tick_increase();
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+uint32_t hosted_time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000000L + now.tv_nsec / 1000);
+}
+
+uint32_t platform_boot_clock(void)
+{
+    return hosted_time_us() - boot_start_us;
+}
+
+void hosted_exit(int code)
+{
+    fflush(stdout);
+    exit(code);
+}
+
+/* the drain task of os/log.c, raw records for tools/logdecode */
+void hosted_log_output(const void *buf, uint32_t len)
+{
+    static FILE *log_file;
+
+    if (NULL == log_file) {
+        log_file = fopen(HOSTED_LOG_FILE, "wb");
+        if (NULL == log_file) {
+            perror(HOSTED_LOG_FILE);
+            return;
+        }
+    }
+    fwrite(buf, 1, len, log_file);
+    fflush(log_file);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void *secondary_entry(void *arg)
+{
+    cpu_self = (int)(long)arg;
+
+    pthread_mutex_lock(&start_lock);
+    while (!started)
+        pthread_cond_wait(&start_cond, &start_lock);
+    pthread_mutex_unlock(&start_lock);
+
+    start_sched();
+    return NULL;
+}
+
+/* called by cpu 0 from start_sched(), the run queues are ready by now */
+void hosted_start_secondary(void)
+{
+    pthread_mutex_lock(&start_lock);
+    started = 1;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&start_lock);
+}
+
+int main(void)
+{
+    boot_start_us = hosted_time_us();
+
+    for (int i = 0; i < CPU_NR; i++) {
+        pthread_mutex_init(&cpus[i].lock, NULL);
+        pthread_cond_init(&cpus[i].cond, NULL);
+    }
+
+    for (int i = 1; i < CPU_NR; i++) {
+        if (pthread_create(cpu_threads + i, NULL, secondary_entry,
+            (void *)(long)i)) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &next_tick);
+    timespec_add_ns(&next_tick, HOSTED_TICK_NS);
+
+    cpu_self = 0;
+    os_start();
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF hosted.c
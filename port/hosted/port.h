@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _HOSTED_PORT_H_
+#define _HOSTED_PORT_H_
+
+#include "os/minios_type.h"
+
+/*
+ * The kernel running as a host process, one pthread per cpu and one
+ * ucontext per task. There are no interrupts: tasks switch when they
+ * block or yield, and cpu 0 turns wall-clock time into ticks when idle.
+ */
+
+/* -1 means no any bit set, otherwise 0 to 31 */
+#define HAL_FIND_FIRST_SET(bits) (__builtin_ffs(bits) - 1)
+
+#define HAL_DISABLE_INTERRUPTS()
+#define HAL_ENABLE_INTERRUPTS()
+#define HAL_IRQ_SAVE()          ((cpu_flags_t)0)
+#define HAL_IRQ_RESTORE(flags)  ((void)(flags))
+
+#define HAL_ATOMIC_SWAP(addr, val) \
+    __atomic_exchange_n((volatile uint32_t *)(addr), (uint32_t)(val), \
+        __ATOMIC_SEQ_CST)
+
+#define HAL_ATOMIC_SWAP_PTR(addr, val) \
+    __atomic_exchange_n((void *volatile *)(addr), (void *)(val), \
+        __ATOMIC_SEQ_CST)
+
+#define HAL_ATOMIC_ADD(addr, val) \
+    __atomic_add_fetch((volatile uint32_t *)(addr), (uint32_t)(val), \
+        __ATOMIC_SEQ_CST)
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAL_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define HAL_CPU_RELAX() __asm__ volatile ("" ::: "memory")
+#endif
+
+void hosted_build_stack(address_t *stack_addr, address_t stack_base);
+void hosted_switch_context(address_t *to, address_t *from);
+void hosted_load_context(address_t *to);
+
+#define HAL_TASK_BUILD_STACK hosted_build_stack
+#define HAL_TASK_SWITCH_CONTEXT hosted_switch_context
+#define HAL_LOAD_TASK_CONTEXT hosted_load_context
+
+int hosted_cpu_id(void);
+void hosted_cpu_kick(int cpu);
+void hosted_cpu_idle(void);
+void hosted_start_secondary(void);
+
+#define HAL_CPU_ID hosted_cpu_id
+#define HAL_CPU_KICK hosted_cpu_kick
+#define HAL_CPU_IDLE hosted_cpu_idle
+#define HAL_CPU_START_SECONDARY hosted_start_secondary
+
+/* no on-chip memory to put hot data in */
+#define HAL_FAST_DATA
+
+/* coherent host memory, nothing to maintain */
+#define HAL_DCACHE_CLEAN(addr, len)       ((void)(addr), (void)(len))
+#define HAL_DCACHE_INVALIDATE(addr, len)  ((void)(addr), (void)(len))
+#define HAL_DCACHE_FLUSH(addr, len)       ((void)(addr), (void)(len))
+
+/* the host linker only names sections that are c identifiers */
+#define TASK_TBL_SECTION "task_tbl"
+#define __task_tbl_start __start_task_tbl
+#define __task_tbl_end   __stop_task_tbl
+
+#define DEV_TBL_SECTION "dev_tbl"
+#define __DEV_TBL_START__ __start_dev_tbl
+#define __DEV_TBL_END__   __stop_dev_tbl
+
+/* the initcall levels are ordered by hosted.lds, as by arm7_9.lds */
+
+/* services of the host for applications measuring the kernel */
+uint32_t hosted_time_us(void);
+void hosted_exit(int code);
+
+/* log records stamped in microseconds, drained to minios_hosted.log */
+void hosted_log_output(const void *buf, uint32_t len);
+#define HAL_LOG_CLOCK  hosted_time_us
+#define HAL_LOG_OUTPUT hosted_log_output
+
+#endif // _HOSTED_PORT_H_
+// EOF port.h
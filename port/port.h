@@ -1 +0,0 @@
-arm7_9/port.h
\ No newline at end of file
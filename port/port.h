@@ -0,0 +1,18 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _PORT_H_
+#define _PORT_H_
+
+/* -DPORT_HOSTED builds the kernel as a process on the host for measuring */
+#if defined(PORT_HOSTED)
+#include "port/hosted/port.h"
+#else
+#include "port/arm7_9/port.h"
+#endif
+
+#endif // _PORT_H_
+// EOF port.h
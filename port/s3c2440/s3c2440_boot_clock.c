@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/s3c2440/s3c2440_io.h"
+#include "port/s3c2440/s3c2440_regs.h"
+#include "port/s3c2440/s3c2440_interrupt.h"
+#include "os/boottime.h"
+#include "port/port.h"
+
+/* pwm timer4 (no pin), pclk 50MHz / (249 + 1) / 2 = 100KHz */
+#define BOOT_CLOCK_PRESCALER 249
+#define BOOT_CLOCK_US        10
+#define BOOT_CLOCK_IRQ       14
+
+#define TCON_T4_START        (1 << 20)
+#define TCON_T4_UPDATE       (1 << 21)
+#define TCON_T4_RELOAD       (1 << 22)
+
+/* reloads of the 16 bit counter, the upper bits of the clock */
+static volatile uint32_t boot_clock_wraps;
+static bool_t boot_clock_irq_on;
+
+/*--------------------------------------------------------------------------*/
+
+/* called by head.S before .bss is cleared, it must not touch globals */
+void platform_boot_clock_start(void)
+{
+    uint32_t tmp;
+
+    /* prescaler 1 is shared by timer 2 - 4 */
+    tmp = READ_REG(TCFG0);
+    tmp = (tmp & ~(0xff << 8)) | (BOOT_CLOCK_PRESCALER << 8);
+    WRITE_REG(TCFG0, tmp);
+
+    /* mux4 = 1/2 */
+    tmp = READ_REG(TCFG1);
+    tmp &= ~(0xf << 16);
+    WRITE_REG(TCFG1, tmp);
+
+    WRITE_REG(TCNTB4, 0xffff);
+    WRITE_REG(SRCPND, 1 << BOOT_CLOCK_IRQ);
+
+    /* load the count, then free run with auto-reload */
+    tmp = READ_REG(TCON) & ~(TCON_T4_START | TCON_T4_UPDATE | TCON_T4_RELOAD);
+    WRITE_REG(TCON, tmp | TCON_T4_UPDATE);
+    WRITE_REG(TCON, tmp | TCON_T4_RELOAD | TCON_T4_START);
+}
+
+static void boot_clock_irq(int irq, void *data)
+{
+    ++boot_clock_wraps;
+}
+
+/*
+ * The counter is 16 bits and goes down from 0xffff, each reload adds
+ * 0x10000 ticks. The irq counts reloads; while irq is masked, and at
+ * boot before interrupts run, a read finding the reload pending counts
+ * it itself. The irq is hooked up on the first read, .bss is clear by
+ * then.
+ */
+uint32_t platform_boot_clock(void)
+{
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+    uint32_t now;
+
+    if (!boot_clock_irq_on) {
+        boot_clock_irq_on = TRUE;
+        register_irq(BOOT_CLOCK_IRQ, boot_clock_irq, NULL);
+        s3c2440_enable_irq(BOOT_CLOCK_IRQ);
+    }
+
+    now = READ_REG(TCNTO4) & 0xffff;
+
+    // reloaded since, maybe just after the read, which is done again
+    if (READ_REG(SRCPND) & (1 << BOOT_CLOCK_IRQ)) {
+        s3c2440_clear_irq(BOOT_CLOCK_IRQ);
+        ++boot_clock_wraps;
+        now = READ_REG(TCNTO4) & 0xffff;
+    }
+
+    now = (boot_clock_wraps << 16) + (0xffff - now);
+    HAL_IRQ_RESTORE(flags);
+
+    return now * BOOT_CLOCK_US;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_boot_clock.c
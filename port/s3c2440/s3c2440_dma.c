@@ -0,0 +1,350 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/s3c2440/s3c2440_io.h"
+#include "port/s3c2440/s3c2440_regs.h"
+#include "port/s3c2440/s3c2440_interrupt.h"
+#include "port/s3c2440/s3c2440_dma.h"
+#include "os/hsr.h"
+#include "os/init.h"
+#include "port/port.h"
+
+#define DMA0_IRQ            17
+
+/* DISRCC/DIDSTC */
+#define DMA_LOC_APB         (1 << 1)
+#define DMA_INC_FIXED       (1 << 0)
+
+/* DCON */
+#define DCON_HANDSHAKE      (1 << 31)
+#define DCON_SYNC_AHB       (1 << 30)
+#define DCON_INT            (1 << 29)
+#define DCON_BURST          (1 << 28)
+#define DCON_WHOLE          (1 << 27)
+#define DCON_HWSRC(sel)     ((sel) << 24)
+#define DCON_HW_TRIGGER     (1 << 23)
+#define DCON_NO_RELOAD      (1 << 22)
+#define DCON_DSZ(w)         ((w) << 20)
+#define DCON_TC_MAX         0xfffff
+
+/* DMASKTRIG */
+#define DMA_STOP            (1 << 2)
+#define DMA_ON              (1 << 1)
+#define DMA_SW_TRIG         (1 << 0)
+
+static dma_chan_t dma_chans[DMA_CHANNEL_NR];
+
+/* HWSRCSEL + 1 of each source per channel, 0 if it is not wired there */
+static const uint8_t dma_hwsrc[DMA_CHANNEL_NR][DMA_SRC_MAX_NR] = {
+    {
+        [DMA_SRC_XDREQ0] = 1, [DMA_SRC_UART0] = 2, [DMA_SRC_SDI] = 3,
+        [DMA_SRC_TIMER] = 4, [DMA_SRC_USB_EP1] = 5, [DMA_SRC_I2SSDO] = 6,
+        [DMA_SRC_PCMIN] = 7,
+    }, {
+        [DMA_SRC_XDREQ1] = 1, [DMA_SRC_UART1] = 2, [DMA_SRC_I2SSDI] = 3,
+        [DMA_SRC_SPI0] = 4, [DMA_SRC_USB_EP2] = 5, [DMA_SRC_PCMOUT] = 6,
+        [DMA_SRC_SDI] = 7,
+    }, {
+        [DMA_SRC_I2SSDO] = 1, [DMA_SRC_I2SSDI] = 2, [DMA_SRC_SDI] = 3,
+        [DMA_SRC_TIMER] = 4, [DMA_SRC_USB_EP3] = 5, [DMA_SRC_PCMIN] = 6,
+        [DMA_SRC_MICIN] = 7,
+    }, {
+        [DMA_SRC_UART2] = 1, [DMA_SRC_SDI] = 2, [DMA_SRC_SPI1] = 3,
+        [DMA_SRC_TIMER] = 4, [DMA_SRC_USB_EP4] = 5, [DMA_SRC_MICIN] = 6,
+        [DMA_SRC_PCMOUT] = 7,
+    },
+};
+
+/*--------------------------------------------------------------------------*/
+
+/* interrupts masked, program the next chunk of 'x' and start it */
+static void dma_start_chunk(dma_chan_t *ch, dma_xfer_t *x)
+{
+    uint32_t off = x->len - x->left;
+    uint32_t srcc = 0, dstc = 0, dcon, shift, n;
+    address_t src = x->src, dst = x->dst;
+
+    if (DMA_MEM_TO_MEM == x->dir) {
+        // 4 word bursts when everything is 16 byte aligned
+        src += off;
+        dst += off;
+        dcon = DCON_SYNC_AHB | DCON_WHOLE | DCON_DSZ(x->width);
+        shift = x->width;
+        if ((DMA_WIDTH_32 == x->width) && (0 == ((src | dst | x->left) & 15))) {
+            dcon |= DCON_BURST;
+            shift += 2;
+        }
+    } else {
+        if (DMA_MEM_TO_DEV == x->dir) {
+            src += off;
+            dstc = DMA_LOC_APB | DMA_INC_FIXED;
+        } else {
+            dst += off;
+            srcc = DMA_LOC_APB | DMA_INC_FIXED;
+        }
+        dcon = DCON_HANDSHAKE | DCON_HWSRC(ch->hwsrc) | DCON_HW_TRIGGER |
+               DCON_DSZ(x->width);
+        shift = x->width;
+    }
+
+    n = x->left >> shift;
+    if (n > DCON_TC_MAX)
+        n = DCON_TC_MAX;
+    x->chunk = n << shift;
+
+    WRITE_REG(DMA_PORT(ch->nr, oDISRC), src);
+    WRITE_REG(DMA_PORT(ch->nr, oDISRCC), srcc);
+    WRITE_REG(DMA_PORT(ch->nr, oDIDST), dst);
+    WRITE_REG(DMA_PORT(ch->nr, oDIDSTC), dstc);
+    WRITE_REG(DMA_PORT(ch->nr, oDCON), dcon | DCON_INT | DCON_NO_RELOAD | n);
+
+    if (DMA_MEM_TO_MEM == x->dir)
+        WRITE_REG(DMA_PORT(ch->nr, oDMASKTRIG), DMA_ON | DMA_SW_TRIG);
+    else
+        WRITE_REG(DMA_PORT(ch->nr, oDMASKTRIG), DMA_ON);
+}
+
+static void dma_isr(int irq, void *data)
+{
+    dma_chan_t *ch = (dma_chan_t *)data;
+    list_head_t *node = LIST_FIRST(&ch->queue);
+    dma_xfer_t *x;
+
+    if (NULL == node)
+        return;
+
+    x = LIST_ENTRY(node, dma_xfer_t, node);
+    x->left -= x->chunk;
+    if (0 != x->left) {
+        dma_start_chunk(ch, x);
+        return;
+    }
+
+    // keep the channel busy, the completion is handled later
+    LIST_DEL(&x->node);
+    LIST_ADD_TAIL(&ch->done, &x->node);
+    --ch->queued;
+
+    node = LIST_FIRST(&ch->queue);
+    if (NULL != node)
+        dma_start_chunk(ch, LIST_ENTRY(node, dma_xfer_t, node));
+
+    activiate_hsr(&ch->hsr, ch);
+}
+
+static void dma_complete(void *data)
+{
+    dma_chan_t *ch = (dma_chan_t *)data;
+    cpu_flags_t flags;
+    list_head_t *node;
+    dma_xfer_t *x;
+    task_t *waiter;
+
+    while (1) {
+        flags = HAL_IRQ_SAVE();
+        node = LIST_FIRST(&ch->done);
+        if (NULL != node)
+            LIST_DEL(node);
+        HAL_IRQ_RESTORE(flags);
+
+        if (NULL == node)
+            break;
+
+        // done first, the callback may queue it again
+        x = LIST_ENTRY(node, dma_xfer_t, node);
+        waiter = x->waiter;
+        x->waiter = NULL;
+        x->done = 1;
+
+        if (x->callback)
+            x->callback(x, x->data);
+        if (waiter)
+            task_resume(waiter, 0);
+    }
+}
+
+/* interrupts masked, onto the channel and started if it was idle */
+static void dma_queue(dma_chan_t *ch, dma_xfer_t *x)
+{
+    bool_t idle = LIST_EMPTY(&ch->queue);
+
+    x->done = 0;
+    x->left = x->len;
+
+    LIST_ADD_TAIL(&ch->queue, &x->node);
+    ++ch->queued;
+    if (idle)
+        dma_start_chunk(ch, x);
+}
+
+static bool_t dma_submit(dma_chan_t *ch, dma_xfer_t *x)
+{
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+
+    dma_queue(ch, x);
+    HAL_IRQ_RESTORE(flags);
+
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void dma_xfer_init(dma_xfer_t *x, dma_callback_t callback, void *data)
+{
+    INIT_LIST_HEAD(&x->node);
+    x->len = 0;
+    x->left = 0;
+    x->chunk = 0;
+    x->callback = callback;
+    x->data = data;
+    x->waiter = NULL;
+    x->done = 1;
+}
+
+/*
+ * The channel is picked and queued on with interrupts masked throughout,
+ * dma_request_channel() cannot hand it to a device in between.
+ */
+bool_t dma_memcpy(dma_xfer_t *x, void *dst, const void *src, uint32_t len)
+{
+    dma_chan_t *ch, *best = NULL;
+    cpu_flags_t flags;
+
+    if (!x->done || (0 == len))
+        return FALSE;
+
+    HAL_DCACHE_CLEAN(src, len);
+    HAL_DCACHE_FLUSH(dst, len);
+
+    x->src = (address_t)src;
+    x->dst = (address_t)dst;
+    x->len = len;
+    x->dir = DMA_MEM_TO_MEM;
+    if (0 == (((address_t)src | (address_t)dst | len) & 3))
+        x->width = DMA_WIDTH_32;
+    else
+        x->width = DMA_WIDTH_8;
+
+    flags = HAL_IRQ_SAVE();
+    for (ch = dma_chans; ch < dma_chans + DMA_CHANNEL_NR; ch++) {
+        if ((DMA_SRC_MEM == ch->source) &&
+            ((NULL == best) || (ch->queued < best->queued)))
+            best = ch;
+    }
+    if (NULL != best)
+        dma_queue(best, x);
+    HAL_IRQ_RESTORE(flags);
+
+    return (NULL != best) ? TRUE : FALSE;
+}
+
+dma_chan_t *dma_request_channel(int source)
+{
+    cpu_flags_t flags;
+    dma_chan_t *ch;
+
+    BUG_ON((source <= DMA_SRC_MEM) || (source >= DMA_SRC_MAX_NR));
+
+    flags = HAL_IRQ_SAVE();
+    for (ch = dma_chans; ch < dma_chans + DMA_CHANNEL_NR; ch++) {
+        // a memory channel with copies in flight is not taken over
+        if ((DMA_SRC_MEM == ch->source) && (0 == ch->queued) &&
+            (0 != dma_hwsrc[ch->nr][source])) {
+            ch->source = source;
+            ch->hwsrc = dma_hwsrc[ch->nr][source] - 1;
+            break;
+        }
+    }
+    HAL_IRQ_RESTORE(flags);
+
+    return (ch < dma_chans + DMA_CHANNEL_NR) ? ch : NULL;
+}
+
+void dma_release_channel(dma_chan_t *ch)
+{
+    BUG_ON(0 != ch->queued);
+    ch->source = DMA_SRC_MEM;
+}
+
+bool_t dma_to_device(dma_chan_t *ch, dma_xfer_t *x, address_t reg,
+    const void *buf, uint32_t len, uint8_t width)
+{
+    BUG_ON(DMA_SRC_MEM == ch->source);
+    BUG_ON(len & ((1 << width) - 1));
+
+    if (!x->done || (0 == len))
+        return FALSE;
+
+    HAL_DCACHE_CLEAN(buf, len);
+
+    x->src = (address_t)buf;
+    x->dst = reg;
+    x->len = len;
+    x->dir = DMA_MEM_TO_DEV;
+    x->width = width;
+
+    return dma_submit(ch, x);
+}
+
+bool_t dma_from_device(dma_chan_t *ch, dma_xfer_t *x, void *buf,
+    address_t reg, uint32_t len, uint8_t width)
+{
+    BUG_ON(DMA_SRC_MEM == ch->source);
+    BUG_ON(len & ((1 << width) - 1));
+
+    if (!x->done || (0 == len))
+        return FALSE;
+
+    HAL_DCACHE_FLUSH(buf, len);
+
+    x->src = reg;
+    x->dst = (address_t)buf;
+    x->len = len;
+    x->dir = DMA_DEV_TO_MEM;
+    x->width = width;
+
+    return dma_submit(ch, x);
+}
+
+void dma_wait(dma_xfer_t *x)
+{
+    // the completion hsr cannot run between the check and the suspend
+    task_lock();
+    while (!x->done) {
+        x->waiter = current;
+        task_suspend(current, 0, NULL, NULL);
+        task_unlock();
+        task_lock();
+    }
+    task_unlock();
+}
+
+/*--------------------------------------------------------------------------*/
+
+static bool_t s3c2440_dma_init(void)
+{
+    dma_chan_t *ch;
+
+    for (ch = dma_chans; ch < dma_chans + DMA_CHANNEL_NR; ch++) {
+        ch->nr = ch - dma_chans;
+        ch->source = DMA_SRC_MEM;
+        ch->queued = 0;
+        INIT_LIST_HEAD(&ch->queue);
+        INIT_LIST_HEAD(&ch->done);
+        INIT_HSR(&ch->hsr, 0, dma_complete, "dma_hsr");
+
+        WRITE_REG(DMA_PORT(ch->nr, oDMASKTRIG), DMA_STOP);
+        register_irq(DMA0_IRQ + ch->nr, dma_isr, ch);
+        s3c2440_enable_irq(DMA0_IRQ + ch->nr);
+    }
+
+    return TRUE;
+}
+
+DECLARE_INITCALL(s3c2440_dma_init, 1);
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_dma.c
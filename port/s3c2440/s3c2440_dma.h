@@ -0,0 +1,107 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _MINIOS_S3C2440_DMA_H_
+#define _MINIOS_S3C2440_DMA_H_
+
+#include "os/task.h"
+
+#define DMA_CHANNEL_NR  4
+
+/* request sources, each is wired to some of the channels only */
+#define DMA_SRC_MEM     0   /* software triggered, any channel */
+#define DMA_SRC_XDREQ0  1
+#define DMA_SRC_XDREQ1  2
+#define DMA_SRC_UART0   3
+#define DMA_SRC_UART1   4
+#define DMA_SRC_UART2   5
+#define DMA_SRC_SDI     6
+#define DMA_SRC_TIMER   7
+#define DMA_SRC_USB_EP1 8
+#define DMA_SRC_USB_EP2 9
+#define DMA_SRC_USB_EP3 10
+#define DMA_SRC_USB_EP4 11
+#define DMA_SRC_I2SSDO  12
+#define DMA_SRC_I2SSDI  13
+#define DMA_SRC_SPI0    14
+#define DMA_SRC_SPI1    15
+#define DMA_SRC_PCMIN   16
+#define DMA_SRC_PCMOUT  17
+#define DMA_SRC_MICIN   18
+#define DMA_SRC_MAX_NR  19
+
+/* bytes per device access */
+#define DMA_WIDTH_8     0
+#define DMA_WIDTH_16    1
+#define DMA_WIDTH_32    2
+
+#define DMA_MEM_TO_MEM  0
+#define DMA_MEM_TO_DEV  1
+#define DMA_DEV_TO_MEM  2
+
+struct dma_xfer;
+typedef void (*dma_callback_t)(struct dma_xfer *, void *);
+
+/*
+ * One transfer, owned by the caller until it is done. Transfers queue on
+ * their channel and the isr starts the next one at once; longer ones
+ * than a channel takes in one go run as several chunks. The callback
+ * runs in the completion hsr once 'done' is set, it may queue 'x' again.
+ */
+typedef struct dma_xfer {
+    list_head_t node;
+    address_t src;
+    address_t dst;
+    uint32_t len;
+    uint32_t left;
+    uint32_t chunk;         /* bytes the channel is moving now */
+    uint8_t dir;
+    uint8_t width;
+    dma_callback_t callback;
+    void *data;
+    task_t *waiter;
+    volatile uint32_t done;
+} dma_xfer_t;
+
+typedef struct dma_chan {
+    int nr;
+    int source;             /* DMA_SRC_MEM unless a device owns it */
+    uint32_t hwsrc;
+    uint32_t queued;
+    list_head_t queue;      /* the first one is on the channel */
+    list_head_t done;
+    hsr_t hsr;
+} dma_chan_t;
+
+void dma_xfer_init(dma_xfer_t *x, dma_callback_t callback, void *data);
+
+/*
+ * Asynchronous copy on the least busy memory channel. Both buffers are
+ * written back from / dropped out of the data cache here, neither may
+ * be touched until the transfer is done. FALSE if 'x' is still busy.
+ */
+bool_t dma_memcpy(dma_xfer_t *x, void *dst, const void *src, uint32_t len);
+
+/* a channel for a device, NULL if none of its channels is free */
+dma_chan_t *dma_request_channel(int source);
+void dma_release_channel(dma_chan_t *ch);
+
+/* 'reg' is the physical address of the device fifo or data register */
+bool_t dma_to_device(dma_chan_t *ch, dma_xfer_t *x, address_t reg,
+    const void *buf, uint32_t len, uint8_t width);
+bool_t dma_from_device(dma_chan_t *ch, dma_xfer_t *x, void *buf,
+    address_t reg, uint32_t len, uint8_t width);
+
+/* task context, sleeps until the transfer is done */
+void dma_wait(dma_xfer_t *x);
+
+static inline bool_t dma_done(dma_xfer_t *x)
+{
+    return x->done ? TRUE : FALSE;
+}
+
+#endif // _MINIOS_S3C2440_DMA_H_
+// EOF s3c2440_dma.h
@@ -7,30 +7,57 @@
 #include "port/s3c2440/s3c2440_io.h"
 #include "port/s3c2440/s3c2440_regs.h"
 #include "port/s3c2440/s3c2440_interrupt.h"
+#include "os/task.h"
+#include "os/hsr.h"
+#include "port/port.h"
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t int_enabled;        /* sources unmasked by drivers */
+static uint32_t int_blocked;        /* sources held off by running isrs */
+static uint32_t int_blocked_stack[INT_PRIORITY_MAX_NR];
+static int int_nested;
+
+static uint8_t int_priority[INT_MAX_NR] = {
+    [0 ... INT_MAX_NR - 1] = INT_PRIORITY_MAX_NR - 1,
+};
+
+/* sources whose priority is equal to or lower than the index */
+static uint32_t int_prio_mask[INT_PRIORITY_MAX_NR] = {
+    [0 ... INT_PRIORITY_MAX_NR - 1] = 0xffffffff,
+};
+
+static fiq_handle_t fiq_handler;
+static void *fiq_data;
+static uint32_t fiq_source;
+
+static inline void int_update_mask(void)
+{
+    uint32_t blocked = int_blocked & ~fiq_source;
+    WRITE_REG(INTMASK, ~(int_enabled & ~blocked));
+}
 
 void s3c2440_enable_irq(int irq)
 {
-    uint32_t tmp = READ_REG(INTMASK);
-    tmp &= ~(1 << irq);
-    WRITE_REG(INTMASK, tmp);
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+    int_enabled |= (1 << irq);
+    int_update_mask();
+    HAL_IRQ_RESTORE(flags);
 }
 
 void s3c2440_disable_irq(int irq)
 {
-    uint32_t tmp = READ_REG(INTMASK);
-    tmp |= (1 << irq);
-    WRITE_REG(INTMASK, tmp);
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+    int_enabled &= ~(1 << irq);
+    int_update_mask();
+    HAL_IRQ_RESTORE(flags);
 }
 
 void s3c2440_clear_irq(int irq)
 {
-    uint32_t tmp = READ_REG(SRCPND);
-    tmp |= (1 << irq);
-    WRITE_REG(SRCPND, tmp);
-
-    tmp = READ_REG(INTPND);
-    tmp |= (1 << irq);
-    WRITE_REG(INTPND, tmp);
+    /* write 1 to clear, writing back the read value clears all others */
+    WRITE_REG(SRCPND, 1 << irq);
+    WRITE_REG(INTPND, 1 << irq);
 }
 
 uint32_t s3c2440_get_irq(void)
@@ -47,23 +74,25 @@ uint32_t s3c2440_get_subirq(void)
 
 void s3c2440_enable_subirq(int subirq)
 {
+    cpu_flags_t flags = HAL_IRQ_SAVE();
     uint32_t tmp = READ_REG(INTSUBMASK);
     tmp &= ~(1 << subirq);
     WRITE_REG(INTSUBMASK, tmp);
+    HAL_IRQ_RESTORE(flags);
 }
 
 void s3c2440_disable_subirq(int subirq)
 {
+    cpu_flags_t flags = HAL_IRQ_SAVE();
     uint32_t tmp = READ_REG(INTSUBMASK);
     tmp |= (1 << subirq);
     WRITE_REG(INTSUBMASK, tmp);
+    HAL_IRQ_RESTORE(flags);
 }
 
 void s3c2440_clear_subirq(int subirq)
 {
-    uint32_t tmp = READ_REG(SUBSRCPND);
-    tmp |= (1 << subirq);
-    WRITE_REG(SUBSRCPND, tmp);
+    WRITE_REG(SUBSRCPND, 1 << subirq);
 }
 
 /*--------------------------------------------------------------------------*/
@@ -71,9 +100,24 @@ void s3c2440_clear_subirq(int subirq)
 typedef struct {
     int_handle_t handler;
     void *data;
+    task_t *thread;
+    hsr_t wakeup;
+    int_action_t *actions;
+    uint32_t submask;
 } int_desc_t;
 
 static int_desc_t int_descs[INT_MAX_NR];
+static int_action_t *subint_actions[SUBINT_MAX_NR];
+
+/* parent source of each SUBSRCPND bit */
+static const uint8_t subint_parent[SUBINT_MAX_NR] = {
+    28, 28, 28,     /* UART0: RXD0 TXD0 ERR0 */
+    23, 23, 23,     /* UART1: RXD1 TXD1 ERR1 */
+    15, 15, 15,     /* UART2: RXD2 TXD2 ERR2 */
+    31, 31,         /* ADC:   TC ADC_S */
+    6, 6,           /* CAM:   CAM_C CAM_P */
+    9, 9,           /* WDT_AC97: WDT AC97 */
+};
 
 static void int_bad_handler(int irq, void *data)
 {
@@ -85,13 +129,46 @@ static int_desc_t bad_int_desc = {
     .data = NULL,
 };
 
-void platform_do_interrupt(void)
+uint32_t platform_irq_enter(void)
 {
-    int_desc_t *desc = &bad_int_desc;
     uint32_t irq = s3c2440_get_irq();
+
+    if (irq >= INT_MAX_NR)
+        return irq;
+
+    BUG_ON(int_nested >= INT_PRIORITY_MAX_NR);
+    int_blocked_stack[int_nested++] = int_blocked;
+    int_blocked |= int_prio_mask[int_priority[irq]];
+    int_update_mask();
+
+    // INTPND must be clear before irq is re-enabled, or it re-enters at once
+    s3c2440_clear_irq(irq);
+
+    return irq;
+}
+
+void platform_irq_handle(uint32_t irq)
+{
+    int_desc_t *desc = &bad_int_desc;
     if ((irq >= 0) && (irq < INT_MAX_NR))
         desc = int_descs + irq;
-    desc->handler(irq, desc->data);
+
+    if (NULL != desc->thread) {
+        // keep it masked until the irq thread has handled it
+        s3c2440_disable_irq(irq);
+        activiate_hsr(&desc->wakeup, desc);
+    } else {
+        desc->handler(irq, desc->data);
+    }
+}
+
+void platform_irq_exit(uint32_t irq)
+{
+    if (irq >= INT_MAX_NR)
+        return;
+
+    int_blocked = int_blocked_stack[--int_nested];
+    int_update_mask();
 }
 
 void register_irq(int irq, int_handle_t handler, void *data)
@@ -106,5 +183,242 @@ void register_irq(int irq, int_handle_t handler, void *data)
     }
 }
 
+/*--------------------------------------------------------------------------*/
+
+static inline void int_action_add(int_action_t **head, int_action_t *action)
+{
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+
+    while (NULL != *head)
+        head = &(*head)->next;
+    action->next = NULL;
+    *head = action;
+
+    HAL_IRQ_RESTORE(flags);
+}
+
+static void int_chain_handler(int irq, void *data)
+{
+    int_desc_t *desc = (int_desc_t *)data;
+    int_action_t *action;
+
+    for (action = desc->actions; action; action = action->next)
+        action->handler(irq, action->data);
+}
+
+void register_shared_irq(int irq, int_action_t *action)
+{
+    int_desc_t *desc = int_descs + irq;
+
+    BUG_ON((irq < 0) || (irq >= INT_MAX_NR));
+    BUG_ON((NULL != desc->handler) && (int_chain_handler != desc->handler));
+
+    int_action_add(&desc->actions, action);
+    desc->data = desc;
+    desc->handler = int_chain_handler;
+}
+
+/*
+ * Read SUBSRCPND once, ack every pending sub-source of this line in one
+ * write and run their chains lowest bit first. The parent is acked again
+ * afterwards, it was re-latched while the sub-sources were still pending.
+ */
+static void int_subirq_demux(int irq, void *data)
+{
+    int_desc_t *desc = (int_desc_t *)data;
+    uint32_t pending;
+    int_action_t *action;
+    int nr;
+
+    pending = READ_REG(SUBSRCPND) & ~READ_REG(INTSUBMASK) & desc->submask;
+    WRITE_REG(SUBSRCPND, pending);
+    s3c2440_clear_irq(irq);
+
+    while (0 != pending) {
+        nr = HAL_FIND_FIRST_SET(pending);
+        pending &= ~(1 << nr);
+        for (action = subint_actions[nr]; action; action = action->next)
+            action->handler(nr, action->data);
+    }
+}
+
+void register_subirq(int subirq, int_action_t *action)
+{
+    int_desc_t *desc;
+
+    BUG_ON((subirq < 0) || (subirq >= SUBINT_MAX_NR));
+
+    desc = int_descs + subint_parent[subirq];
+    BUG_ON((NULL != desc->handler) && (int_subirq_demux != desc->handler));
+
+    int_action_add(subint_actions + subirq, action);
+    desc->submask |= (1 << subirq);
+    desc->data = desc;
+    desc->handler = int_subirq_demux;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* first level arbiter and its request line for each source */
+static inline int int_arbiter(int irq)
+{
+    if (irq < 4)
+        return 0;
+    if (irq >= 28)
+        return 5;
+    return (irq - 4) / 6 + 1;
+}
+
+static inline int int_arbiter_req(int irq)
+{
+    if (irq < 4)
+        return irq + 1;
+    if (irq >= 28)
+        return irq - 27;
+    return (irq - 4) % 6;
+}
+
+/*
+ * Program PRIORITY in fixed mode so that, for sources pending at the
+ * same time, INTOFFSET reports the most urgent one. Only REQ1-4 of each
+ * arbiter can be reordered, REQ0 always wins and REQ5 always loses.
+ */
+static void int_update_arbiter(void)
+{
+    uint8_t arb_prio[6];
+    uint8_t first_prio[7];
+    uint32_t sel[7] = {0};
+    uint32_t value = 0;
+    int i, arb, req;
+
+    for (i = 0; i < 7; i++) {
+        if (i < 6)
+            arb_prio[i] = INT_PRIORITY_MAX_NR;
+        first_prio[i] = INT_PRIORITY_MAX_NR;
+    }
+
+    for (i = 0; i < INT_MAX_NR; i++) {
+        arb = int_arbiter(i);
+        req = int_arbiter_req(i);
+        if (int_priority[i] < arb_prio[arb])
+            arb_prio[arb] = int_priority[i];
+        if ((req >= 1) && (req <= 4) && (int_priority[i] < first_prio[arb])) {
+            first_prio[arb] = int_priority[i];
+            sel[arb] = req - 1;
+        }
+    }
+
+    /* ARBITER6 takes ARBITER0-5 as REQ0-5 */
+    for (arb = 1; arb <= 4; arb++) {
+        if (arb_prio[arb] < first_prio[6]) {
+            first_prio[6] = arb_prio[arb];
+            sel[6] = arb - 1;
+        }
+    }
+
+    for (i = 0; i < 7; i++)
+        value |= sel[i] << (7 + 2 * i);
+
+    WRITE_REG(PRIORITY, value);
+}
+
+void set_irq_priority(int irq, uint8_t priority)
+{
+    cpu_flags_t flags;
+    uint32_t mask;
+
+    BUG_ON((irq < 0) || (irq >= INT_MAX_NR));
+    BUG_ON(priority >= INT_PRIORITY_MAX_NR);
+
+    flags = HAL_IRQ_SAVE();
+
+    int_priority[irq] = priority;
+
+    for (int p = 0; p < INT_PRIORITY_MAX_NR; p++) {
+        mask = 0;
+        for (int i = 0; i < INT_MAX_NR; i++) {
+            if (int_priority[i] >= p)
+                mask |= (1 << i);
+        }
+        int_prio_mask[p] = mask;
+    }
+
+    int_update_arbiter();
+
+    HAL_IRQ_RESTORE(flags);
+}
+
+/*--------------------------------------------------------------------------*/
+
+void platform_do_fiq(void)
+{
+    fiq_handler(fiq_data);
+    /* fiq sources are not latched in INTPND */
+    WRITE_REG(SRCPND, fiq_source);
+}
+
+void register_fiq(int irq, fiq_handle_t handler, void *data)
+{
+    cpu_flags_t flags;
+
+    BUG_ON((irq < 0) || (irq >= INT_MAX_NR));
+    BUG_ON(0 != fiq_source);
+
+    flags = HAL_IRQ_SAVE();
+
+    fiq_handler = handler;
+    fiq_data = data;
+    fiq_source = (1 << irq);
+    WRITE_REG(INTMOD, fiq_source);
+
+    int_enabled |= fiq_source;
+    int_update_mask();
+
+    HAL_IRQ_RESTORE(flags);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void int_thread_wakeup(void *data)
+{
+    int_desc_t *desc = (int_desc_t *)data;
+    task_resume(desc->thread, 0);
+}
+
+static void int_thread_entry(void *para)
+{
+    int_desc_t *desc = (int_desc_t *)para;
+    int irq = desc - int_descs;
+
+    while (1) {
+        // unmask and sleep atomically, the wakeup hsr cannot run in between
+        task_lock();
+        s3c2440_enable_irq(irq);
+        task_suspend(desc->thread, 0, NULL, NULL);
+        task_unlock();
+
+        desc->handler(irq, desc->data);
+    }
+}
+
+void register_threaded_irq(int irq, int_handle_t handler, void *data,
+    void *task, uint8_t priority)
+{
+    int_desc_t *desc = int_descs + irq;
+
+    BUG_ON((irq < 0) || (irq >= INT_MAX_NR));
+    BUG_ON(NULL != desc->thread);
+
+    s3c2440_disable_irq(irq);
+
+    desc->handler = handler;
+    desc->data = data;
+    desc->thread = &((task_struct_t *)task)->task;
+    INIT_HSR(&desc->wakeup, 0, int_thread_wakeup, "irq_thread_hsr");
+
+    task_struct_create(task, "irq_thread", priority, 0,
+        int_thread_entry, desc);
+}
+
 /*--------------------------------------------------------------------------*/
 // EOF s3c2440_interrupt.c
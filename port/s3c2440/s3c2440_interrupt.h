@@ -19,9 +19,77 @@ void s3c2440_clear_subirq(int subirq);
 uint32_t s3c2440_get_subirq(void);
 
 #define INT_MAX_NR 32
+#define INT_PRIORITY_MAX_NR 8
 
 typedef void (*int_handle_t)(int, void *);
 void register_irq(int irq, int_handle_t handler, void *data);
 
+/*--------------------------------------------------------------------------*/
+
+#define SUBINT_RXD0     0
+#define SUBINT_TXD0     1
+#define SUBINT_ERR0     2
+#define SUBINT_RXD1     3
+#define SUBINT_TXD1     4
+#define SUBINT_ERR1     5
+#define SUBINT_RXD2     6
+#define SUBINT_TXD2     7
+#define SUBINT_ERR2     8
+#define SUBINT_TC       9
+#define SUBINT_ADC_S    10
+#define SUBINT_CAM_C    11
+#define SUBINT_CAM_P    12
+#define SUBINT_WDT      13
+#define SUBINT_AC97     14
+
+#define SUBINT_MAX_NR   15
+
+typedef struct int_action {
+    struct int_action *next;
+    int_handle_t handler;
+    void *data;
+} int_action_t;
+
+#define DECLARE_INT_ACTION(name, func, _data) \
+    int_action_t name = {NULL, func, _data}
+
+/*
+ * Several handlers chained on one line, each called with its own data.
+ * The line must not also be owned through register_irq().
+ */
+void register_shared_irq(int irq, int_action_t *action);
+
+/*
+ * Chain a handler on a SUBSRCPND source; the handler gets the subirq
+ * number. The parent line is demultiplexed by the kernel, drivers only
+ * enable the subirq and its parent irq.
+ */
+void register_subirq(int subirq, int_action_t *action);
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Run the handler in its own task instead of in the isr. The hard isr
+ * only masks and acknowledges the irq and wakes the task, which calls
+ * the handler at 'priority' and unmasks the irq again. 'task' must be
+ * declared with TASK_STRUCT.
+ */
+void register_threaded_irq(int irq, int_handle_t handler, void *data,
+    void *task, uint8_t priority);
+
+/*
+ * 0 is the highest priority, all sources start at the lowest one. While
+ * an isr runs, sources of equal or lower priority stay masked and the
+ * higher ones may preempt it.
+ */
+void set_irq_priority(int irq, uint8_t priority);
+
+/*
+ * Route one source to fiq. The handler runs in fiq mode on its own
+ * stack, outside the kernel, and must not call any kernel service.
+ */
+typedef void (*fiq_handle_t)(void *);
+void register_fiq(int irq, fiq_handle_t handler, void *data);
+
 #endif // _MINIOS_S3C2440_INTERRUPT_H_
 // EOF s3c2440_interrupt.h
@@ -12,5 +12,9 @@
 #define READ_REG(addr)  *(volatile uint32_t *)(addr)
 #define WRITE_REG(addr, val) *(volatile uint32_t *)(addr) = (val)
 
+/* byte wide registers, e.g. the uart fifos */
+#define READ_REG8(addr)  *(volatile uint8_t *)(addr)
+#define WRITE_REG8(addr, val) *(volatile uint8_t *)(addr) = (val)
+
 #endif // _MINIOS_S3C2440_IO_H_
 // EOF s3c2440_io.h
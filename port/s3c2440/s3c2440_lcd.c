@@ -0,0 +1,127 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/s3c2440/s3c2440_io.h"
+#include "port/s3c2440/s3c2440_regs.h"
+#include "port/s3c2440/s3c2440_lcd.h"
+#include "os/boottime.h"
+#include "os/init.h"
+
+/* VCLK = HCLK / ((CLKVAL + 1) * 2), 10MHz off a 100MHz HCLK */
+#ifndef LCD_CLKVAL
+#define LCD_CLKVAL          4
+#endif
+
+/* porch and sync widths, each one less than the count as the registers take */
+#ifndef LCD_VBPD
+#define LCD_VBPD            1
+#endif
+#ifndef LCD_VFPD
+#define LCD_VFPD            5
+#endif
+#ifndef LCD_VSPW
+#define LCD_VSPW            1
+#endif
+#ifndef LCD_HBPD
+#define LCD_HBPD            36
+#endif
+#ifndef LCD_HFPD
+#define LCD_HFPD            19
+#endif
+#ifndef LCD_HSPW
+#define LCD_HSPW            5
+#endif
+
+/* a power of two at least the frame, so no frame crosses a 4MB bank */
+#ifndef LCD_FRAME_ALIGN
+#define LCD_FRAME_ALIGN     0x40000
+#endif
+
+#define LCD_FRAME_PIXELS    (S3C2440_LCD_WIDTH * S3C2440_LCD_HEIGHT)
+
+/* LCDCON1 */
+#define LCDCON1_CLKVAL(v)   ((v) << 8)
+#define LCDCON1_TFT         (3 << 5)
+#define LCDCON1_BPP16       (12 << 1)
+#define LCDCON1_ENVID       (1 << 0)
+
+/* LCDCON5 */
+#define LCDCON5_FRM565      (1 << 11)
+#define LCDCON5_INVVLINE    (1 << 9)    /* hsync active low */
+#define LCDCON5_INVVFRAME   (1 << 8)    /* vsync active low */
+#define LCDCON5_PWREN       (1 << 3)
+#define LCDCON5_HWSWP       (1 << 0)
+
+/*
+ * The controller shows the upper halfword of a word first. Big endian
+ * that is already the pixel at the lower address, little endian the
+ * halves have to be swapped.
+ */
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LCDCON5_ORDER       0
+#else
+#define LCDCON5_ORDER       LCDCON5_HWSWP
+#endif
+
+static fb_pixel_t lcd_front[LCD_FRAME_PIXELS]
+    __attribute__((aligned(LCD_FRAME_ALIGN))) NOINIT_SECTION;
+static fb_pixel_t lcd_back[LCD_FRAME_PIXELS]
+    __attribute__((aligned(32))) NOINIT_SECTION;
+
+fb_t s3c2440_lcd;
+
+/*--------------------------------------------------------------------------*/
+
+static void s3c2440_lcd_set_base(fb_pixel_t *frame)
+{
+    uint32_t start = (uint32_t)(address_t)frame;
+    uint32_t end = start + LCD_FRAME_PIXELS * sizeof(fb_pixel_t);
+
+    // bank and start in halfwords, the end within the same bank
+    WRITE_REG(LCDSADDR1, ((start >> 22) << 21) | ((start >> 1) & 0x1fffff));
+    WRITE_REG(LCDSADDR2, (end >> 1) & 0x1fffff);
+    WRITE_REG(LCDSADDR3, S3C2440_LCD_WIDTH);
+}
+
+/* level 4, the screen is there for whatever starts with the devices */
+static bool_t s3c2440_lcd_init(void)
+{
+    // VD0-VD23 and the control lines, GPG4 as LCD_PWREN
+    WRITE_REG(GPCUP, 0xffffffff);
+    WRITE_REG(GPCCON, 0xaaaaaaaa);
+    WRITE_REG(GPDUP, 0xffffffff);
+    WRITE_REG(GPDCON, 0xaaaaaaaa);
+    WRITE_REG(GPGCON, READ_REG(GPGCON) | (3 << 8));
+
+    WRITE_REG(LCDCON1, LCDCON1_CLKVAL(LCD_CLKVAL) | LCDCON1_TFT
+        | LCDCON1_BPP16);
+    WRITE_REG(LCDCON2, (LCD_VBPD << 24) | ((S3C2440_LCD_HEIGHT - 1) << 14)
+        | (LCD_VFPD << 6) | LCD_VSPW);
+    WRITE_REG(LCDCON3, (LCD_HBPD << 19) | ((S3C2440_LCD_WIDTH - 1) << 8)
+        | LCD_HFPD);
+    WRITE_REG(LCDCON4, LCD_HSPW);
+    WRITE_REG(LCDCON5, LCDCON5_FRM565 | LCDCON5_INVVLINE | LCDCON5_INVVFRAME
+        | LCDCON5_PWREN | LCDCON5_ORDER);
+
+    // no lpc3600 timing controller, no frame interrupts, no palette
+    WRITE_REG(TCONSEL, READ_REG(TCONSEL) & ~7);
+    WRITE_REG(LCDINTMSK, 3);
+    WRITE_REG(TPAL, 0);
+
+    fb_init(&s3c2440_lcd, lcd_front, lcd_back, S3C2440_LCD_WIDTH,
+        S3C2440_LCD_HEIGHT, S3C2440_LCD_WIDTH);
+    s3c2440_lcd_set_base(lcd_front);
+
+    WRITE_REG(LCDCON1, READ_REG(LCDCON1) | LCDCON1_ENVID);
+
+    boot_time_mark("lcd");
+    return TRUE;
+}
+
+DECLARE_INITCALL(s3c2440_lcd_init, 4);
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_lcd.c
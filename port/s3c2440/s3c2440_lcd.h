@@ -0,0 +1,27 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _MINIOS_S3C2440_LCD_H_
+#define _MINIOS_S3C2440_LCD_H_
+
+#include "os/fb.h"
+
+/* the panel, a 3.5" 240x320 tft by default */
+#ifndef S3C2440_LCD_WIDTH
+#define S3C2440_LCD_WIDTH   240
+#endif
+#ifndef S3C2440_LCD_HEIGHT
+#define S3C2440_LCD_HEIGHT  320
+#endif
+
+/*
+ * The screen in 16 bit 5:6:5, front and back buffer in sdram. Set up by
+ * an initcall at level 4, blank until the first fb_update().
+ */
+extern fb_t s3c2440_lcd;
+
+#endif // _MINIOS_S3C2440_LCD_H_
+// EOF s3c2440_lcd.h
@@ -0,0 +1,35 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/arm7_9/mmu.h"
+#include "port/arm7_9/cpu_const.h"
+
+/*
+ * Flat map, virtual equals physical. Memory is cached write-back, the
+ * static banks and special registers keep the uncached access they had
+ * with the mmu off. Anything else faults. The sram comes last, booting
+ * from nand its section overrides the start of bank 0.
+ */
+static const mmu_region_t s3c2440_memory_map[] = {
+    {0x00000000, 0x00000000, 0x30000000, MMU_MEM_DEVICE},     /* bank 0-5 */
+    {0x30000000, 0x30000000, 0x04000000, MMU_MEM_WRITE_BACK}, /* sdram */
+    {0x48000000, 0x48000000, 0x13000000, MMU_MEM_DEVICE},     /* sfr */
+    {SRAM_BASE, SRAM_BASE, 0x00100000, MMU_MEM_WRITE_BACK},   /* sram */
+};
+
+static uint32_t mmu_table[MMU_TABLE_ENTRIES]
+    __attribute__((aligned(MMU_TABLE_SIZE))) NOINIT_SECTION;
+
+/* called by head.S before .bss is cleared, it must not touch globals */
+void platform_mmu_init(void)
+{
+    mmu_build_table(mmu_table, s3c2440_memory_map,
+        sizeof(s3c2440_memory_map) / sizeof(s3c2440_memory_map[0]));
+    arm920_mmu_enable(mmu_table);
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_mmu.c
@@ -0,0 +1,148 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/s3c2440/s3c2440_io.h"
+#include "port/s3c2440/s3c2440_regs.h"
+#include "port/s3c2440/s3c2440_nand.h"
+#include "os/boottime.h"
+#include "os/init.h"
+
+/* strobe timings in HCLK cycles, for 100MHz and a 12ns / 12ns / 5ns part */
+#ifndef NAND_TACLS
+#define NAND_TACLS          1
+#endif
+#ifndef NAND_TWRPH0
+#define NAND_TWRPH0         2
+#endif
+#ifndef NAND_TWRPH1
+#define NAND_TWRPH1         1
+#endif
+
+#define NFCONF_TIMING       \
+    (NAND_TACLS << 12 | NAND_TWRPH0 << 8 | NAND_TWRPH1 << 4)
+
+/* NFCONT */
+#define NFCONT_SPARE_LOCK   (1 << 6)
+#define NFCONT_MAIN_LOCK    (1 << 5)
+#define NFCONT_INIT_ECC     (1 << 4)
+#define NFCONT_NCE          (1 << 1)    /* high deselects the chip */
+#define NFCONT_MODE         (1 << 0)
+
+/* NFSTAT */
+#define NFSTAT_RNB_EDGE     (1 << 2)    /* busy went ready, write 1 clears */
+#define NFSTAT_RNB          (1 << 0)
+
+/*--------------------------------------------------------------------------*/
+
+static void s3c2440_nand_select(nfc_t *nfc, bool_t on)
+{
+    uint32_t v = READ_REG(NFCONT);
+
+    WRITE_REG(NFCONT, on ? (v & ~NFCONT_NCE) : (v | NFCONT_NCE));
+}
+
+/*
+ * Every command waited on makes the chip busy for a while, but maybe
+ * not before the first poll. So the edge is cleared here and awaited.
+ */
+static void s3c2440_nand_cmd(nfc_t *nfc, uint8_t cmd)
+{
+    WRITE_REG(NFSTAT, NFSTAT_RNB_EDGE);
+    WRITE_REG8(NFCMD, cmd);
+}
+
+static void s3c2440_nand_addr(nfc_t *nfc, uint8_t addr)
+{
+    WRITE_REG8(NFADDR, addr);
+}
+
+/* a word access moves 4 bytes, in memory order for either endianness */
+static void s3c2440_nand_read_buf(nfc_t *nfc, void *buf, uint32_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+
+    if (0 == ((address_t)p & 3)) {
+        for (; len >= 4; len -= 4, p += 4)
+            *(uint32_t *)p = READ_REG(NFDATA);
+    }
+    while (len--)
+        *p++ = READ_REG8(NFDATA);
+}
+
+static void s3c2440_nand_write_buf(nfc_t *nfc, const void *buf,
+    uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+
+    if (0 == ((address_t)p & 3)) {
+        for (; len >= 4; len -= 4, p += 4)
+            WRITE_REG(NFDATA, *(const uint32_t *)p);
+    }
+    while (len--)
+        WRITE_REG8(NFDATA, *p++);
+}
+
+static bool_t s3c2440_nand_wait_ready(nfc_t *nfc, uint32_t polls)
+{
+    while (polls--) {
+        if (READ_REG(NFSTAT) & NFSTAT_RNB_EDGE)
+            return (READ_REG(NFSTAT) & NFSTAT_RNB) ? TRUE : FALSE;
+    }
+    return FALSE;
+}
+
+/* the main area generator, over what goes through NFDATA until locked */
+static void s3c2440_nand_ecc_start(nfc_t *nfc)
+{
+    uint32_t v = READ_REG(NFCONT);
+
+    WRITE_REG(NFCONT, (v & ~NFCONT_MAIN_LOCK) | NFCONT_INIT_ECC);
+}
+
+static void s3c2440_nand_ecc_get(nfc_t *nfc, uint8_t *code)
+{
+    uint32_t v;
+
+    WRITE_REG(NFCONT, READ_REG(NFCONT) | NFCONT_MAIN_LOCK);
+    v = READ_REG(NFMECC0);
+    code[0] = v & 0xff;
+    code[1] = (v >> 8) & 0xff;
+    code[2] = (v >> 16) & 0xff;
+}
+
+static const nfc_ops_t s3c2440_nand_ops = {
+    .select = s3c2440_nand_select,
+    .cmd = s3c2440_nand_cmd,
+    .addr = s3c2440_nand_addr,
+    .read_buf = s3c2440_nand_read_buf,
+    .write_buf = s3c2440_nand_write_buf,
+    .wait_ready = s3c2440_nand_wait_ready,
+    .ecc_start = s3c2440_nand_ecc_start,
+    .ecc_get = s3c2440_nand_ecc_get,
+};
+
+DECLARE_NFC(s3c2440_nand, &s3c2440_nand_ops, NULL);
+
+/*--------------------------------------------------------------------------*/
+
+/* level 3, ready before the devices and the file systems on top */
+static bool_t s3c2440_nand_init(void)
+{
+    WRITE_REG(NFCONF, NFCONF_TIMING);
+    WRITE_REG(NFCONT, NFCONT_SPARE_LOCK | NFCONT_MAIN_LOCK | NFCONT_NCE
+        | NFCONT_MODE);
+
+    if (NAND_OK != nfc_attach(&s3c2440_nand))
+        return FALSE;
+
+    boot_time_mark("nand");
+    return TRUE;
+}
+
+DECLARE_INITCALL(s3c2440_nand_init, 3);
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_nand.c
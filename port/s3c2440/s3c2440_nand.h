@@ -0,0 +1,20 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _MINIOS_S3C2440_NAND_H_
+#define _MINIOS_S3C2440_NAND_H_
+
+#include "os/nfc.h"
+
+/*
+ * The flash we boot from, on the controller's hardware ecc. Attached by
+ * an initcall at level 3, s3c2440_nand.nand is what file systems and
+ * loaders use after that.
+ */
+extern nfc_t s3c2440_nand;
+
+#endif // _MINIOS_S3C2440_NAND_H_
+// EOF s3c2440_nand.h
@@ -177,5 +177,32 @@
 #define SUBSRCPND  (INTERRUPT_BASE + 0x18)
 #define INTSUBMASK (INTERRUPT_BASE + 0x1c)
 
+#define DMA_BASE   0x4B000000
+#define DMA_PORT(ch, x) (DMA_BASE + (ch) * 0x40 + (x))
+#define oDISRC     0x00
+#define oDISRCC    0x04
+#define oDIDST     0x08
+#define oDIDSTC    0x0c
+#define oDCON      0x10
+#define oDSTAT     0x14
+#define oDCSRC     0x18
+#define oDCDST     0x1c
+#define oDMASKTRIG 0x20
+
+#define LCD_BASE   0x4D000000
+#define LCDCON1    (LCD_BASE + 0x00)
+#define LCDCON2    (LCD_BASE + 0x04)
+#define LCDCON3    (LCD_BASE + 0x08)
+#define LCDCON4    (LCD_BASE + 0x0c)
+#define LCDCON5    (LCD_BASE + 0x10)
+#define LCDSADDR1  (LCD_BASE + 0x14)
+#define LCDSADDR2  (LCD_BASE + 0x18)
+#define LCDSADDR3  (LCD_BASE + 0x1c)
+#define TPAL       (LCD_BASE + 0x50)
+#define LCDINTPND  (LCD_BASE + 0x54)
+#define LCDSRCPND  (LCD_BASE + 0x58)
+#define LCDINTMSK  (LCD_BASE + 0x5c)
+#define TCONSEL    (LCD_BASE + 0x60)
+
 #endif // _MINIOS_S3C2440_REG_H_
 // EOF s3c2440_regs.h
@@ -0,0 +1,332 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#include "port/s3c2440/s3c2440_io.h"
+#include "port/s3c2440/s3c2440_regs.h"
+#include "port/s3c2440/s3c2440_interrupt.h"
+#include "port/s3c2440/s3c2440_uart.h"
+#include "os/task.h"
+#include "os/hsr.h"
+#include "os/spinlock.h"
+#include "os/string.h"
+#include "port/port.h"
+
+#ifndef S3C2440_PCLK
+#define S3C2440_PCLK        50000000
+#endif
+
+#define UART0_IRQ           28
+#define UART_FIFO_SIZE      64
+
+#define ULCON_8N1           0x03
+/* rx/tx interrupt mode, rx error and timeout interrupts, level triggered */
+#define UCON_IRQ_MODE       0x3c5
+/* fifos on and reset, rx interrupt at 8 bytes, tx at 16 or less */
+#define UFCON_FIFO          0x57
+
+#define UFSTAT_RX_COUNT(s)  ((s) & 0x3f)
+#define UFSTAT_RX_FULL      (1 << 6)
+#define UFSTAT_TX_COUNT(s)  (((s) >> 8) & 0x3f)
+#define UFSTAT_TX_FULL      (1 << 14)
+
+/*
+ * One producer side and one consumer side, the isr owns one of them.
+ * The task side takes its indexes with interrupts masked, so several
+ * tasks and hsrs may share it. 'lock' covers 'waiters' and 'waiting'
+ * between the sleepers and the wakeup hsr, which may run on another cpu.
+ */
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    spinlock_t lock;
+    list_head_t waiters;
+    volatile uint32_t waiting;
+    uint32_t dropped;
+} uart_ring_t;
+
+typedef struct {
+    list_head_t node;
+    task_t *task;
+} uart_waiter_t;
+
+static uint8_t uart0_tx_buf[UART_TX_RING_SIZE];
+static uint8_t uart0_rx_buf[UART_RX_RING_SIZE];
+
+static uart_ring_t uart0_tx = {
+    uart0_tx_buf, UART_TX_RING_SIZE - 1, 0, 0, SPINLOCK_INIT,
+    LIST_HEAD_INIT(uart0_tx.waiters), 0, 0
+};
+
+static uart_ring_t uart0_rx = {
+    uart0_rx_buf, UART_RX_RING_SIZE - 1, 0, 0, SPINLOCK_INIT,
+    LIST_HEAD_INIT(uart0_rx.waiters), 0, 0
+};
+
+static uint32_t uart0_errors;
+
+static inline uint32_t ring_used(uart_ring_t *r)
+{
+    return r->head - r->tail;
+}
+
+static inline uint32_t ring_free(uart_ring_t *r)
+{
+    return r->mask + 1 - (r->head - r->tail);
+}
+
+/* 'n' bytes in or out at free running index 'idx', in two runs at most */
+static void ring_copy_in(uart_ring_t *r, uint32_t idx, const uint8_t *p,
+    uint32_t n)
+{
+    uint32_t off = idx & r->mask;
+    uint32_t first = r->mask + 1 - off;
+
+    if (first > n)
+        first = n;
+    memcpy(r->buf + off, p, first);
+    memcpy(r->buf, p + first, n - first);
+}
+
+static void ring_copy_out(uart_ring_t *r, uint32_t idx, uint8_t *p,
+    uint32_t n)
+{
+    uint32_t off = idx & r->mask;
+    uint32_t first = r->mask + 1 - off;
+
+    if (first > n)
+        first = n;
+    memcpy(p, r->buf + off, first);
+    memcpy(p + first, r->buf, n - first);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void uart_wakeup(void *data)
+{
+    uart_ring_t *r = (uart_ring_t *)data;
+    uart_waiter_t *w, *nxt;
+    cpu_flags_t flags;
+
+    flags = spin_lock_irqsave(&r->lock);
+    r->waiting = 0;
+    LIST_FOR_EACH_ENTRY_SAFE(w, nxt, &r->waiters, node) {
+        LIST_DEL(&w->node);
+        task_resume(w->task, 0);
+    }
+    spin_unlock_irqrestore(&r->lock, flags);
+}
+
+static DECLARE_HSR(uart0_tx_hsr, 0, uart_wakeup, "uart0_tx_hsr");
+static DECLARE_HSR(uart0_rx_hsr, 0, uart_wakeup, "uart0_rx_hsr");
+
+/*
+ * task_lock and r->lock held, back with both held once the hsr woke us.
+ * The caller sets 'waiting' and looks at the ring once more before it
+ * gets here, so the isr cannot miss it, and the hsr cannot walk the
+ * list before we are on it.
+ */
+static void uart_wait(uart_ring_t *r)
+{
+    uart_waiter_t w;
+
+    w.task = current;
+    LIST_ADD_TAIL(&r->waiters, &w.node);
+    task_suspend(current, 0, NULL, NULL);
+    spin_unlock(&r->lock);
+
+    task_unlock();
+    task_lock();
+
+    spin_lock(&r->lock);
+    if (LIST_INLIST(&w.node))
+        LIST_DEL(&w.node);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* interrupts masked, top the fifo up from the ring */
+static void uart0_tx_fill(void)
+{
+    uart_ring_t *r = &uart0_tx;
+    uint32_t stat = READ_REG(UFSTAT0);
+    uint32_t room, tail = r->tail;
+
+    // the count reads 0 when full
+    if (stat & UFSTAT_TX_FULL)
+        return;
+
+    room = UART_FIFO_SIZE - UFSTAT_TX_COUNT(stat);
+    while (room-- && (tail != r->head))
+        WRITE_REG8(UTXHB0, r->buf[tail++ & r->mask]);
+    r->tail = tail;
+}
+
+static void uart0_tx_isr(int subirq, void *data)
+{
+    uart_ring_t *r = &uart0_tx;
+
+    uart0_tx_fill();
+
+    // level triggered, it fires again as long as the fifo runs low
+    if (r->tail == r->head)
+        s3c2440_disable_subirq(SUBINT_TXD0);
+
+    // wake writers once there is room for a fair amount
+    if (r->waiting && (ring_free(r) >= (r->mask + 1) / 2))
+        activiate_hsr(&uart0_tx_hsr, r);
+}
+
+static void uart0_rx_isr(int subirq, void *data)
+{
+    uart_ring_t *r = &uart0_rx;
+    uint32_t stat, n, head = r->head;
+
+    stat = READ_REG(UFSTAT0);
+    n = (stat & UFSTAT_RX_FULL) ? UART_FIFO_SIZE : UFSTAT_RX_COUNT(stat);
+
+    while (n--) {
+        uint8_t ch = READ_REG8(URXHB0);
+        if (head - r->tail <= r->mask)
+            r->buf[head++ & r->mask] = ch;
+        else
+            ++r->dropped;
+    }
+    r->head = head;
+
+    if (r->waiting && (r->head != r->tail))
+        activiate_hsr(&uart0_rx_hsr, r);
+}
+
+static void uart0_err_isr(int subirq, void *data)
+{
+    // reading clears it
+    if (READ_REG(UERSTAT0) & 0xf)
+        ++uart0_errors;
+}
+
+static DECLARE_INT_ACTION(uart0_tx_action, uart0_tx_isr, NULL);
+static DECLARE_INT_ACTION(uart0_rx_action, uart0_rx_isr, NULL);
+static DECLARE_INT_ACTION(uart0_err_action, uart0_err_isr, NULL);
+
+void uart0_init(uint32_t baud)
+{
+    /* drain what the boot loader left in the fifo */
+    while (UFSTAT_TX_COUNT(READ_REG(UFSTAT0)) ||
+           (READ_REG(UFSTAT0) & UFSTAT_TX_FULL));
+
+    WRITE_REG(ULCON0, ULCON_8N1);
+    WRITE_REG(UMCON0, 0);
+    WRITE_REG(UFCON0, UFCON_FIFO);
+    WRITE_REG(UBRDIV0, (S3C2440_PCLK + baud * 8) / (baud * 16) - 1);
+    WRITE_REG(UCON0, UCON_IRQ_MODE);
+
+    register_subirq(SUBINT_TXD0, &uart0_tx_action);
+    register_subirq(SUBINT_RXD0, &uart0_rx_action);
+    register_subirq(SUBINT_ERR0, &uart0_err_action);
+
+    // tx stays masked until there is something to send
+    s3c2440_disable_subirq(SUBINT_TXD0);
+    s3c2440_enable_subirq(SUBINT_RXD0);
+    s3c2440_enable_subirq(SUBINT_ERR0);
+    s3c2440_enable_irq(UART0_IRQ);
+}
+
+/*--------------------------------------------------------------------------*/
+
+uint32_t uart0_write_nb(const void *buf, uint32_t len)
+{
+    uart_ring_t *r = &uart0_tx;
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+    uint32_t n = ring_free(r);
+
+    if (len > n)
+        len = n;
+
+    ring_copy_in(r, r->head, (const uint8_t *)buf, len);
+    r->head += len;
+
+    if (0 != len) {
+        uart0_tx_fill();
+        s3c2440_enable_subirq(SUBINT_TXD0);
+    }
+
+    HAL_IRQ_RESTORE(flags);
+    return len;
+}
+
+void uart0_write(const void *buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t n;
+
+    task_lock();
+    spin_lock(&uart0_tx.lock);
+    while (1) {
+        n = uart0_write_nb(p, len);
+        p += n;
+        len -= n;
+        if (0 == len)
+            break;
+        // arm the wakeup, then look at the ring once more before sleeping
+        if (uart0_tx.waiting)
+            uart_wait(&uart0_tx);
+        else
+            uart0_tx.waiting = 1;
+    }
+    spin_unlock(&uart0_tx.lock);
+    task_unlock();
+}
+
+void uart0_puts(const char *s)
+{
+    const char *e = s;
+
+    while (*e)
+        ++e;
+    uart0_write(s, e - s);
+}
+
+uint32_t uart0_read_nb(void *buf, uint32_t len)
+{
+    uart_ring_t *r = &uart0_rx;
+    cpu_flags_t flags = HAL_IRQ_SAVE();
+    uint32_t n = ring_used(r);
+
+    if (len > n)
+        len = n;
+
+    ring_copy_out(r, r->tail, (uint8_t *)buf, len);
+    r->tail += len;
+
+    HAL_IRQ_RESTORE(flags);
+    return len;
+}
+
+uint32_t uart0_read(void *buf, uint32_t len)
+{
+    uint32_t n;
+
+    if (0 == len)
+        return 0;
+
+    task_lock();
+    spin_lock(&uart0_rx.lock);
+    while (0 == (n = uart0_read_nb(buf, len))) {
+        if (uart0_rx.waiting)
+            uart_wait(&uart0_rx);
+        else
+            uart0_rx.waiting = 1;
+    }
+    spin_unlock(&uart0_rx.lock);
+    task_unlock();
+
+    return n;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF s3c2440_uart.c
@@ -0,0 +1,41 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+#ifndef _MINIOS_S3C2440_UART_H_
+#define _MINIOS_S3C2440_UART_H_
+
+#include "os/minios_type.h"
+
+/* ring sizes, powers of 2 */
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE 1024
+#endif
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE 256
+#endif
+
+/*
+ * UART0 fed by the fifo threshold interrupts. Writers copy into the tx
+ * ring and return, the isr moves it to the fifo; readers take what the
+ * rx isr stored. Call uart0_init() before the scheduler starts.
+ */
+void uart0_init(uint32_t baud);
+
+/* task context, sleeps only while the tx ring is full */
+void uart0_write(const void *buf, uint32_t len);
+void uart0_puts(const char *s);
+
+/* any context, returns the bytes queued, the rest is dropped */
+uint32_t uart0_write_nb(const void *buf, uint32_t len);
+
+/* task context, sleeps until at least one byte arrived */
+uint32_t uart0_read(void *buf, uint32_t len);
+
+/* any context, 0 if nothing arrived */
+uint32_t uart0_read_nb(void *buf, uint32_t len);
+
+#endif // _MINIOS_S3C2440_UART_H_
+// EOF s3c2440_uart.h
@@ -0,0 +1,58 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MINIOS_TEST_H_
+#define _MINIOS_TEST_H_
+
+/*
+ * The host tests, run by ./compile.sh test. Each is one file built with
+ * the kernel headers instead of the host ones, so what it uses of the c
+ * library is declared here.
+ */
+
+#include "os/minios_type.h"
+
+int printf(const char *fmt, ...);
+void exit(int code);
+
+static uint32_t test_checks;
+static uint32_t test_failures;
+
+/* past this many one bug is failing everything after it */
+#define TEST_FAILURES_MAX   20
+
+/* a failed check is reported with 'fmt' and counted, the test goes on */
+#define CHECKF(cond, fmt, ...) do {                                         \
+    ++test_checks;                                                          \
+    if (!(cond)) {                                                          \
+        printf("%s:%d: %s: " fmt "\n", __FILE__, __LINE__, #cond,           \
+            ##__VA_ARGS__);                                                 \
+        if (++test_failures >= TEST_FAILURES_MAX)                           \
+            exit(1);                                                        \
+    }                                                                       \
+} while (0)
+
+#define CHECK(cond) CHECKF(cond, "failed")
+
+/* the summary line, and the exit code */
+static inline int test_report(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
+
+/* a small lcg, the same sequence on every host */
+static uint32_t test_seed = 1;
+
+static inline uint32_t test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return test_seed >> 8;
+}
+
+#endif // _MINIOS_TEST_H_
+// EOF test.h
@@ -0,0 +1,285 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The buffer cache on a ram disk, as the app of a hosted kernel: lru
+ * reuse, read-ahead, write-back by bsync() and by the flush timer, and
+ * tasks on both cpus waiting for buffers and for each other's io.
+ */
+
+#include "test/test.h"
+#include "os/ramdisk.h"
+#include "os/init.h"
+#include "os/string.h"
+
+#define DISK_BLOCKS     128
+#define HELPER_NR       2
+#define HELPER_ROUNDS   3000
+#define HELPER_STACK    65536
+
+DECLARE_RAMDISK(ram0, DISK_BLOCKS);
+
+static blkdev_t bdev;
+
+static task_t helpers[HELPER_NR];
+static uint32_t helper_stacks[HELPER_NR][HELPER_STACK / sizeof(uint32_t)];
+static volatile uint32_t helpers_done;
+
+/* what each block should hold, its first word is written by one helper */
+static uint32_t shadow[DISK_BLOCKS];
+
+/* what test_lru() fills the disk with */
+static uint8_t fill_byte(uint32_t block)
+{
+    return (uint8_t)(block * 7 + 1);
+}
+
+static uint8_t disk_byte(uint32_t block)
+{
+    return ram0_mem[block * BLOCK_SIZE];
+}
+
+static void reset_stats(void)
+{
+    bdev.hits = 0;
+    bdev.misses = 0;
+    bdev.read_aheads = 0;
+}
+
+/* bread() and the byte every block was filled with */
+static void check_read(uint32_t block, uint8_t want)
+{
+    buf_t *b = bread(&bdev, block);
+
+    CHECKF(NULL != b, "block %u", block);
+    if (NULL == b)
+        return;
+    CHECKF((b->data[0] == want) && (b->data[BLOCK_SIZE - 1] == want),
+        "block %u holds %02x, not %02x", block, b->data[0], want);
+    brelse(b);
+}
+
+static void helper_start(int i, task_entry_t entry)
+{
+    task_create(helpers + i, "helper", 10, 0, (address_t)helper_stacks[i],
+        HELPER_STACK, entry, (void *)(address_t)i);
+}
+
+static void helpers_wait(uint32_t nr)
+{
+    for (int i = 0; (helpers_done < nr) && (i < 3000); i++)
+        task_sleep(1);
+    CHECKF(helpers_done == nr, "%u of %u helpers done", helpers_done, nr);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* the cache starts out empty, the blocks are read out of order */
+static void test_lru(void)
+{
+    uint32_t a[BLOCK_CACHE_NR];
+
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++)
+        memset(ram0_mem + i * BLOCK_SIZE, fill_byte(i), BLOCK_SIZE);
+    for (uint32_t i = 0; i < BLOCK_CACHE_NR; i++)
+        a[i] = 3 * i + 1;
+
+    reset_stats();
+    for (uint32_t i = 0; i < BLOCK_CACHE_NR; i++)
+        check_read(a[i], fill_byte(a[i]));
+    CHECK(0 == bdev.hits);
+    CHECK(BLOCK_CACHE_NR == bdev.misses);
+
+    // the last one is young again, a new block takes the oldest; each
+    // hit makes the one after it the oldest
+    check_read(a[BLOCK_CACHE_NR - 1], fill_byte(a[BLOCK_CACHE_NR - 1]));
+    check_read(100, fill_byte(100));
+    check_read(a[1], fill_byte(a[1]));
+    check_read(a[0], fill_byte(a[0]));
+    check_read(a[3], fill_byte(a[3]));
+    check_read(a[2], fill_byte(a[2]));
+
+    CHECKF(3 == bdev.hits, "hits %u", bdev.hits);
+    CHECKF(BLOCK_CACHE_NR + 3 == bdev.misses, "misses %u", bdev.misses);
+    CHECK(0 == bdev.read_aheads);
+}
+
+static void test_write_back(void)
+{
+    buf_t *b;
+
+    // more blocks than buffers, dirty ones are written back to make room
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++) {
+        b = bget(&bdev, i);
+        CHECK(NULL != b);
+        memset(b->data, 0x80 ^ i, BLOCK_SIZE);
+        bdirty(b);
+        brelse(b);
+    }
+    CHECK(DEV_OK == bsync(&bdev));
+    CHECK(0 == bdev.write_errors);
+
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++) {
+        CHECKF(0 == memcmp(ram0_mem + i * BLOCK_SIZE, ram0_mem + i * BLOCK_SIZE
+            + 1, BLOCK_SIZE - 1) && (disk_byte(i) == (uint8_t)(0x80 ^ i)),
+            "block %u on the disk", i);
+    }
+
+    // nothing but the flush timer writes this one
+    b = bread(&bdev, 5);
+    b->data[0] = 0x5a;
+    bdirty(b);
+    brelse(b);
+    task_sleep(2 * BLOCK_FLUSH_TICKS + 10);
+    CHECKF(0x5a == disk_byte(5), "block 5 holds %02x", disk_byte(5));
+    memset(ram0_mem + 5 * BLOCK_SIZE, 0x80 ^ 5, BLOCK_SIZE);
+    b = bread(&bdev, 5);
+    b->data[0] = 0x80 ^ 5;
+    brelse(b);
+}
+
+static void test_read_ahead(void)
+{
+    uint32_t k;
+
+    // a sequential reader finds nearly everything read ahead
+    reset_stats();
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++)
+        check_read(i, 0x80 ^ i);
+    CHECKF(bdev.read_aheads >= DISK_BLOCKS / 2, "read ahead %u",
+        bdev.read_aheads);
+    CHECKF(bdev.misses <= DISK_BLOCKS / 8, "misses %u, read ahead %u",
+        bdev.misses, bdev.read_aheads);
+
+    // and a random one nothing
+    reset_stats();
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++) {
+        k = (i * 37) % DISK_BLOCKS;
+        check_read(k, 0x80 ^ k);
+    }
+    CHECKF(0 == bdev.read_aheads, "read ahead %u", bdev.read_aheads);
+
+    CHECK(NULL == bread(&bdev, DISK_BLOCKS));
+    CHECK(NULL == bget(&bdev, DISK_BLOCKS));
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void waiter_entry(void *para)
+{
+    check_read(DISK_BLOCKS - 1, 0x80 ^ (DISK_BLOCKS - 1));
+    HAL_ATOMIC_ADD(&helpers_done, 1);
+}
+
+/* with every buffer held a reader sleeps until one is given back */
+static void test_wait_buffer(void)
+{
+    buf_t *held[BLOCK_CACHE_NR];
+
+    // out of order, nothing is read ahead into the last free buffers
+    for (uint32_t i = 0; i < BLOCK_CACHE_NR; i++) {
+        held[i] = bread(&bdev, (i * 5) % DISK_BLOCKS);
+        CHECK(NULL != held[i]);
+    }
+
+    helpers_done = 0;
+    helper_start(0, waiter_entry);
+    task_sleep(20);
+    CHECKF(0 == helpers_done, "a reader got a buffer while all were held");
+
+    for (uint32_t i = 0; i < BLOCK_CACHE_NR; i++)
+        brelse(held[i]);
+    helpers_wait(1);
+}
+
+/*
+ * Both helpers read and write all over the disk, each owning the first
+ * word of every other block. Hung wakeups leave a helper asleep.
+ */
+static void stress_entry(void *para)
+{
+    uint32_t me = (uint32_t)(address_t)para;
+    uint32_t seed = 12345 + me;
+    uint32_t k, v;
+    buf_t *b;
+
+    for (int round = 0; round < HELPER_ROUNDS; round++) {
+        seed = seed * 1103515245 + 12345;
+        k = (seed >> 8) % DISK_BLOCKS;
+
+        b = bread(&bdev, k);
+        CHECKF(NULL != b, "block %u", k);
+        if (NULL == b)
+            continue;
+        memcpy(&v, b->data, sizeof(v));
+        if ((k % HELPER_NR) == me) {
+            CHECKF(v == shadow[k], "block %u holds %08x, not %08x", k, v,
+                shadow[k]);
+            v = shadow[k] = (k << 16) + round;
+            memcpy(b->data, &v, sizeof(v));
+            bdirty(b);
+        }
+        brelse(b);
+
+        // a sequential run now and then, read-ahead in the mix
+        if (0 == (round & 63)) {
+            for (uint32_t i = 1; i < 8; i++)
+                brelse(bread(&bdev, (k + i) % DISK_BLOCKS));
+        }
+    }
+
+    HAL_ATOMIC_ADD(&helpers_done, 1);
+}
+
+static void test_stress(void)
+{
+    buf_t *b;
+    uint32_t v;
+
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++) {
+        b = bread(&bdev, i);
+        memcpy(&shadow[i], b->data, sizeof(shadow[i]));
+        brelse(b);
+    }
+
+    helpers_done = 0;
+    for (int i = 0; i < HELPER_NR; i++)
+        helper_start(i, stress_entry);
+    helpers_wait(HELPER_NR);
+
+    CHECK(DEV_OK == bsync(&bdev));
+    for (uint32_t i = 0; i < DISK_BLOCKS; i++) {
+        memcpy(&v, ram0_mem + i * BLOCK_SIZE, sizeof(v));
+        CHECKF(v == shadow[i], "block %u on the disk", i);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_block(void)
+{
+    CHECK(blkdev_open(&bdev, "ram0", DISK_BLOCKS));
+
+    test_lru();
+    test_write_back();
+    test_read_ahead();
+    test_wait_buffer();
+    test_stress();
+
+    hosted_exit(test_report("block"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_block, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_block.c
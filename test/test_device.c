@@ -0,0 +1,230 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The request queue of os/device.c on a device taking one request at a
+ * time, as the app of a hosted kernel. The test plays the hardware: it
+ * sees what start() was given and completes it when it likes. Queued
+ * requests go out most urgent first, adjacent ones are merged and finish
+ * with the one they rode on, before it and with its status.
+ */
+
+#include "test/test.h"
+#include "os/device.h"
+#include "os/init.h"
+
+#define REQ_NR          8
+#define MERGE_MAX       12
+#define HELPER_STACK    65536
+
+static bool_t test_merge(device_t *dev, dev_request_t *into,
+    dev_request_t *req);
+static void test_start(device_t *dev, dev_request_t *req);
+
+static const dev_ops_t test_ops = {
+    .start = test_start,
+    .merge = test_merge,
+};
+
+DECLARE_DEVICE(test_dev, &test_ops, NULL, 1);
+
+/* what the hardware was handed, in order */
+static dev_request_t *started[REQ_NR * 2];
+static volatile uint32_t started_nr;
+
+/* the order the callbacks ran in */
+static uint32_t finished[REQ_NR * 2];
+static volatile uint32_t finished_nr;
+
+static dev_request_t reqs[REQ_NR];
+static dev_request_t blocker;
+
+static void test_start(device_t *dev, dev_request_t *req)
+{
+    started[started_nr++] = req;
+}
+
+/* one behind the other, up to MERGE_MAX in all */
+static bool_t test_merge(device_t *dev, dev_request_t *into,
+    dev_request_t *req)
+{
+    if ((into->pos + into->len != req->pos) ||
+        (into->len + req->len > MERGE_MAX))
+        return FALSE;
+
+    into->len += req->len;
+    return TRUE;
+}
+
+static void test_callback(dev_request_t *req, void *data)
+{
+    finished[finished_nr++] = (uint32_t)(address_t)data;
+}
+
+static void submit(uint32_t i, uint8_t op, uint8_t priority, uint32_t pos,
+    uint32_t len)
+{
+    dev_request_init(&reqs[i], op, priority, test_callback,
+        (void *)(address_t)i);
+    CHECKF(dev_submit(&test_dev, &reqs[i], pos, NULL, len), "submit %u", i);
+}
+
+/* the hardware finishes what it has on now, the next one goes on */
+static void complete(dev_request_t *req, status_t status)
+{
+    CHECK(started[started_nr - 1] == req);
+    dev_complete(req, status);
+    CHECKF(status == dev_wait(req), "status %d", req->status);
+}
+
+/* the device busy with a request of its own, so the others queue */
+static void block(void)
+{
+    started_nr = 0;
+    finished_nr = 0;
+    dev_request_init(&blocker, DEV_CONTROL, 0, NULL, NULL);
+    CHECK(dev_submit(&test_dev, &blocker, 1000, NULL, 1));
+    CHECK(1 == started_nr);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* most urgent first, in submit order within a priority */
+static void test_priority(void)
+{
+    static const uint8_t prio[] = {3, 1, 2, 0, 1, 3, 0};
+    static const uint32_t want[] = {3, 6, 1, 4, 2, 0, 5};
+    uint32_t n = sizeof(prio);
+
+    block();
+    for (uint32_t i = 0; i < n; i++)
+        submit(i, DEV_READ, prio[i], i * 100, 1);
+    CHECKF(n == test_dev.queued, "%u queued", test_dev.queued);
+    CHECKF(0xf == test_dev.queue_map, "map %x", test_dev.queue_map);
+
+    // one at a time, each completion puts on the next
+    complete(&blocker, DEV_OK);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECKF(started[i + 1] == &reqs[want[i]], "%uth out is %d", i,
+            (int)(started[i + 1] - reqs));
+        complete(&reqs[want[i]], DEV_OK);
+        CHECKF(finished[i] == want[i], "%uth done is %u", i, finished[i]);
+    }
+    CHECK(0 == test_dev.queue_map);
+    CHECK(0 == test_dev.queued);
+    CHECK(0 == test_dev.active);
+}
+
+/*
+ * Only the same op at the same priority merges, and only while queued.
+ * The merged ones finish first, with the status of the one they rode on.
+ */
+static void test_merged(void)
+{
+    uint32_t merges = test_dev.merges;
+
+    block();
+    submit(0, DEV_READ, 1, 0, 4);
+    submit(1, DEV_READ, 1, 4, 4);       // into 0
+    submit(2, DEV_READ, 1, 8, 4);       // into 0, which is full now
+    submit(3, DEV_READ, 1, 12, 4);
+    submit(4, DEV_WRITE, 1, 16, 4);     // another op
+    submit(5, DEV_READ, 2, 16, 4);      // another priority
+    submit(6, DEV_READ, 1, 16, 4);      // into 3
+    CHECKF(3 == test_dev.merges - merges, "%u merges",
+        test_dev.merges - merges);
+    CHECK(4 == test_dev.queued);
+    CHECK(12 == reqs[0].len);
+    CHECK(8 == reqs[3].len);
+
+    // on the hardware it takes no more
+    complete(&blocker, DEV_OK);
+    CHECK(started[1] == &reqs[0]);
+    submit(7, DEV_READ, 1, 12, 4);
+    CHECK(12 == reqs[0].len);
+    CHECK(4 == test_dev.queued);
+    CHECK(DEV_PENDING == reqs[1].status);
+
+    complete(&reqs[0], DEV_ERROR);
+    CHECK(3 == finished_nr);
+    CHECK((1 == finished[0]) && (2 == finished[1]) && (0 == finished[2]));
+    CHECK(DEV_ERROR == reqs[1].status);
+    CHECK(DEV_ERROR == reqs[2].status);
+    CHECK(reqs[1].done && reqs[2].done);
+
+    // 3 with 6 on it, then 4, 7 and 5
+    CHECK(started[2] == &reqs[3]);
+    complete(&reqs[3], DEV_OK);
+    CHECK((6 == finished[3]) && (3 == finished[4]));
+    CHECK(DEV_OK == reqs[6].status);
+    complete(&reqs[4], DEV_OK);
+    complete(&reqs[7], DEV_OK);
+    complete(&reqs[5], DEV_OK);
+    CHECK(8 == finished_nr);
+    CHECK(0 == test_dev.active);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static task_t waiter;
+static uint32_t waiter_stack[HELPER_STACK / sizeof(uint32_t)];
+static volatile status_t waited;
+static volatile uint32_t waiter_done;
+
+static void waiter_entry(void *para)
+{
+    waited = dev_wait((dev_request_t *)para);
+    waiter_done = 1;
+}
+
+/* a task asleep on a merged request wakes with the carrier's status */
+static void test_wait_merged(void)
+{
+    block();
+    submit(0, DEV_READ, 0, 0, 4);
+    submit(1, DEV_READ, 0, 4, 4);
+    CHECK(1 == test_dev.queued);
+
+    waiter_done = 0;
+    task_create(&waiter, "waiter", 10, 0, (address_t)waiter_stack,
+        HELPER_STACK, waiter_entry, &reqs[1]);
+    for (int i = 0; (NULL == reqs[1].waiter) && (i < 300); i++)
+        task_sleep(1);
+    CHECK(!waiter_done);
+
+    complete(&blocker, DEV_OK);
+    complete(&reqs[0], DEV_ERROR);
+    for (int i = 0; !waiter_done && (i < 300); i++)
+        task_sleep(1);
+    CHECK(waiter_done);
+    CHECK(DEV_ERROR == waited);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_device(void)
+{
+    CHECK(&test_dev == device_find("test_dev"));
+    CHECK(NULL == device_find("no_dev"));
+
+    test_priority();
+    test_merged();
+    test_wait_merged();
+
+    hosted_exit(test_report("device"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_device, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_device.c
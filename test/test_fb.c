@@ -0,0 +1,234 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The c versions of the os/fb.c kernels against a pixel by pixel model,
+ * for every alignment of both sides, then the dirty rectangles against a
+ * model of the screen. The assembly of the arm7_9 port is not run here.
+ */
+
+#include "test/test.h"
+
+#define memcpy  k_memcpy
+#define memmove k_memmove
+#define memset  k_memset
+#define memcmp  k_memcmp
+#define strlen  k_strlen
+#define strcmp  k_strcmp
+#include "os/string.c"
+#include "os/fb.c"
+#undef memcpy
+#undef memmove
+#undef memset
+#undef memcmp
+#undef strlen
+#undef strcmp
+
+#define SPAN_MAX        80
+#define SPAN_GUARD      8
+#define SPAN_BUF        (2 * SPAN_GUARD + SPAN_MAX + 4)
+#define SCREEN_W        240
+#define SCREEN_H        320
+#define IMAGE_W         100
+
+static fb_pixel_t span[SPAN_BUF];
+static fb_pixel_t span_src[SPAN_BUF];
+static fb_pixel_t span_want[SPAN_BUF];
+
+static fb_pixel_t front[SCREEN_W * SCREEN_H];
+static fb_pixel_t back[SCREEN_W * SCREEN_H];
+static fb_pixel_t model[SCREEN_W * SCREEN_H];
+static fb_pixel_t image[IMAGE_W * IMAGE_W];
+static fb_t fb;
+
+/* each channel on its own, as fb_blend_pixel() must come out */
+static fb_pixel_t ref_blend(fb_pixel_t d, fb_pixel_t s, uint32_t alpha)
+{
+    uint32_t a = (MIN(alpha, 255) * 32 + 127) / 255;
+    uint32_t r = ((s >> 11) * a + (d >> 11) * (32 - a)) >> 5;
+    uint32_t g = (((s >> 5) & 63) * a + ((d >> 5) & 63) * (32 - a)) >> 5;
+    uint32_t b = ((s & 31) * a + (d & 31) * (32 - a)) >> 5;
+
+    return (fb_pixel_t)((r << 11) | (g << 5) | b);
+}
+
+static void fill_random(fb_pixel_t *p, uint32_t n)
+{
+    while (n--)
+        *p++ = (fb_pixel_t)test_rand();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* the whole buffer is compared, nothing outside the span may change */
+static void test_span(uint32_t n, uint32_t da, uint32_t sa, uint32_t alpha)
+{
+    fb_pixel_t *dst = span + SPAN_GUARD + da;
+    fb_pixel_t *src = span_src + SPAN_GUARD + sa;
+    fb_pixel_t *want = span_want + SPAN_GUARD + da;
+    fb_pixel_t color = (fb_pixel_t)test_rand();
+
+    fill_random(span, SPAN_BUF);
+    fill_random(span_src, SPAN_BUF);
+
+    k_memcpy(span_want, span, sizeof(span));
+    fb_fill_span(dst, color, n);
+    for (uint32_t i = 0; i < n; i++)
+        want[i] = color;
+    CHECKF(0 == k_memcmp(span, span_want, sizeof(span)),
+        "fill n %u dst %u", n, da);
+
+    fb_copy_span(dst, src, n);
+    k_memcpy(want, src, n * sizeof(fb_pixel_t));
+    CHECKF(0 == k_memcmp(span, span_want, sizeof(span)),
+        "copy n %u dst %u src %u", n, da, sa);
+
+    fill_random(span, SPAN_BUF);
+    k_memcpy(span_want, span, sizeof(span));
+    fb_blend_span(dst, src, n, alpha);
+    for (uint32_t i = 0; i < n; i++)
+        want[i] = ref_blend(want[i], src[i], alpha);
+    CHECKF(0 == k_memcmp(span, span_want, sizeof(span)),
+        "blend n %u dst %u src %u alpha %u", n, da, sa, alpha);
+}
+
+/* every channel value at the ends and in between */
+static void test_blend_values(void)
+{
+    fb_pixel_t d, s;
+
+    for (uint32_t dv = 0; dv < 65536; dv += 7) {
+        for (uint32_t sv = 0; sv < 65536; sv += 4099) {
+            for (uint32_t alpha = 0; alpha <= 255; alpha += 17) {
+                d = (fb_pixel_t)dv;
+                s = (fb_pixel_t)sv;
+                fb_blend_span(&d, &s, 1, alpha);
+                CHECKF(d == ref_blend(dv, sv, alpha), "blend %04x %04x %u",
+                    dv, sv, alpha);
+            }
+        }
+    }
+
+    d = 0x1234;
+    s = 0xfedc;
+    fb_blend_span(&d, &s, 1, FB_ALPHA_OPAQUE);
+    CHECK(0xfedc == d);
+    fb_blend_span(&d, &s, 1, 1000);
+    CHECK(0xfedc == d);
+    d = 0x1234;
+    fb_blend_span(&d, &s, 1, 0);
+    CHECK(0x1234 == d);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void check_screen(const char *when, int round)
+{
+    CHECKF(0 == k_memcmp(back, model, sizeof(back)), "%s %d: back", when,
+        round);
+    CHECKF(0 == k_memcmp(front, model, sizeof(front)), "%s %d: front", when,
+        round);
+}
+
+/*
+ * Fills, blits, blends and marked drawing straight into 'back', partly
+ * off the screen. After each update the front buffer is the model.
+ */
+static void test_screen(void)
+{
+    uint32_t full = SCREEN_W * SCREEN_H;
+    uint32_t updates = 0, alpha;
+    int32_t x, y, w, h, px, py;
+    fb_pixel_t color, *m;
+    int op;
+
+    fb_init(&fb, front, back, SCREEN_W, SCREEN_H, SCREEN_W);
+    k_memset(model, 0, sizeof(model));
+    fill_random(image, IMAGE_W * IMAGE_W);
+    check_screen("init", 0);
+
+    for (int round = 0; round < 3000; round++) {
+        op = test_rand() % 4;
+        x = (int32_t)(test_rand() % (SCREEN_W + 60)) - 30;
+        y = (int32_t)(test_rand() % (SCREEN_H + 60)) - 30;
+        w = test_rand() % IMAGE_W;
+        h = test_rand() % IMAGE_W;
+        alpha = test_rand() % 256;
+        color = (fb_pixel_t)test_rand();
+        if (0 == test_rand() % 8) {
+            w = test_rand() % 8;
+            h = test_rand() % 8;
+        }
+        if (3 == op)
+            h = MIN(h, 5);
+
+        for (int32_t yy = 0; yy < h; yy++) {
+            for (int32_t xx = 0; xx < w; xx++) {
+                px = x + xx;
+                py = y + yy;
+                if ((px < 0) || (py < 0) || (px >= SCREEN_W)
+                    || (py >= SCREEN_H))
+                    continue;
+                m = &model[py * SCREEN_W + px];
+                if ((0 == op) || (3 == op))
+                    *m = color;
+                else if (1 == op)
+                    *m = image[yy * IMAGE_W + xx];
+                else
+                    *m = ref_blend(*m, image[yy * IMAGE_W + xx], alpha);
+                if (3 == op)
+                    back[py * SCREEN_W + px] = color;
+            }
+        }
+
+        if (0 == op)
+            fb_fill(&fb, x, y, w, h, color);
+        else if (1 == op)
+            fb_blit(&fb, x, y, image, IMAGE_W, w, h);
+        else if (2 == op)
+            fb_blend(&fb, x, y, image, IMAGE_W, w, h, alpha);
+        else
+            fb_mark(&fb, x, y, w, h);
+        CHECKF(fb.nr_dirty <= FB_DIRTY_MAX, "round %d: %u rectangles", round,
+            fb.nr_dirty);
+
+        if (0 == test_rand() % 4) {
+            fb_update(&fb);
+            ++updates;
+            check_screen("update", round);
+        }
+    }
+
+    fb_update(&fb);
+    ++updates;
+    check_screen("final", 0);
+    CHECK(0 == fb.nr_dirty);
+    CHECKF(updates == fb.updates, "%u updates", fb.updates);
+
+    // small rectangles push a fraction of what redrawing it all would
+    CHECKF(fb.pushed < updates * full / 2, "pushed %u of %u", fb.pushed,
+        updates * full);
+}
+
+/*--------------------------------------------------------------------------*/
+
+int main(void)
+{
+    for (uint32_t n = 0; n <= SPAN_MAX; n++) {
+        for (uint32_t da = 0; da < 4; da++) {
+            for (uint32_t sa = 0; sa < 4; sa++)
+                test_span(n, da, sa, test_rand() % 300);
+        }
+    }
+    test_blend_values();
+    test_screen();
+
+    return test_report("fb");
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_fb.c
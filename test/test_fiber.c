@@ -0,0 +1,235 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Fibers on one scheduler task, as the app of a hosted kernel: yields go
+ * round in spawn order, sleepers wake in deadline order and not before,
+ * and events signalled from tasks on both cpus each wake their fiber. The
+ * scheduler sleeps between nearly every event, a wakeup lost on the way
+ * strands the fiber and the signalling task times out.
+ */
+
+#include "test/test.h"
+#include "os/fiber.h"
+#include "os/init.h"
+
+#define SCHED_STACK     65536
+#define HELPER_NR       2
+#define HELPER_STACK    65536
+#define YIELDERS        5
+#define YIELDS          20
+#define SLEEPERS        8
+#define ROUNDS          2000
+#define WAIT_SPINS      1000
+#define WAIT_TICKS      300
+
+extern volatile uint32_t jiffies;
+
+TASK_STRUCT(sched_task, SCHED_STACK);
+static fiber_sched_t fs;
+
+/* each fiber's state, locals do not survive a wait */
+typedef struct {
+    fiber_t f;
+    uint32_t id;
+    uint32_t i;
+    uint32_t ticks;
+} test_fiber_t;
+
+static test_fiber_t spawner;
+static test_fiber_t fibers[SLEEPERS];
+
+static uint32_t trace[YIELDERS * YIELDS];
+static volatile uint32_t trace_len;
+
+/* 'v' has reached 'want', FALSE once it is stranded */
+static bool_t wait_for(volatile uint32_t *v, uint32_t want)
+{
+    for (int spin = 0; (*v != want) && (spin < WAIT_SPINS); spin++)
+        task_yield();
+    for (int tick = 0; (*v != want) && (tick < WAIT_TICKS); tick++)
+        task_sleep(1);
+    return (*v == want) ? TRUE : FALSE;
+}
+
+/*--------------------------------------------------------------------------*/
+
+static int yield_func(fiber_t *f)
+{
+    test_fiber_t *t = (test_fiber_t *)f->data;
+
+    FIBER_BEGIN(f);
+    for (t->i = 0; t->i < YIELDS; t->i++) {
+        trace[trace_len++] = t->id;
+        FIBER_YIELD(f);
+    }
+    FIBER_END(f);
+}
+
+/* all in one run, so the scheduler sees every one before it picks any */
+static int spawn_yielders(fiber_t *f)
+{
+    for (uint32_t i = 0; i < YIELDERS; i++) {
+        fibers[i].id = i;
+        fiber_spawn(&fs, &fibers[i].f, yield_func, &fibers[i]);
+    }
+    return FIBER_EXITED;
+}
+
+static void test_yield(void)
+{
+    trace_len = 0;
+    fiber_spawn(&fs, &spawner.f, spawn_yielders, &spawner);
+    CHECK(wait_for(&trace_len, YIELDERS * YIELDS));
+
+    for (uint32_t i = 0; i < trace_len; i++)
+        CHECKF(trace[i] == i % YIELDERS, "step %u ran %u", i, trace[i]);
+    for (uint32_t i = 0; (0 != fs.nr) && (i < WAIT_TICKS); i++)
+        task_sleep(1);
+    CHECKF(0 == fs.nr, "%u fibers left", fs.nr);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static uint32_t woke[SLEEPERS];
+static volatile uint32_t woke_nr;
+
+static int sleep_func(fiber_t *f)
+{
+    test_fiber_t *t = (test_fiber_t *)f->data;
+
+    FIBER_BEGIN(f);
+    FIBER_SLEEP(f, t->ticks);
+    CHECKF(!time_before(jiffies, f->wakeup), "sleeper %u early", t->id);
+    woke[woke_nr++] = t->id;
+    FIBER_END(f);
+}
+
+static int spawn_sleepers(fiber_t *f)
+{
+    for (uint32_t i = 0; i < SLEEPERS; i++) {
+        fibers[i].id = i;
+        fibers[i].ticks = 1 + (i * 5) % SLEEPERS;
+        fiber_spawn(&fs, &fibers[i].f, sleep_func, &fibers[i]);
+    }
+    return FIBER_EXITED;
+}
+
+static void test_sleep(void)
+{
+    woke_nr = 0;
+    fiber_spawn(&fs, &spawner.f, spawn_sleepers, &spawner);
+    CHECKF(wait_for(&woke_nr, SLEEPERS), "%u of %u woke", woke_nr,
+        SLEEPERS);
+
+    // all went to sleep in one round, the shorter sleeps end first
+    for (uint32_t i = 1; i < woke_nr; i++) {
+        CHECKF(fibers[woke[i - 1]].ticks <= fibers[woke[i]].ticks,
+            "sleeper %u woke before %u", woke[i - 1], woke[i]);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+static fiber_event_t events[HELPER_NR];
+static volatile uint32_t pongs[HELPER_NR];
+static volatile uint32_t helpers_done;
+static task_t helpers[HELPER_NR];
+static uint32_t helper_stacks[HELPER_NR][HELPER_STACK / sizeof(uint32_t)];
+
+static int pong_func(fiber_t *f)
+{
+    test_fiber_t *t = (test_fiber_t *)f->data;
+
+    FIBER_BEGIN(f);
+    for (t->i = 0; t->i < ROUNDS; t->i++) {
+        FIBER_AWAIT_EVENT(f, &events[t->id]);
+        ++pongs[t->id];
+    }
+    FIBER_END(f);
+}
+
+/* one signal per round, the next only once the fiber has taken it */
+static void helper_entry(void *para)
+{
+    uint32_t i = (uint32_t)(address_t)para;
+
+    for (uint32_t round = 1; round <= ROUNDS; round++) {
+        fiber_event_signal(&events[i]);
+        if (!wait_for(&pongs[i], round)) {
+            CHECKF(0, "helper %u round %u stranded", i, round);
+            break;
+        }
+    }
+
+    HAL_ATOMIC_ADD(&helpers_done, 1);
+}
+
+static void test_events(void)
+{
+    helpers_done = 0;
+    for (uint32_t i = 0; i < HELPER_NR; i++) {
+        INIT_FIBER_EVENT(&events[i]);
+        pongs[i] = 0;
+        fibers[i].id = i;
+        fiber_spawn(&fs, &fibers[i].f, pong_func, &fibers[i]);
+        task_create(helpers + i, "helper", 10, 0,
+            (address_t)helper_stacks[i], HELPER_STACK, helper_entry,
+            (void *)(address_t)i);
+    }
+    for (int i = 0; (helpers_done < HELPER_NR) && (i < 60000); i++)
+        task_sleep(1);
+    CHECKF(HELPER_NR == helpers_done, "%u of %u helpers done", helpers_done,
+        HELPER_NR);
+}
+
+/* with no one waiting a signal is kept, but only one */
+static void test_pending(void)
+{
+    fiber_event_t *ev = &events[0];
+
+    INIT_FIBER_EVENT(ev);
+    pongs[0] = 0;
+    fiber_event_signal(ev);
+    fiber_event_signal(ev);
+    CHECK(1 == ev->pending);
+
+    fibers[0].id = 0;
+    fiber_spawn(&fs, &fibers[0].f, pong_func, &fibers[0]);
+    CHECK(wait_for(&pongs[0], 1));
+    for (int i = 0; i < 10; i++)
+        task_sleep(1);
+    CHECK(1 == pongs[0]);
+
+    fiber_event_signal(ev);
+    CHECK(wait_for(&pongs[0], 2));
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_fiber(void)
+{
+    fiber_sched_create(&fs, "fibers", 8, &sched_task);
+
+    test_yield();
+    test_sleep();
+    test_events();
+    test_pending();
+
+    hosted_exit(test_report("fiber"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_fiber, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_fiber.c
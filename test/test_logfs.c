@@ -0,0 +1,380 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The log file system on a nandsim, as the app of a hosted kernel. Every
+ * file has a copy here that it is compared against after random writes,
+ * truncates and removes, after remounts, power cuts and failing programs
+ * and erases, with the gc task running on the other cpu.
+ */
+
+#include "test/test.h"
+#include "os/logfs.h"
+#include "os/nandsim.h"
+#include "os/init.h"
+#include "os/string.h"
+
+#define PAGE            512
+#define PAGES_PER_BLOCK 16
+#define BLOCKS          32
+#define FILE_NR         6
+#define FILE_MAX        (LOGFS_FILE_CHUNKS * PAGE / 2)
+#define CUT_ROUNDS      300
+#define FAULT_ROUNDS    200
+
+DECLARE_NANDSIM(sim, PAGE, 32, PAGES_PER_BLOCK, BLOCKS);
+
+static logfs_t fs;
+
+/* what each file should hold, ino < 0 while it does not exist */
+typedef struct {
+    char name[8];
+    int32_t ino;
+    uint32_t size;
+    uint8_t data[FILE_MAX];
+} shadow_t;
+
+static shadow_t shadow[FILE_NR];
+static shadow_t before;
+static uint8_t buf[FILE_MAX];
+
+/* writes stay within one page, a power cut tears at most one of them */
+static bool_t single_page;
+
+static bool_t check_file(shadow_t *s)
+{
+    int32_t ino = logfs_open(&fs, s->name, FALSE);
+    int32_t size, n;
+
+    if (ino < 0)
+        return (s->ino < 0) ? TRUE : FALSE;
+    if (s->ino < 0)
+        return FALSE;
+
+    size = logfs_size(&fs, ino);
+    if ((uint32_t)size != s->size)
+        return FALSE;
+
+    memset(buf, 0xee, sizeof(buf));
+    n = logfs_read(&fs, ino, 0, buf, sizeof(buf));
+    if (0 == size)
+        return (0 == n) ? TRUE : FALSE;
+    return ((n == size) && (0 == memcmp(buf, s->data, size))) ? TRUE : FALSE;
+}
+
+static void check_all(const char *what)
+{
+    for (int i = 0; i < FILE_NR; i++)
+        CHECKF(check_file(&shadow[i]), "%s: %s", what, shadow[i].name);
+}
+
+/* the ino of a file may change over a remount */
+static void reopen_all(void)
+{
+    for (int i = 0; i < FILE_NR; i++) {
+        if (shadow[i].ino >= 0)
+            shadow[i].ino = logfs_open(&fs, shadow[i].name, FALSE);
+    }
+}
+
+static void remount(void)
+{
+    logfs_unmount(&fs);
+    CHECK(LOGFS_OK == logfs_mount(&fs, &sim.nand, 0, BLOCKS));
+    reopen_all();
+}
+
+/*--------------------------------------------------------------------------*/
+
+static status_t op_write(shadow_t *s)
+{
+    static uint8_t data[3 * PAGE];      /* the init task has a small stack */
+    uint32_t pos, len;
+    int32_t n;
+
+    pos = (0 == test_rand() % 3) ? s->size : test_rand() % (FILE_MAX + 1);
+    len = 1 + test_rand() % sizeof(data);
+    len = MIN(len, FILE_MAX - pos);
+    if (single_page)
+        len = MIN(len, PAGE - pos % PAGE);
+    if (0 == len)
+        return LOGFS_OK;
+
+    for (uint32_t i = 0; i < len; i++)
+        data[i] = (uint8_t)test_rand();
+    n = logfs_write(&fs, s->ino, pos, data, len);
+    if ((n < 0) && !sim.dead)
+        return n;
+    if (sim.dead)
+        n = len;
+
+    if (pos > s->size)
+        memset(s->data + s->size, 0, pos - s->size);
+    memcpy(s->data + pos, data, n);
+    s->size = MAX(s->size, pos + n);
+    return ((uint32_t)n == len) ? LOGFS_OK : LOGFS_ERR_IO;
+}
+
+static status_t op_truncate(shadow_t *s)
+{
+    uint32_t size = test_rand() % (s->size + PAGE);
+    status_t st;
+
+    size = MIN(size, FILE_MAX);
+    st = logfs_truncate(&fs, s->ino, size);
+    if ((LOGFS_OK != st) && !sim.dead)
+        return st;
+
+    if (size > s->size)
+        memset(s->data + s->size, 0, size - s->size);
+    s->size = size;
+    return st;
+}
+
+/*
+ * One random operation on file 'i'. The copy follows what succeeded, and
+ * what a power cut stopped as if it had.
+ */
+static status_t op(int i)
+{
+    shadow_t *s = &shadow[i];
+    uint32_t k = test_rand() % 10;
+    status_t st;
+
+    if (s->ino < 0) {
+        st = logfs_open(&fs, s->name, TRUE);
+        if ((st < 0) && !sim.dead)
+            return st;
+        s->ino = MAX(st, 0);
+        s->size = 0;
+        return MIN(st, LOGFS_OK);
+    }
+
+    if (k < 7)
+        return op_write(s);
+    if (k < 9)
+        return op_truncate(s);
+
+    st = logfs_remove(&fs, s->name);
+    if ((LOGFS_OK == st) || sim.dead) {
+        s->ino = -1;
+        s->size = 0;
+    }
+    return st;
+}
+
+/* the gc task may still have the last one queued */
+static void format(void)
+{
+    if (fs.mounted)
+        logfs_unmount(&fs);
+    nandsim_init(&sim);
+    sim.bad[7] = 1;
+    CHECK(LOGFS_OK == logfs_format(&fs, &sim.nand, 0, BLOCKS));
+    CHECKF(BLOCKS - 1 == fs.free_blocks, "free %u", fs.free_blocks);
+
+    for (int i = 0; i < FILE_NR; i++) {
+        shadow[i].name[0] = 'f';
+        shadow[i].name[1] = '0' + i;
+        shadow[i].ino = -1;
+        shadow[i].size = 0;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Chunks cut off by a truncate must stay cut off after the gc moved the
+ * header that did it. Chunks 0 and 1 of "a" are cut and "a" grows past
+ * them again, by a write or by another truncate; "keep" fills the rest
+ * of the block of the old chunks and holds it while the header, in the
+ * next block, is moved and its block erased.
+ */
+static void test_hole(bool_t grow)
+{
+    int32_t a, keep, filler;
+    uint32_t stale, hdr, hdr_erases, stale_erases, size = 3 * PAGE;
+    bool_t moved = FALSE;
+
+    format();
+    a = logfs_open(&fs, "a", TRUE);
+    keep = logfs_open(&fs, "keep", TRUE);
+    filler = logfs_open(&fs, "filler", TRUE);
+
+    memset(buf, 0xab, sizeof(buf));
+    CHECK(2 * PAGE == logfs_write(&fs, a, 0, buf, 2 * PAGE));
+    CHECK(11 * PAGE == logfs_write(&fs, keep, 0, buf, 11 * PAGE));
+    stale = fs.files[a].map[1];
+
+    CHECK(LOGFS_OK == logfs_truncate(&fs, a, 0));
+    hdr = fs.files[a].hdr / PAGES_PER_BLOCK;
+    hdr_erases = sim.erases[hdr];
+    stale_erases = sim.erases[stale / PAGES_PER_BLOCK];
+    memset(buf, 0x11, PAGE);
+    if (grow)
+        CHECK(LOGFS_OK == logfs_truncate(&fs, a, size));
+    else
+        CHECK(PAGE == logfs_write(&fs, a, 2 * PAGE, buf, PAGE));
+
+    // the block of the header fills up, the gc takes the emptiest first
+    for (int i = 0; i < 2 * PAGES_PER_BLOCK; i++)
+        CHECK(PAGE == logfs_write(&fs, filler, 0, buf, PAGE));
+    while (!moved && logfs_gc(&fs))
+        moved = (sim.erases[hdr] != hdr_erases) ? TRUE : FALSE;
+    CHECKF(moved, "the header of a was not moved");
+    CHECKF(sim.erases[stale / PAGES_PER_BLOCK] == stale_erases,
+        "the old chunks were erased too");
+
+    logfs_unmount(&fs);
+    CHECK(LOGFS_OK == logfs_mount(&fs, &sim.nand, 0, BLOCKS));
+    a = logfs_open(&fs, "a", FALSE);
+    CHECKF(size == (uint32_t)logfs_size(&fs, a), "size %d", logfs_size(&fs, a));
+
+    memset(buf, 0xee, size);
+    CHECK(size == (uint32_t)logfs_read(&fs, a, 0, buf, size));
+    for (uint32_t i = 0; i < size; i++) {
+        if (buf[i] != ((grow || (i < 2 * PAGE)) ? 0 : 0x11)) {
+            CHECKF(FALSE, "%s: byte %u of a is %02x", grow ? "grow" : "write",
+                i, buf[i]);
+            break;
+        }
+    }
+}
+
+static void test_random(void)
+{
+    status_t st;
+
+    format();
+    for (int i = 0; i < 4000; i++) {
+        if (0 == i % 50)
+            task_sleep(1);
+        st = op(test_rand() % FILE_NR);
+        CHECKF(LOGFS_OK == st, "op %d: %d", i, st);
+        if (LOGFS_OK != st)
+            break;
+    }
+    check_all("random");
+
+    remount();
+    check_all("random remount");
+    CHECK(0 == fs.lost);
+}
+
+/*
+ * The power goes after a few programs or erases, of the operation or of
+ * the gc it starts. The other files must be as they were and the one
+ * being changed either as before or as after.
+ */
+static void test_power_cut(void)
+{
+    uint32_t cuts = 0;
+    int i, j;
+    status_t st;
+
+    single_page = TRUE;
+    for (int round = 0; round < CUT_ROUNDS; round++) {
+        i = test_rand() % FILE_NR;
+        memcpy(&before, &shadow[i], sizeof(before));
+
+        sim.cut_after = 1 + test_rand() % 4;
+        st = op(i);
+        if (!sim.dead) {
+            sim.cut_after = 0;
+            CHECKF(LOGFS_OK == st, "round %d: %d", round, st);
+            continue;
+        }
+
+        ++cuts;
+        nandsim_power_on(&sim);
+        remount();
+        for (j = 0; j < FILE_NR; j++) {
+            if (j != i)
+                CHECKF(check_file(&shadow[j]), "round %d: %s changed",
+                    round, shadow[j].name);
+        }
+        if (!check_file(&shadow[i])) {
+            memcpy(&shadow[i], &before, sizeof(before));
+            CHECKF(check_file(&shadow[i]),
+                "round %d: %s neither old nor new", round, shadow[i].name);
+        }
+
+        // a file created by the torn operation or removed by it
+        shadow[i].ino = logfs_open(&fs, shadow[i].name, FALSE);
+        if (shadow[i].ino < 0)
+            shadow[i].size = 0;
+    }
+    single_page = FALSE;
+
+    CHECKF(cuts > CUT_ROUNDS / 4, "only %u cuts", cuts);
+    remount();
+    check_all("power cut");
+}
+
+/* programs and erases failing now and then, blocks go bad */
+static void test_faults(void)
+{
+    uint32_t bad = 0;
+    status_t st;
+
+    for (int round = 0; round < FAULT_ROUNDS; round++) {
+        if (0 == round % 20)
+            sim.fail_program = 1 + test_rand() % 5;
+        if (7 == round % 50)
+            sim.fail_erase = 1 + test_rand() % 3;
+        st = op(test_rand() % FILE_NR);
+        CHECKF(LOGFS_OK == st, "round %d: %d", round, st);
+        if (LOGFS_OK != st)
+            break;
+    }
+    check_all("faults");
+
+    remount();
+    check_all("faults remount");
+    for (int blk = 0; blk < BLOCKS; blk++)
+        bad += sim.bad[blk];
+    CHECKF(bad > 1, "%u bad blocks", bad);
+}
+
+/* the writers only start the gc, the task does the collecting */
+static void test_background_gc(void)
+{
+    uint32_t runs = fs.gc_runs;
+
+    for (int i = 0; i < 400; i++)
+        op(test_rand() % FILE_NR);
+    task_sleep(5);
+
+    CHECKF(fs.gc_runs > runs, "gc runs %u", fs.gc_runs - runs);
+    CHECKF(fs.free_blocks >= LOGFS_GC_LOW, "free %u", fs.free_blocks);
+    check_all("background gc");
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_logfs(void)
+{
+    test_hole(FALSE);
+    test_hole(TRUE);
+    test_random();
+    test_power_cut();
+    test_faults();
+    test_background_gc();
+
+    hosted_exit(test_report("logfs"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_logfs, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_logfs.c
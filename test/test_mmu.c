@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The section table builder of arm7_9, and the s3c2440 map it is given,
+ * against descriptors worked out here address by address.
+ */
+
+#include "test/test.h"
+#include "port/arm7_9/mmu.c"
+#include "port/s3c2440/s3c2440_mmu.c"
+
+static uint32_t *enabled_table;
+
+/* cp15 is not there on the host, the table handed over is kept */
+void arm920_mmu_enable(uint32_t *table)
+{
+    enabled_table = table;
+}
+
+/* the last region covering 'va' decides, none means a fault */
+static uint32_t expected_desc(const mmu_region_t *regions, uint32_t nr,
+    uint32_t index)
+{
+    uint32_t va = index << MMU_SECTION_SHIFT;
+    uint32_t desc = 0;
+
+    for (uint32_t i = 0; i < nr; i++) {
+        if ((va >= regions[i].va) && (va - regions[i].va < regions[i].size))
+            desc = (regions[i].pa + (va - regions[i].va)) | (3 << 10)
+                | regions[i].attr | 0x12;
+    }
+    return desc;
+}
+
+static void check_table(const uint32_t *table, const mmu_region_t *regions,
+    uint32_t nr)
+{
+    uint32_t want;
+
+    for (uint32_t i = 0; i < MMU_TABLE_ENTRIES; i++) {
+        want = expected_desc(regions, nr, i);
+        CHECKF(table[i] == want, "section %03x is %08x, not %08x", i,
+            table[i], want);
+    }
+}
+
+static uint32_t table[MMU_TABLE_ENTRIES];
+
+static void test_regions(void)
+{
+    static const mmu_region_t remap[] = {
+        {0x00000000, 0x00000000, 0x00400000, MMU_MEM_DEVICE},
+        {0xc0000000, 0x30000000, 0x00200000, MMU_MEM_WRITE_THRU},
+        {0x00100000, 0x30100000, 0x00100000, MMU_MEM_WRITE_BACK},
+        {0xfff00000, 0x00000000, 0x00100000, MMU_MEM_WRITE_BACK},
+    };
+
+    // stale entries must not survive a rebuild
+    for (uint32_t i = 0; i < MMU_TABLE_ENTRIES; i++)
+        table[i] = 0xdeadbeef;
+
+    mmu_build_table(table, remap, sizeof(remap) / sizeof(remap[0]));
+    check_table(table, remap, sizeof(remap) / sizeof(remap[0]));
+
+    // a few written out in full
+    CHECK(table[0x000] == 0x00000c12);
+    CHECK(table[0x001] == 0x30100c1e);          /* overridden */
+    CHECK(table[0x003] == 0x00300c12);
+    CHECK(table[0x004] == MMU_DESC_FAULT);
+    CHECK(table[0xc00] == 0x30000c1a);
+    CHECK(table[0xc01] == 0x30100c1a);
+    CHECK(table[0xc02] == MMU_DESC_FAULT);
+    CHECK(table[0xfff] == 0x00000c1e);
+
+    mmu_build_table(table, remap, 0);
+    for (uint32_t i = 0; i < MMU_TABLE_ENTRIES; i++)
+        CHECK(table[i] == MMU_DESC_FAULT);
+}
+
+static void test_s3c2440_map(void)
+{
+    uint32_t nr = sizeof(s3c2440_memory_map) / sizeof(s3c2440_memory_map[0]);
+
+    platform_mmu_init();
+    CHECK(enabled_table == mmu_table);
+    check_table(mmu_table, s3c2440_memory_map, nr);
+
+    // the sdram is cached, the registers are not, the rest faults
+    CHECK(mmu_table[0x300] == 0x30000c1e);
+    CHECK(mmu_table[0x33f] == 0x33f00c1e);
+    CHECK(mmu_table[0x340] == MMU_DESC_FAULT);
+    CHECK(mmu_table[0x480] == 0x48000c12);
+    CHECK(mmu_table[0x5af] == 0x5af00c12);
+    CHECK(mmu_table[0x5b0] == MMU_DESC_FAULT);
+
+    // the steppingstone, where this boot mode has it
+    CHECK(mmu_table[SRAM_BASE >> MMU_SECTION_SHIFT] == (SRAM_BASE | 0xc1e));
+    if (0 == SRAM_BASE) {
+        CHECK(mmu_table[0x001] == 0x00100c12);
+        CHECK(mmu_table[0x400] == MMU_DESC_FAULT);
+    } else {
+        CHECK(mmu_table[0x000] == 0x00000c12);
+    }
+}
+
+int main(void)
+{
+    test_regions();
+    test_s3c2440_map();
+    return test_report("mmu");
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_mmu.c
@@ -0,0 +1,142 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The udp and icmp stack over the loopback, as the app of a hosted
+ * kernel. Echo helpers on both cpus wait for ever for each datagram, a
+ * wakeup lost between the net task and a reader hangs the test.
+ */
+
+#include "test/test.h"
+#include "os/net.h"
+#include "os/init.h"
+#include "os/string.h"
+
+#define LOCALHOST       IP_ADDR(127, 0, 0, 1)
+#define ECHO_PORT       7
+#define HELPER_NR       2
+#define HELPER_STACK    65536
+#define ROUNDS          3000
+
+static task_t helpers[HELPER_NR];
+static uint32_t helper_stacks[HELPER_NR][HELPER_STACK / sizeof(uint32_t)];
+static volatile uint32_t helpers_done;
+
+static udp_sock_t echo_socks[HELPER_NR];
+
+/* sends back whatever comes in until the socket is closed */
+static void echo_entry(void *para)
+{
+    udp_sock_t *s = &echo_socks[(address_t)para];
+    uint8_t buf[64];
+    ip_addr_t from;
+    uint32_t port;
+    int32_t n;
+
+    while ((n = udp_recvfrom(s, buf, sizeof(buf), &from, &port, 0)) >= 0)
+        CHECK(n == udp_sendto(s, from, port, buf, n));
+
+    CHECKF(NET_ERR_CLOSED == n, "echo helper got %d", n);
+    HAL_ATOMIC_ADD(&helpers_done, 1);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void test_ping(void)
+{
+    for (int i = 0; i < 100; i++)
+        CHECKF(NET_OK == icmp_ping(LOCALHOST, i, 100), "ping %d", i);
+    CHECK(NET_ERR_UNREACH == icmp_ping(IP_ADDR(10, 0, 0, 1), 8, 100));
+}
+
+static void test_ports(void)
+{
+    udp_sock_t a, b;
+
+    CHECK(NET_OK == udp_open(&a, IP_ADDR_ANY, 5000));
+    CHECK(NET_ERR_INUSE == udp_open(&b, IP_ADDR_ANY, 5000));
+    CHECK(NET_ERR_INVAL == udp_open(&b, IP_ADDR_ANY, 70000));
+    CHECK(NET_OK == udp_open(&b, IP_ADDR_ANY, 0));
+    CHECKF(b.port >= 49152, "port %u", b.port);
+
+    // nothing there, a wait that is over at once and one that times out
+    CHECK(NULL == udp_recv(&a, NULL, NULL, -1));
+    CHECK(NET_ERR_TIMEOUT == udp_recvfrom(&a, NULL, 0, NULL, NULL, 5));
+
+    udp_close(&a);
+    udp_close(&b);
+}
+
+/* every datagram comes back, from the helper it went to */
+static void test_echo(void)
+{
+    udp_sock_t s;
+    uint8_t out[64], in[64];
+    uint32_t port, len;
+    ip_addr_t from;
+    int32_t n;
+
+    for (int i = 0; i < HELPER_NR; i++) {
+        CHECK(NET_OK == udp_open(&echo_socks[i], IP_ADDR_ANY, ECHO_PORT + i));
+        task_create(helpers + i, "echo", 10, 0, (address_t)helper_stacks[i],
+            HELPER_STACK, echo_entry, (void *)(address_t)i);
+    }
+    CHECK(NET_OK == udp_open(&s, LOCALHOST, 0));
+
+    for (int round = 0; round < ROUNDS; round++) {
+        len = 1 + test_rand() % sizeof(out);
+        for (uint32_t i = 0; i < len; i++)
+            out[i] = (uint8_t)test_rand();
+
+        n = udp_sendto(&s, LOCALHOST, ECHO_PORT + round % HELPER_NR, out, len);
+        CHECKF((int32_t)len == n, "round %d sent %d", round, n);
+
+        n = udp_recvfrom(&s, in, sizeof(in), &from, &port, 200);
+        CHECKF(((int32_t)len == n) && (0 == memcmp(in, out, len))
+            && (LOCALHOST == from) && (ECHO_PORT + round % HELPER_NR == port),
+            "round %d got %d", round, n);
+        if (n < 0)
+            break;
+    }
+
+    // closing wakes the helpers, they wait for ever
+    helpers_done = 0;
+    for (int i = 0; i < HELPER_NR; i++)
+        udp_close(&echo_socks[i]);
+    for (int i = 0; (helpers_done < HELPER_NR) && (i < 3000); i++)
+        task_sleep(1);
+    CHECKF(HELPER_NR == helpers_done, "%u helpers done", helpers_done);
+    udp_close(&s);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_net(void)
+{
+    net_stats_t stats;
+
+    test_ping();
+    test_ports();
+    test_echo();
+
+    net_get_stats(&stats);
+    CHECKF(0 == stats.udp_overflows, "%u overflows", stats.udp_overflows);
+    CHECKF(0 == stats.udp_bad + stats.ip_bad + stats.icmp_bad, "bad packets");
+
+    hosted_exit(test_report("net"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_net, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_net.c
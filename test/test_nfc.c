@@ -0,0 +1,310 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The nand controller driver on the command level model of nandsim, as
+ * the app of a hosted kernel: the hamming code bit by bit, bit flips in
+ * written and in erased pages, cache reads and programs, failing parts,
+ * the bad block table over attaches and readers on both cpus at once.
+ */
+
+#include "test/test.h"
+#include "os/nfc.h"
+#include "os/nandsim.h"
+#include "os/init.h"
+#include "os/string.h"
+
+#define PAGE            2048
+#define SPARE           64
+#define PAGES_PER_BLOCK 64
+#define BLOCKS          64
+#define OOB             \
+    (SPARE - NFC_MARKER_BYTES - PAGE / NFC_ECC_STEP * NFC_ECC_BYTES)
+#define ECC_OFF         (PAGE + SPARE - PAGE / NFC_ECC_STEP * NFC_ECC_BYTES)
+#define HELPER_NR       2
+#define HELPER_STACK    65536
+#define READS           500
+
+DECLARE_NANDSIM(chip, PAGE, SPARE, PAGES_PER_BLOCK, BLOCKS);
+DECLARE_NFC(flash, &nandsim_nfc_ops, &chip);
+
+static nand_t *nand = &flash.nand;
+
+static uint8_t wbuf[PAGES_PER_BLOCK * PAGE];
+static uint8_t rbuf[PAGES_PER_BLOCK * PAGE];
+static uint8_t woob[PAGES_PER_BLOCK * OOB];
+static uint8_t roob[PAGES_PER_BLOCK * OOB];
+
+/* a page as the chip holds it, data then spare */
+static uint8_t *raw_page(uint32_t page)
+{
+    return chip.mem + page * (PAGE + SPARE);
+}
+
+static void fill_random(uint8_t *p, uint32_t n)
+{
+    while (n--)
+        *p++ = (uint8_t)test_rand();
+}
+
+static bool_t all_ff(const uint8_t *p, uint32_t n)
+{
+    while (n--) {
+        if (0xff != *p++)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* every single flip is put right, every double one is caught */
+static void test_ecc(void)
+{
+    uint8_t good[NFC_ECC_STEP], step[NFC_ECC_STEP];
+    uint8_t stored[NFC_ECC_BYTES], code[NFC_ECC_BYTES];
+    uint32_t a, b;
+
+    memset(step, 0xff, sizeof(step));
+    nfc_ecc_calc(step, code);
+    CHECKF(all_ff(code, NFC_ECC_BYTES), "blank codes %02x%02x%02x", code[0],
+        code[1], code[2]);
+
+    fill_random(good, sizeof(good));
+    nfc_ecc_calc(good, stored);
+
+    for (a = 0; a < 8 * NFC_ECC_STEP; a++) {
+        memcpy(step, good, sizeof(step));
+        step[a / 8] ^= 1 << (a % 8);
+        nfc_ecc_calc(step, code);
+        CHECKF((NAND_CORRECTED == nfc_ecc_correct(step, stored, code))
+            && (0 == memcmp(step, good, sizeof(step))), "data bit %u", a);
+    }
+
+    for (a = 0; a < 8 * NFC_ECC_BYTES; a++) {
+        memcpy(code, stored, sizeof(code));
+        code[a / 8] ^= 1 << (a % 8);
+        memcpy(step, good, sizeof(step));
+        CHECKF((NAND_CORRECTED == nfc_ecc_correct(step, stored, code))
+            && (0 == memcmp(step, good, sizeof(step))), "code bit %u", a);
+    }
+
+    for (int i = 0; i < 4000; i++) {
+        a = test_rand() % (8 * NFC_ECC_STEP);
+        b = test_rand() % (8 * NFC_ECC_STEP);
+        if (a == b)
+            continue;
+        memcpy(step, good, sizeof(step));
+        step[a / 8] ^= 1 << (a % 8);
+        step[b / 8] ^= 1 << (b % 8);
+        nfc_ecc_calc(step, code);
+        CHECKF(NAND_ECC_ERROR == nfc_ecc_correct(step, stored, code),
+            "data bits %u and %u", a, b);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+
+static void test_attach(void)
+{
+    uint32_t reads;
+
+    nandsim_init(&chip);
+    chip.bad[5] = 1;
+    chip.bad[BLOCKS - 1] = 1;
+
+    // the first time the markers are scanned and a table written
+    CHECK(NAND_OK == nfc_attach(&flash));
+    CHECK(PAGE == nand->page_size);
+    CHECKF(OOB == nand->oob_size, "oob %u", nand->oob_size);
+    CHECK(PAGES_PER_BLOCK == nand->pages_per_block);
+    CHECKF(BLOCKS - NFC_BBT_BLOCKS == nand->nr_blocks, "blocks %u",
+        nand->nr_blocks);
+    CHECK(flash.cache_ops);
+    CHECKF(BLOCKS - 2 == flash.bbt_block, "table in block %u",
+        flash.bbt_block);
+    CHECK(nand_is_bad(nand, 5));
+    CHECK(!nand_is_bad(nand, 6));
+
+    // then the table is loaded, not a marker read again
+    reads = chip.reads;
+    CHECK(NAND_OK == nfc_attach(&flash));
+    CHECKF(chip.reads - reads < BLOCKS, "%u reads", chip.reads - reads);
+    CHECK(nand_is_bad(nand, 5));
+    CHECK(!nand_is_bad(nand, 6));
+
+    // a block going bad is in the next table
+    CHECK(NAND_OK == nand_mark_bad(nand, 20));
+    CHECK(nand_is_bad(nand, 20));
+    CHECK(NAND_OK == nfc_attach(&flash));
+    CHECK(nand_is_bad(nand, 20));
+    CHECK(nand_is_bad(nand, 5));
+    CHECK(!nand_is_bad(nand, 21));
+
+    CHECK(NAND_ERROR == nand_erase(nand, 5));
+    CHECK(NAND_ERROR == nand_program(nand, 5 * PAGES_PER_BLOCK, wbuf, NULL));
+}
+
+/* a block of pages in one go each way, then one by one */
+static void test_cache(void)
+{
+    uint32_t first = 10 * PAGES_PER_BLOCK, cache_reads;
+
+    fill_random(wbuf, sizeof(wbuf));
+    fill_random(woob, sizeof(woob));
+    CHECK(NAND_OK == nand_erase(nand, 10));
+    CHECK(NAND_OK == nand_program_pages(nand, first, PAGES_PER_BLOCK, wbuf,
+        woob));
+
+    cache_reads = flash.cache_reads;
+    CHECK(NAND_OK == nand_read_pages(nand, first, PAGES_PER_BLOCK, rbuf,
+        roob));
+    CHECKF(PAGES_PER_BLOCK == flash.cache_reads - cache_reads,
+        "%u cache reads", flash.cache_reads - cache_reads);
+    CHECK(0 == memcmp(rbuf, wbuf, sizeof(wbuf)));
+    CHECK(0 == memcmp(roob, woob, sizeof(woob)));
+
+    for (uint32_t i = 0; i < PAGES_PER_BLOCK; i++) {
+        CHECKF((NAND_OK == nand_read(nand, first + i, rbuf, roob))
+            && (0 == memcmp(rbuf, wbuf + i * PAGE, PAGE))
+            && (0 == memcmp(roob, woob + i * OOB, OOB)), "page %u", i);
+    }
+
+    memset(roob, 0, OOB);
+    CHECK(NAND_OK == nand_read(nand, first + 1, NULL, roob));
+    CHECK(0 == memcmp(roob, woob + OOB, OOB));
+}
+
+/* flips in what test_cache() wrote, then in erased pages */
+static void test_flips(void)
+{
+    uint32_t page = 10 * PAGES_PER_BLOCK + 3, erased = 11 * PAGES_PER_BLOCK;
+    uint8_t *raw = raw_page(page);
+    uint32_t corrected = flash.corrected;
+    uint32_t errors = flash.ecc_errors;
+    status_t st;
+
+    raw[700] ^= 0x10;
+    st = nand_read(nand, page, rbuf, NULL);
+    CHECKF((NAND_CORRECTED == st) && (0 == memcmp(rbuf, wbuf + 3 * PAGE,
+        PAGE)), "a data flip: %d", st);
+
+    raw[ECC_OFF + 11] ^= 0x04;
+    st = nand_read(nand, page, rbuf, NULL);
+    CHECKF((NAND_CORRECTED == st) && (0 == memcmp(rbuf, wbuf + 3 * PAGE,
+        PAGE)), "and a code flip: %d", st);
+
+    raw[701] ^= 0x01;
+    CHECK(NAND_ECC_ERROR == nand_read(nand, page, rbuf, NULL));
+    CHECK(NAND_ECC_ERROR == nand_read_pages(nand, page - 3, 8, rbuf, NULL));
+    CHECK(flash.corrected - corrected >= 2);
+    CHECK(flash.ecc_errors - errors >= 2);
+
+    // a written step whose code reads blank is not taken for erased
+    page++;
+    raw = raw_page(page);
+    memset(raw + ECC_OFF, 0xff, NFC_ECC_BYTES);
+    raw[10] ^= 0x40;
+    CHECK(NAND_ECC_ERROR == nand_read(nand, page, rbuf, NULL));
+
+    // erased pages read blank, a flip in one is put right
+    CHECK(NAND_OK == nand_erase(nand, 11));
+    CHECK(NAND_OK == nand_program(nand, erased, NULL, woob));
+    CHECK(NAND_OK == nand_read(nand, erased, rbuf, roob));
+    CHECK(all_ff(rbuf, PAGE));
+    CHECK(0 == memcmp(roob, woob, OOB));
+
+    raw = raw_page(erased + 1);
+    raw[PAGE - 1] ^= 0x80;
+    CHECK(NAND_CORRECTED == nand_read(nand, erased + 1, rbuf, NULL));
+    CHECK(all_ff(rbuf, PAGE));
+
+    raw[PAGE - 2] ^= 0x01;
+    CHECK(NAND_ECC_ERROR == nand_read(nand, erased + 1, rbuf, NULL));
+}
+
+static void test_faults(void)
+{
+    uint32_t page = 12 * PAGES_PER_BLOCK;
+
+    CHECK(NAND_OK == nand_erase(nand, 12));
+    chip.fail_program = 1;
+    CHECK(NAND_ERROR == nand_program(nand, page, wbuf, woob));
+    chip.fail_erase = 1;
+    CHECK(NAND_ERROR == nand_erase(nand, 12));
+    CHECK(NAND_OK == nand_erase(nand, 12));
+    CHECK(NAND_OK == nand_program(nand, page, wbuf, woob));
+}
+
+/*--------------------------------------------------------------------------*/
+
+static task_t helpers[HELPER_NR];
+static uint32_t helper_stacks[HELPER_NR][HELPER_STACK / sizeof(uint32_t)];
+static uint8_t helper_bufs[HELPER_NR][PAGE];
+static volatile uint32_t helpers_done;
+
+/* reads of its own, interleaved with the other cpu's on the same chip */
+static void reader_entry(void *para)
+{
+    uint32_t i = (uint32_t)(address_t)para, page;
+    uint8_t *buf = helper_bufs[i];
+
+    for (uint32_t round = 0; round < READS; round++) {
+        page = (round + i) % PAGES_PER_BLOCK;
+        CHECKF((NAND_OK == nand_read(nand, 13 * PAGES_PER_BLOCK + page, buf,
+            NULL)) && (0 == memcmp(buf, wbuf + page * PAGE, PAGE)),
+            "reader %u page %u", i, page);
+    }
+
+    HAL_ATOMIC_ADD(&helpers_done, 1);
+}
+
+/* tasks on both cpus share the chip, one command at a time */
+static void test_shared(void)
+{
+    fill_random(wbuf, sizeof(wbuf));
+    CHECK(NAND_OK == nand_erase(nand, 13));
+    CHECK(NAND_OK == nand_program_pages(nand, 13 * PAGES_PER_BLOCK,
+        PAGES_PER_BLOCK, wbuf, NULL));
+
+    helpers_done = 0;
+    for (uint32_t i = 0; i < HELPER_NR; i++) {
+        task_create(helpers + i, "reader", 10, 0,
+            (address_t)helper_stacks[i], HELPER_STACK, reader_entry,
+            (void *)(address_t)i);
+    }
+    for (int i = 0; (helpers_done < HELPER_NR) && (i < 60000); i++)
+        task_sleep(1);
+    CHECKF(HELPER_NR == helpers_done, "%u of %u readers done", helpers_done,
+        HELPER_NR);
+    CHECK(!flash.locked);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_nfc(void)
+{
+    test_ecc();
+    test_attach();
+    test_cache();
+    test_flips();
+    test_faults();
+    test_shared();
+
+    hosted_exit(test_report("nfc"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_nfc, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_nfc.c
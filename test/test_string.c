@@ -0,0 +1,177 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * The c versions of os/string.c against the c library, for every length
+ * up to STR_LEN_MAX and every alignment of both sides. The assembly of
+ * the arm7_9 port is not run here.
+ */
+
+#include "test/test.h"
+
+#define memcpy  k_memcpy
+#define memmove k_memmove
+#define memset  k_memset
+#define memcmp  k_memcmp
+#define strlen  k_strlen
+#define strcmp  k_strcmp
+#include "os/string.c"
+#undef memcpy
+#undef memmove
+#undef memset
+#undef memcmp
+#undef strlen
+#undef strcmp
+
+/* the host ones, size_t of the host is unsigned long */
+void *memcpy(void *dst, const void *src, unsigned long n);
+void *memmove(void *dst, const void *src, unsigned long n);
+void *memset(void *dst, int c, unsigned long n);
+int memcmp(const void *s1, const void *s2, unsigned long n);
+unsigned long strlen(const char *s);
+int strcmp(const char *s1, const char *s2);
+
+#define STR_LEN_MAX     140
+#define STR_ALIGN_NR    8       /* two words, every offset in each */
+#define STR_GUARD       32
+#define STR_LONG_MAX    4096
+/* room for two of the longest, memmove puts them up to that far apart */
+#define STR_BUF_SIZE    (2 * (STR_GUARD + STR_ALIGN_NR + STR_LONG_MAX))
+
+/* the lengths past STR_LEN_MAX tried as well, around the 32 byte blocks */
+static const uint32_t long_lens[] = {
+    255, 256, 257, 1023, 1024, 4093, STR_LONG_MAX
+};
+
+static uint8_t buf_a[STR_BUF_SIZE];
+static uint8_t buf_b[STR_BUF_SIZE];
+static uint8_t want[STR_BUF_SIZE];
+
+static void fill_random(uint8_t *p, uint32_t n)
+{
+    while (n--)
+        *p++ = (uint8_t)test_rand();
+}
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* the whole buffer is compared, nothing outside the range may change */
+static void test_copy_set(uint32_t n, uint32_t da, uint32_t sa)
+{
+    uint8_t *dst = buf_a + STR_GUARD + da;
+    uint8_t *src = buf_b + STR_GUARD + sa;
+
+    fill_random(buf_a, STR_BUF_SIZE);
+    fill_random(buf_b, STR_BUF_SIZE);
+    memcpy(want, buf_a, STR_BUF_SIZE);
+
+    CHECK(k_memcpy(dst, src, n) == dst);
+    memcpy(want + STR_GUARD + da, src, n);
+    CHECKF(0 == memcmp(buf_a, want, STR_BUF_SIZE), "memcpy n %u dst %u src %u",
+        n, da, sa);
+
+    CHECK(k_memset(dst, 0x80 | sa, n) == dst);
+    memset(want + STR_GUARD + da, 0x80 | sa, n);
+    CHECKF(0 == memcmp(buf_a, want, STR_BUF_SIZE), "memset n %u dst %u", n,
+        da);
+}
+
+/* overlapping both ways within one buffer, 'gap' bytes apart at least */
+static void test_move(uint32_t n, uint32_t da, uint32_t sa, uint32_t gap)
+{
+    uint8_t *lo = buf_a + STR_GUARD;
+    uint8_t *hi = buf_a + STR_GUARD + gap;
+
+    fill_random(buf_a, STR_BUF_SIZE);
+    memcpy(want, buf_a, STR_BUF_SIZE);
+
+    CHECK(k_memmove(hi + da, lo + sa, n) == hi + da);
+    memmove(want + (hi - buf_a) + da, want + (lo - buf_a) + sa, n);
+    CHECKF(0 == memcmp(buf_a, want, STR_BUF_SIZE),
+        "memmove up n %u dst %u src %u gap %u", n, da, sa, gap);
+
+    CHECK(k_memmove(lo + da, hi + sa, n) == lo + da);
+    memmove(want + (lo - buf_a) + da, want + (hi - buf_a) + sa, n);
+    CHECKF(0 == memcmp(buf_a, want, STR_BUF_SIZE),
+        "memmove down n %u dst %u src %u gap %u", n, da, sa, gap);
+}
+
+/* equal, then one bit off at each end and in the middle */
+static void test_compare(uint32_t n, uint32_t da, uint32_t sa)
+{
+    uint8_t *a = buf_a + STR_GUARD + da;
+    uint8_t *b = buf_b + STR_GUARD + sa;
+    uint32_t where[3] = {0, n / 2, n - 1};
+
+    fill_random(a, n);
+    memcpy(b, a, n);
+    CHECKF(0 == k_memcmp(a, b, n), "memcmp equal n %u", n);
+
+    for (uint32_t i = 0; (n > 0) && (i < 3); i++) {
+        b[where[i]] ^= 1 << (where[i] & 7);
+        CHECKF(sign(k_memcmp(a, b, n)) == sign(memcmp(a, b, n)),
+            "memcmp n %u at %u a %u b %u", n, where[i], da, sa);
+        CHECKF(sign(k_memcmp(b, a, n)) == sign(memcmp(b, a, n)),
+            "memcmp n %u at %u a %u b %u", n, where[i], da, sa);
+        b[where[i]] = a[where[i]];
+    }
+}
+
+/* the bytes after the end are not zero, the scan must stop at the nul */
+static void test_strings(uint32_t n, uint32_t da)
+{
+    char *s = (char *)buf_a + STR_GUARD + da;
+    char *t = (char *)buf_b + STR_GUARD + da;
+
+    for (uint32_t i = 0; i < n; i++)
+        s[i] = (char)(1 + test_rand() % 255);
+    s[n] = '\0';
+    s[n + 1] = 'x';
+    memcpy(t, s, n + 2);
+
+    CHECKF(k_strlen(s) == n, "strlen n %u at %u", n, da);
+    CHECKF(0 == k_strcmp(s, t), "strcmp equal n %u", n);
+    if (n > 0) {
+        t[n - 1] ^= 0x80;
+        CHECKF(sign(k_strcmp(s, t)) == sign(strcmp(s, t)), "strcmp n %u", n);
+        t[n - 1] = '\0';
+        CHECKF(sign(k_strcmp(s, t)) == sign(strcmp(s, t)),
+            "strcmp prefix n %u", n);
+    }
+}
+
+static void test_len(uint32_t n)
+{
+    for (uint32_t da = 0; da < STR_ALIGN_NR; da++) {
+        for (uint32_t sa = 0; sa < STR_ALIGN_NR; sa++) {
+            test_copy_set(n, da, sa);
+            test_move(n, da, sa, 1);
+            test_move(n, da, sa, 5);
+            test_move(n, da, sa, n / 2 + 3);
+            test_compare(n, da, sa);
+        }
+        test_strings(n, da);
+    }
+}
+
+int main(void)
+{
+    for (uint32_t n = 0; n <= STR_LEN_MAX; n++)
+        test_len(n);
+    for (uint32_t i = 0; i < sizeof(long_lens) / sizeof(long_lens[0]); i++)
+        test_len(long_lens[i]);
+
+    return test_report("string");
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_string.c
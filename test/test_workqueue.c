@@ -0,0 +1,185 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * A workqueue fed from tasks on both cpus, as the app of a hosted kernel.
+ * Each producer queues one item and waits for it to run before the next,
+ * so the worker goes to sleep between nearly every item; a wakeup lost
+ * on the way strands the item and the producer times out. Last a task
+ * on cpu 0 queues to the worker on the other cpu while draining the hsrs
+ * itself, so the wakeup comes from another cpu as the worker checks.
+ */
+
+#include "test/test.h"
+#include "os/workqueue.h"
+#include "os/init.h"
+
+#define PRODUCER_NR     2
+#define PRODUCER_STACK  65536
+#define ROUNDS          2000
+#define WAIT_SPINS      1000
+#define WAIT_TICKS      300
+#define SPINNER_ROUNDS  300
+#define SPINNER_SPINS   100000000
+
+TASK_STRUCT(worker, PRODUCER_STACK);
+static workqueue_t wq;
+
+static task_t producers[PRODUCER_NR];
+static uint32_t producer_stacks[PRODUCER_NR][PRODUCER_STACK / sizeof(uint32_t)];
+static volatile uint32_t producers_done;
+
+static work_t works[PRODUCER_NR];
+static volatile uint32_t ran[PRODUCER_NR];
+static uint32_t order_errors;
+/* the cpu queueing the items and the runs seen on the other one */
+static volatile uint32_t spinner_cpu = CPU_NR, remote;
+
+static void work_func(void *data)
+{
+    if (cpu_id() != spinner_cpu)
+        ++remote;
+    HAL_ATOMIC_ADD(&ran[(address_t)data], 1);
+}
+
+/* the item 'i' has run 'want' times, FALSE once it is stranded */
+static bool_t wait_ran(uint32_t i, uint32_t want)
+{
+    for (int spin = 0; (ran[i] != want) && (spin < WAIT_SPINS); spin++)
+        task_yield();
+    for (int tick = 0; (ran[i] != want) && (tick < WAIT_TICKS); tick++)
+        task_sleep(1);
+    return (ran[i] == want) ? TRUE : FALSE;
+}
+
+static void producer_entry(void *para)
+{
+    uint32_t i = (uint32_t)(address_t)para;
+
+    for (uint32_t round = 1; round <= ROUNDS; round++) {
+        CHECKF(queue_work(&wq, &works[i]), "producer %u round %u pending", i,
+            round);
+        if (!wait_ran(i, round)) {
+            CHECKF(0, "producer %u round %u stranded", i, round);
+            break;
+        }
+    }
+
+    HAL_ATOMIC_ADD(&producers_done, 1);
+}
+
+static void producers_run(uint32_t nr)
+{
+    producers_done = 0;
+    for (uint32_t i = 0; i < nr; i++) {
+        ran[i] = 0;
+        task_create(producers + i, "producer", 10, 0,
+            (address_t)producer_stacks[i], PRODUCER_STACK, producer_entry,
+            (void *)(address_t)i);
+    }
+    for (int i = 0; (producers_done < nr) && (i < 60000); i++)
+        task_sleep(1);
+    CHECKF(producers_done == nr, "%u of %u producers done", producers_done,
+        nr);
+}
+
+/*--------------------------------------------------------------------------*/
+
+static work_t chain[8];
+static uint32_t chain_next;
+
+/* the items of one batch run in the order they were queued */
+static void chain_func(void *data)
+{
+    if ((address_t)data != chain_next++)
+        ++order_errors;
+}
+
+static void test_order(void)
+{
+    for (uint32_t i = 0; i < 8; i++)
+        INIT_WORK(&chain[i], chain_func, (void *)(address_t)i);
+
+    chain_next = 0;
+    task_lock();
+    for (uint32_t i = 0; i < 8; i++)
+        CHECK(queue_work(&wq, &chain[i]));
+    CHECK(!queue_work(&wq, &chain[0]));
+    task_unlock();
+
+    for (int i = 0; (chain_next < 8) && (i < WAIT_TICKS); i++)
+        task_sleep(1);
+    CHECKF(8 == chain_next, "%u of 8 ran", chain_next);
+    CHECK(0 == order_errors);
+}
+
+/*
+ * Queues from cpu 0 as a rule, where the wakeup hsr runs, drains it at once
+ * and spins for the item. Never sleeping, it leaves the worker to the
+ * other cpu, which is going to sleep right when the hsr comes.
+ */
+static void spinner_entry(void *para)
+{
+    spinner_cpu = cpu_id();
+
+    for (uint32_t round = 1; round <= SPINNER_ROUNDS; round++) {
+        queue_work(&wq, &works[0]);
+        task_lock();
+        task_unlock();
+        for (int spin = 0; (ran[0] != round) && (spin < SPINNER_SPINS);
+            spin++)
+            HAL_CPU_RELAX();
+        if (!wait_ran(0, round)) {
+            CHECKF(0, "spinner round %u stranded", round);
+            break;
+        }
+    }
+
+    HAL_ATOMIC_ADD(&producers_done, 1);
+}
+
+static void test_remote(void)
+{
+    producers_done = 0;
+    ran[0] = 0;
+    remote = 0;
+    task_create(producers, "spinner", 5, 0, (address_t)producer_stacks[0],
+        PRODUCER_STACK, spinner_entry, NULL);
+    for (int i = 0; (0 == producers_done) && (i < 60000); i++)
+        task_sleep(1);
+    CHECK(1 == producers_done);
+    CHECKF(remote > 0, "%u of %u on the other cpu", remote, ran[0]);
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* last of the initcalls, in the init task */
+static bool_t test_workqueue(void)
+{
+    workqueue_create(&wq, "test_wq", 8, 4, &worker);
+    for (uint32_t i = 0; i < PRODUCER_NR; i++)
+        INIT_WORK(&works[i], work_func, (void *)(address_t)i);
+
+    test_order();
+
+    // one producer alone, then one on each cpu
+    producers_run(1);
+    producers_run(PRODUCER_NR);
+    test_remote();
+
+    hosted_exit(test_report("workqueue"));
+    return TRUE;
+}
+
+DECLARE_INITCALL(test_workqueue, 8);
+
+void app_start(void)
+{
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF test_workqueue.c
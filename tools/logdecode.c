@@ -0,0 +1,294 @@
+/*--------------------------------------------------------------------------*/
+/*                                  MINIOS                                  */
+/*                        The Embedded Operating System                     */
+/*             Copyright (C) 2014-2024, ZhuGuangXiang, Nanjing, China       */
+/*                           All Rights Reserved                            */
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Host side of os/log.h: turn the raw records log_read() returned back
+ * into text, with the format strings and task symbols of the elf image.
+ *
+ *   logdecode minios.elf records.bin
+ *
+ * Word size and byte order of the records are those of the elf.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_MAX_ARGS 5
+#define LOG_WORDS    (3 + LOG_MAX_ARGS)
+
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB   2
+#define SHF_ALLOC    2
+#define STT_OBJECT   1
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t offset;
+    uint32_t type;
+    uint64_t flags;
+    uint32_t link;
+    uint64_t entsize;
+} section_t;
+
+static uint8_t *elf;
+static long elf_size;
+static int elf64;
+static int big_endian;
+static section_t *sections;
+static int section_nr;
+
+/*--------------------------------------------------------------------------*/
+
+static uint64_t get(const uint8_t *p, int size)
+{
+    uint64_t v = 0;
+
+    for (int i = 0; i < size; i++) {
+        int b = big_endian ? i : size - 1 - i;
+        v = (v << 8) | p[b];
+    }
+    return v;
+}
+
+static uint8_t *load(const char *path, long *size)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+
+    if (NULL == f) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(*size + 1);
+    if ((NULL == buf) || (fread(buf, 1, *size, f) != (size_t)*size)) {
+        fprintf(stderr, "%s: read failed\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return buf;
+}
+
+static void elf_parse(void)
+{
+    uint64_t shoff;
+    int shentsize;
+    const uint8_t *sh;
+
+    if ((elf_size < 52) || memcmp(elf, "\177ELF", 4)) {
+        fprintf(stderr, "not an elf file\n");
+        exit(1);
+    }
+    elf64 = (2 == elf[4]);
+    big_endian = (2 == elf[5]);
+
+    shoff = elf64 ? get(elf + 0x28, 8) : get(elf + 0x20, 4);
+    shentsize = get(elf + (elf64 ? 0x3a : 0x2e), 2);
+    section_nr = get(elf + (elf64 ? 0x3c : 0x30), 2);
+    sections = calloc(section_nr, sizeof(section_t));
+
+    for (int i = 0; i < section_nr; i++) {
+        sh = elf + shoff + i * shentsize;
+        sections[i].type = get(sh + 4, 4);
+        if (elf64) {
+            sections[i].flags = get(sh + 8, 8);
+            sections[i].addr = get(sh + 16, 8);
+            sections[i].offset = get(sh + 24, 8);
+            sections[i].size = get(sh + 32, 8);
+            sections[i].link = get(sh + 40, 4);
+            sections[i].entsize = get(sh + 56, 8);
+        } else {
+            sections[i].flags = get(sh + 8, 4);
+            sections[i].addr = get(sh + 12, 4);
+            sections[i].offset = get(sh + 16, 4);
+            sections[i].size = get(sh + 20, 4);
+            sections[i].link = get(sh + 24, 4);
+            sections[i].entsize = get(sh + 36, 4);
+        }
+    }
+}
+
+/* a nul terminated string at 'addr' in the loaded image, or NULL */
+static const char *elf_string(uint64_t addr)
+{
+    section_t *s;
+
+    for (int i = 0; i < section_nr; i++) {
+        s = sections + i;
+        if ((SHT_PROGBITS != s->type) || !(s->flags & SHF_ALLOC))
+            continue;
+        if ((addr < s->addr) || (addr >= s->addr + s->size))
+            continue;
+        if (!memchr(elf + s->offset + (addr - s->addr), 0,
+            s->size - (addr - s->addr)))
+            return NULL;
+        return (const char *)elf + s->offset + (addr - s->addr);
+    }
+    return NULL;
+}
+
+/* name of the data object 'addr' falls in, the task structures */
+static const char *elf_symbol(uint64_t addr)
+{
+    section_t *s;
+    const uint8_t *sym;
+    uint64_t value, size;
+    uint32_t name, info;
+
+    for (int i = 0; i < section_nr; i++) {
+        s = sections + i;
+        if (SHT_SYMTAB != s->type)
+            continue;
+        for (uint64_t off = 0; off + s->entsize <= s->size;
+            off += s->entsize) {
+            sym = elf + s->offset + off;
+            name = get(sym, 4);
+            if (elf64) {
+                info = sym[4];
+                value = get(sym + 8, 8);
+                size = get(sym + 16, 8);
+            } else {
+                info = sym[12];
+                value = get(sym + 4, 4);
+                size = get(sym + 8, 4);
+            }
+            if ((STT_OBJECT == (info & 0xf)) && (addr >= value) &&
+                (addr < value + (size ? size : 1)))
+                return (const char *)elf +
+                    sections[s->link].offset + name;
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/* printf one conversion at a time, the arguments are taken in order */
+static void print_record(const char *fmt, const uint64_t *args)
+{
+    char spec[32];
+    int argi = 0, len;
+    const char *p, *str;
+
+    for (p = fmt; *p; p++) {
+        if ('%' != *p) {
+            putchar(*p);
+            continue;
+        }
+        if ('%' == p[1]) {
+            putchar('%');
+            p++;
+            continue;
+        }
+
+        len = strspn(p + 1, "-+ #0123456789.lhz") + 2;
+        if (len >= (int)sizeof(spec) - 4) {
+            fputs(p, stdout);
+            return;
+        }
+
+        // drop the length modifiers, the value is widened here anyway
+        int n = 0;
+        for (int i = 0; i < len; i++) {
+            if (!strchr("lhz", p[i]))
+                spec[n++] = p[i];
+        }
+        spec[n] = 0;
+        p += len - 1;
+
+        if (argi >= LOG_MAX_ARGS) {
+            fputs("<?>", stdout);
+            continue;
+        }
+
+        switch (*p) {
+        case 'd': case 'i':
+            spec[n - 1] = 0;
+            strcat(spec, "lld");
+            printf(spec, (long long)(elf64 ? (int64_t)args[argi] :
+                (int32_t)args[argi]));
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[n - 1] = 0;
+            strcat(spec, (char[]){'l', 'l', *p, 0});
+            printf(spec, (unsigned long long)args[argi]);
+            break;
+        case 'c':
+            printf(spec, (int)args[argi]);
+            break;
+        case 'p':
+            printf("0x%llx", (unsigned long long)args[argi]);
+            break;
+        case 's':
+            str = elf_string(args[argi]);
+            if (str)
+                printf(spec, str);
+            else
+                printf("<0x%llx>", (unsigned long long)args[argi]);
+            break;
+        default:
+            fputs(spec, stdout);
+            break;
+        }
+        argi++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t *recs;
+    long recs_size;
+    int word, rec_size;
+    uint64_t fmt, stamp, task, args[LOG_MAX_ARGS];
+    const char *text, *name;
+
+    if (3 != argc) {
+        fprintf(stderr, "usage: %s <elf> <records>\n", argv[0]);
+        return 1;
+    }
+
+    elf = load(argv[1], &elf_size);
+    elf_parse();
+    recs = load(argv[2], &recs_size);
+
+    word = elf64 ? 8 : 4;
+    rec_size = LOG_WORDS * word;
+
+    for (long off = 0; off + rec_size <= recs_size; off += rec_size) {
+        fmt = get(recs + off, word);
+        stamp = get(recs + off + word, word);
+        task = get(recs + off + 2 * word, word);
+        for (int i = 0; i < LOG_MAX_ARGS; i++)
+            args[i] = get(recs + off + (3 + i) * word, word);
+
+        name = task ? elf_symbol(task) : "-";
+        printf("[%10llu] %-16s ", (unsigned long long)stamp,
+            name ? name : "?");
+
+        text = elf_string(fmt);
+        if (text) {
+            print_record(text, args);
+            if (!*text || ('\n' != text[strlen(text) - 1]))
+                putchar('\n');
+        } else {
+            printf("<bad format 0x%llx>\n", (unsigned long long)fmt);
+        }
+    }
+
+    if (recs_size % rec_size)
+        fprintf(stderr, "%ld trailing bytes\n", recs_size % rec_size);
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+// EOF logdecode.c